@@ -22,138 +22,160 @@
  *
  *See COPYRIGHT file copyright information.
  */
+#include <cctype>
+#include <sstream>
 #include "nmv-address.h"
-#include "nmv-str-utils.h"
 #include "nmv-exception.h"
 
 NEMIVER_BEGIN_NAMESPACE (nemiver)
 NEMIVER_BEGIN_NAMESPACE (common)
 
-Address::Address ()
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+Address::Address () :
+    m_value (0),
+    m_nb_digits (0),
+    m_has_prefix (false)
 {
 }
 
 Address::Address (const std::string &a)
 {
-    string str = a;
-    str_utils::chomp (str);
-    if (!str.empty () && !str_utils::string_is_number (str)) {
-        stringstream msg;
-        msg << "Invalid address format: " << str;
-        THROW (msg.str ());
-    }
-    m_addr = str;
+    set (a);
 }
 
-Address::Address (const Address &a_other) :
-    m_addr (a_other.m_addr)
+Address::Address (uint64_t a_value) :
+    m_value (a_value),
+    m_nb_digits (1),
+    m_has_prefix (true)
 {
+    for (uint64_t v = a_value >> 4; v; v >>= 4)
+        ++m_nb_digits;
 }
 
-bool
-Address::empty () const
-{
-    return m_addr.empty ();
-}
+Address::Address (const Address &a_other) :
+    m_value (a_other.m_value),
+    m_nb_digits (a_other.m_nb_digits),
+    m_has_prefix (a_other.m_has_prefix)
+{
+}
+
+/// Parse a_addr.  Leading and trailing white spaces are ignored.  The
+/// rest must be a hexadecimal number, optionally prefixed with "0x".
+/// Note that a string of decimal digits is thus read as a hexadecimal
+/// number.
+/// \return false if a_addr is not an address.
+static bool
+parse_address (const std::string &a_addr,
+               uint64_t &a_value,
+               size_t &a_nb_digits,
+               bool &a_has_prefix)
+{
+    std::string::size_type begin = 0, end = a_addr.size ();
+    while (begin < end && isspace (a_addr[begin]))
+        ++begin;
+    while (end > begin && isspace (a_addr[end - 1]))
+        --end;
+
+    bool has_prefix = false;
+    std::string::size_type cur = begin;
+    if (end - begin > 2
+        && a_addr[begin] == '0'
+        && (a_addr[begin + 1] == 'x' || a_addr[begin + 1] == 'X')) {
+        has_prefix = true;
+        cur += 2;
+    }
 
-const std::string&
-Address::to_string () const
-{
-    return m_addr;
-}
+    uint64_t value = 0;
+    for (; cur < end; ++cur) {
+        int digit = g_ascii_xdigit_value (a_addr[cur]);
+        if (digit < 0)
+            return false;
+        value = value << 4 | digit;
+    }
 
-Address::operator size_t () const
-{
-    if (m_addr.empty ())
-        return 0;
-    return str_utils::hexa_to_int (m_addr);
+    a_value = value;
+    a_nb_digits = end - begin - (has_prefix ? 2 : 0);
+    a_has_prefix = has_prefix;
+    return true;
 }
 
+void
+Address::set (const std::string &a_addr)
+{
+    uint64_t value = 0;
+    size_t nb_digits = 0;
+    bool has_prefix = false;
+    if (!parse_address (a_addr, value, nb_digits, has_prefix)) {
+        std::stringstream msg;
+        msg << "Invalid address format: " << a_addr;
+        THROW (msg.str ());
+    }
+    m_value = value;
+    m_nb_digits = nb_digits > 255 ? 255 : nb_digits;
+    m_has_prefix = has_prefix;
+}
 
-size_t
-Address::size () const
+std::string
+Address::to_string () const
 {
-    if (m_addr.empty ())
-        return 0;
-    int suffix_len = 0;
-    if (m_addr[0] == '0' && m_addr[1] == 'x')
-        suffix_len = 2;
-    return m_addr.size () - suffix_len;
+    if (empty ())
+        return std::string ();
+
+    std::string str (m_has_prefix ? "0x" : "");
+    str.append (m_nb_digits, '0');
+    uint64_t value = m_value;
+    for (std::string::size_type i = str.size ();
+         value && i > (m_has_prefix ? 2u : 0u);
+         --i, value >>= 4)
+        str[i - 1] = HEX_DIGITS[value & 0xf];
+    return str;
 }
 
 size_t
 Address::string_size () const
 {
-    return m_addr.size ();
+    if (empty ())
+        return 0;
+    return m_nb_digits + (m_has_prefix ? 2 : 0);
 }
 
 Address&
 Address::operator= (const std::string &a_addr)
 {
-    string addr = a_addr;
-    str_utils::chomp (addr);
-    if (!addr.empty ()
-        && !str_utils::string_is_number (addr)) {
-        stringstream msg;
-        msg << "Bad address format: " << addr;
-        THROW (msg.str ());
-    }
-    m_addr = addr;
+    set (a_addr);
     return *this;
 }
 
-bool
-Address::operator< (const Address &a_addr) const
-{
-  return ((size_t) *this < (size_t) a_addr);
-}
-
-bool
-Address::operator> (const Address &a_addr) const
-{
-  return ((size_t) *this > (size_t) a_addr);
-}
-
-bool
-Address::operator>= (const Address &a_addr) const
-{
-  return ((size_t) *this >= (size_t) a_addr);
-}
-
-bool
-Address::operator<= (const Address &a_addr) const
-{
-  return ((size_t) *this <= (size_t) a_addr);
-}
-
-bool
-Address::operator== (const Address &a_addr) const
-{
-  return ((size_t) *this == (size_t)a_addr);
-}
-
-const char&
+char
 Address::operator[] (size_t a_index) const
 {
-    return m_addr[a_index];
+    return to_string ()[a_index];
 }
 
 void
 Address::clear ()
 {
-    m_addr.clear ();
+    m_value = 0;
+    m_nb_digits = 0;
+    m_has_prefix = false;
 }
 
+/// Compare the value of this address with the address written in
+/// a_addr, whatever the way it is written.  An empty address is only
+/// equal to a string without digits.
+/// \return false if a_addr is not an address.
 bool
 Address::operator== (const std::string &a_addr) const
 {
-    return m_addr == a_addr;
-}
-
-bool
-Address::operator== (size_t a_addr) const
-{
-    return (size_t) *this == a_addr;
+    uint64_t value = 0;
+    size_t nb_digits = 0;
+    bool has_prefix = false;
+    if (!parse_address (a_addr, value, nb_digits, has_prefix))
+        return false;
+    if (empty () || !nb_digits)
+        return empty () && !nb_digits;
+    return m_value == value;
 }
 
 NEMIVER_END_NAMESPACE (common)
@@ -24,6 +24,7 @@
  */
 #ifndef __NMV_ADDRESS_H__
 #define __NMV_ADDRESS_H__
+#include <stdint.h>
 #include <string>
 #include "nmv-namespace.h"
 #include "nmv-api-macros.h"
@@ -31,28 +32,43 @@
 NEMIVER_BEGIN_NAMESPACE (nemiver)
 NEMIVER_BEGIN_NAMESPACE (common)
 
+/// An address in the memory of the inferior.
+///
+/// Addresses are compared and looked up a lot, so they are stored as
+/// integers.  The way they were written (with or without the "0x"
+/// prefix, and the number of digits) is remembered, so that
+/// to_string gives them back as they were written, modulo the case of
+/// the hexadecimal digits.
 class NEMIVER_API Address
 {
-    std::string m_addr;
+    uint64_t m_value;
+    // The number of hexadecimal digits of the address, leading zeros
+    // included.  Zero if the address is empty.
+    unsigned char m_nb_digits;
+    bool m_has_prefix;
+
+    void set (const std::string &a_addr);
 
 public:
     Address ();
     explicit Address (const std::string &a_addr);
+    explicit Address (uint64_t a_value);
     Address (const Address &);
-    bool empty () const;
-    const std::string& to_string () const;
-    operator size_t () const;
-    size_t size () const;
+    bool empty () const {return !m_nb_digits;}
+    uint64_t value () const {return m_value;}
+    std::string to_string () const;
+    operator size_t () const {return m_value;}
+    size_t size () const {return m_nb_digits;}
     size_t string_size () const;
-    bool operator<  (const Address&) const;
-    bool operator<= (const Address&) const;
-    bool operator>  (const Address&) const;
-    bool operator>= (const Address&) const;
-    bool operator== (const Address&) const;
+    bool operator<  (const Address &a) const {return m_value < a.m_value;}
+    bool operator<= (const Address &a) const {return m_value <= a.m_value;}
+    bool operator>  (const Address &a) const {return m_value > a.m_value;}
+    bool operator>= (const Address &a) const {return m_value >= a.m_value;}
+    bool operator== (const Address &a) const {return m_value == a.m_value;}
     bool operator== (const std::string &) const;
-    bool operator== (size_t) const;
+    bool operator== (size_t a_addr) const {return m_value == a_addr;}
     Address& operator= (const std::string &);
-    const char& operator[] (size_t) const;
+    char operator[] (size_t) const;
     void clear ();
 };// end class Address
 
@@ -31,9 +31,11 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <cstring>
 #include <string>
 #include <vector>
-#include <fstream>
+#include <map>
+#include <memory>
 #include <glibmm.h>
 #include "nmv-env.h"
 #include "nmv-ustring.h"
@@ -332,11 +334,140 @@ find_file (const UString &a_file_name,
     return false;
 }
 
+/// The contents of a file and the offsets of its lines, so getting a
+/// line of the file is a lookup in the offsets followed by a copy of
+/// the line.  The file is read rather than mapped in memory: reading
+/// a mapped file that has been truncated since raises SIGBUS.
+struct FileLineIndex {
+    gchar *content;
+    gsize length;
+    // line_offsets[i] is the offset of the line number i + 1.
+    vector<gsize> line_offsets;
+    // The modification time and the size of the file when it was
+    // indexed.
+    time_t mtime;
+    off_t size;
+    // When the index was last used.  The least recently used index
+    // is the one dropped when too many files are indexed.
+    unsigned long last_use;
+
+    FileLineIndex () :
+        content (0),
+        length (0),
+        mtime (0),
+        size (0),
+        last_use (0)
+    {
+    }
+
+    ~FileLineIndex ()
+    {
+        g_free (content);
+    }
+
+    bool
+    is_up_to_date (const struct stat &a_stat) const
+    {
+        return mtime == a_stat.st_mtime && size == a_stat.st_size;
+    }
+
+    bool
+    build (const string &a_path, const struct stat &a_stat)
+    {
+        GError *error = 0;
+        if (!g_file_get_contents (a_path.c_str (), &content,
+                                  &length, &error)) {
+            LOG_ERROR ("Could not read file " << a_path << ": "
+                       << (error ? error->message : ""));
+            if (error)
+                g_error_free (error);
+            return false;
+        }
+        mtime = a_stat.st_mtime;
+        size = a_stat.st_size;
+
+        line_offsets.push_back (0);
+        for (const char *p = content;
+             (p = (const char*) memchr (p, '\n', content + length - p));
+             ++p)
+            line_offsets.push_back (p - content + 1);
+        return true;
+    }
+
+    bool
+    get_line (int a_line_number, string &a_line) const
+    {
+        if (a_line_number < 1
+            || (size_t) a_line_number > line_offsets.size ())
+            return false;
+
+        gsize begin = line_offsets[a_line_number - 1];
+        gsize end = ((size_t) a_line_number < line_offsets.size ())
+            ? line_offsets[a_line_number] - 1
+            : length;
+        a_line.assign (content + begin, end - begin);
+        return true;
+    }
+};//end struct FileLineIndex
+
+// The maximum number of files which lines are kept indexed.
+static const size_t MAX_NB_INDEXED_FILES = 64;
+
+/// Get the line index of a file, building it if the file has not
+/// been indexed yet or has changed since it was indexed.
+/// \return the index, or a null pointer if the file can't be read.
+static std::shared_ptr<FileLineIndex>
+get_file_line_index (const string &a_path)
+{
+    typedef map<string, std::shared_ptr<FileLineIndex> > IndexMap;
+    static IndexMap s_indexes;
+    static unsigned long s_nb_uses = 0;
+    static Glib::Mutex s_indexes_mutex;
+
+    struct stat st;
+    if (stat (a_path.c_str (), &st)) {
+        LOG_ERROR ("Could not open file " << a_path);
+        return std::shared_ptr<FileLineIndex> ();
+    }
+
+    Glib::Mutex::Lock lock (s_indexes_mutex);
+
+    IndexMap::iterator it = s_indexes.find (a_path);
+    if (it != s_indexes.end () && it->second->is_up_to_date (st)) {
+        it->second->last_use = ++s_nb_uses;
+        return it->second;
+    }
+
+    std::shared_ptr<FileLineIndex> index (new FileLineIndex);
+    if (!index->build (a_path, st)) {
+        if (it != s_indexes.end ())
+            s_indexes.erase (it);
+        return std::shared_ptr<FileLineIndex> ();
+    }
+    index->last_use = ++s_nb_uses;
+    if (it == s_indexes.end () && s_indexes.size () >= MAX_NB_INDEXED_FILES) {
+        // Drop the least recently used index only.
+        IndexMap::iterator oldest = s_indexes.begin ();
+        for (IndexMap::iterator i = s_indexes.begin ();
+             i != s_indexes.end ();
+             ++i)
+            if (i->second->last_use < oldest->second->last_use)
+                oldest = i;
+        s_indexes.erase (oldest);
+    }
+    s_indexes[a_path] = index;
+    return index;
+}
+
 /// Given a file path P and a line number N , reads the line N from P
 /// and return it iff the function returns true. This is useful
 /// e.g. when forging a mixed source/assembly source view, and we want
 /// to display a source line N from a file P.
 ///
+/// The offsets of the lines of the files are kept in an index, so
+/// that reading many lines of a file doesn't read it again each
+/// time.  The index of a file is built again when the file changes.
+///
 /// \param a_file_path the absolute file path to consider
 /// \param a_line_number the line number to consider
 /// \param a_line the string containing the resulting line read, if
@@ -351,41 +482,14 @@ read_file_line (const UString &a_file_path,
         return false;
 
     bool found_line = false;
-    int line_num = 1;
-    char c = 0;
 
     NEMIVER_TRY;
 
-    std::ifstream file (a_file_path.c_str ());
-
-    if (!file.good ()) {
-        LOG_ERROR ("Could not open file " + a_file_path);
+    std::shared_ptr<FileLineIndex> index =
+        get_file_line_index (a_file_path.raw ());
+    if (!index)
         return false;
-    }
-
-    while (true) {
-        if (line_num == a_line_number) {
-            found_line = true;
-            break;
-        }
-        file.get (c);
-        if (!file.good ())
-            break;
-        if (c == '\n')
-            ++line_num;
-    }
-    if (found_line) {
-        a_line.clear ();
-        while (true) {
-            file.get (c);
-            if (!file.good ())
-                break;
-            if (c == '\n')
-                break;
-            a_line += c;
-        }
-    }
-    file.close ();
+    found_line = index->get_line (a_line_number, a_line);
 
     NEMIVER_CATCH_NOX;
 
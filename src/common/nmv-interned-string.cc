@@ -0,0 +1,183 @@
+/*
+ *This file is part of the Nemiver project
+ *
+ *Nemiver is free software; you can redistribute
+ *it and/or modify it under the terms of
+ *the GNU General Public License as published by the
+ *Free Software Foundation; either version 2,
+ *or (at your option) any later version.
+ *
+ *Nemiver is distributed in the hope that it will
+ *be useful, but WITHOUT ANY WARRANTY;
+ *without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *See the GNU General Public License for more details.
+ *
+ *You should have received a copy of the
+ *GNU General Public License along with Nemiver;
+ *see the file COPYING.
+ *If not, write to the Free Software Foundation,
+ *Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *See COPYRIGHT file copyright information.
+ */
+#include "config.h"
+#include <unordered_map>
+#include <glib.h>
+#include <glibmm/thread.h>
+#include "nmv-interned-string.h"
+
+NEMIVER_BEGIN_NAMESPACE (nemiver)
+NEMIVER_BEGIN_NAMESPACE (common)
+
+// The bytes of a string of the table, or of a string looked up in
+// it, so that lookups don't copy the string.  The hash of the bytes
+// is computed once, before the table is locked.
+struct StringBytes {
+    const char *data;
+    size_t len;
+    size_t hash;
+
+    StringBytes (const char *a_data, size_t a_len, size_t a_hash) :
+        data (a_data),
+        len (a_len),
+        hash (a_hash)
+    {
+    }
+
+    bool operator== (const StringBytes &a) const
+    {
+        return len == a.len && !memcmp (data, a.data, len);
+    }
+};// end struct StringBytes
+
+struct StringBytesHash {
+    size_t operator() (const StringBytes &a_bytes) const
+    {
+        return a_bytes.hash;
+    }
+};// end struct StringBytesHash
+
+static size_t
+hash_bytes (const char *a_data, size_t a_len)
+{
+    // FNV-1a.
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < a_len; ++i) {
+        hash ^= (unsigned char) a_data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// The table is split into shards that have their own lock, so that
+// threads interning different strings rarely wait for each other.
+// The keys point into the entries they are mapped to.
+struct InternTableShard {
+    typedef std::unordered_map<StringBytes,
+                               InternedString::Entry*,
+                               StringBytesHash> Table;
+    Glib::Mutex mutex;
+    Table table;
+};// end struct InternTableShard
+
+enum {NB_INTERN_TABLE_SHARDS = 16};
+
+// The shards are never destroyed, as strings can be interned from
+// static constructors and destructors.
+static InternTableShard*
+get_intern_table_shards ()
+{
+    static InternTableShard *s_shards =
+        new InternTableShard[NB_INTERN_TABLE_SHARDS];
+    return s_shards;
+}
+
+static InternTableShard&
+get_intern_table_shard (size_t a_hash)
+{
+    // The low bits of the hash pick the bucket within the shard.
+    return get_intern_table_shards ()[(a_hash >> 16)
+                                      % NB_INTERN_TABLE_SHARDS];
+}
+
+InternedString::Entry*
+InternedString::intern (const char *a_str, size_t a_len)
+{
+    if (!a_len)
+        return 0;
+
+    size_t hash = hash_bytes (a_str, a_len);
+    InternTableShard &shard = get_intern_table_shard (hash);
+    Glib::Mutex::Lock lock (shard.mutex);
+    InternTableShard::Table::const_iterator it =
+        shard.table.find (StringBytes (a_str, a_len, hash));
+    if (it != shard.table.end ()) {
+        ref (it->second);
+        return it->second;
+    }
+
+    Entry *entry = new Entry;
+    entry->str = std::string (a_str, a_len);
+    entry->hash = hash;
+    entry->refcount = 1;
+    shard.table.insert (std::make_pair (StringBytes (entry->str.raw ().data (),
+                                                     a_len,
+                                                     hash),
+                                        entry));
+    return entry;
+}
+
+void
+InternedString::ref (Entry *a_entry)
+{
+    g_atomic_int_inc (&a_entry->refcount);
+}
+
+void
+InternedString::unref (Entry *a_entry)
+{
+    for (;;) {
+        int refcount = g_atomic_int_get (&a_entry->refcount);
+        if (refcount <= 1)
+            break;
+        if (g_atomic_int_compare_and_exchange (&a_entry->refcount,
+                                               refcount, refcount - 1))
+            return;
+    }
+
+    // This might be the last handle on the entry.  Drop it with the
+    // shard locked, so that no lookup hands the entry out meanwhile.
+    InternTableShard &shard = get_intern_table_shard (a_entry->hash);
+    {
+        Glib::Mutex::Lock lock (shard.mutex);
+        if (!g_atomic_int_dec_and_test (&a_entry->refcount))
+            return;
+        shard.table.erase (StringBytes (a_entry->str.raw ().data (),
+                                        a_entry->str.raw ().size (),
+                                        a_entry->hash));
+    }
+    delete a_entry;
+}
+
+const UString&
+InternedString::empty_string ()
+{
+    static const UString *s_empty = new UString;
+    return *s_empty;
+}
+
+size_t
+InternedString::table_size ()
+{
+    size_t size = 0;
+    for (int i = 0; i < NB_INTERN_TABLE_SHARDS; ++i) {
+        InternTableShard &shard = get_intern_table_shards ()[i];
+        Glib::Mutex::Lock lock (shard.mutex);
+        size += shard.table.size ();
+    }
+    return size;
+}
+
+NEMIVER_END_NAMESPACE (common)
+NEMIVER_END_NAMESPACE (nemiver)
@@ -0,0 +1,142 @@
+/*
+ *This file is part of the Nemiver project
+ *
+ *Nemiver is free software; you can redistribute
+ *it and/or modify it under the terms of
+ *the GNU General Public License as published by the
+ *Free Software Foundation; either version 2,
+ *or (at your option) any later version.
+ *
+ *Nemiver is distributed in the hope that it will
+ *be useful, but WITHOUT ANY WARRANTY;
+ *without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *See the GNU General Public License for more details.
+ *
+ *You should have received a copy of the
+ *GNU General Public License along with Nemiver;
+ *see the file COPYING.
+ *If not, write to the Free Software Foundation,
+ *Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *See COPYRIGHT file copyright information.
+ */
+#ifndef __NMV_INTERNED_STRING_H__
+#define __NMV_INTERNED_STRING_H__
+#include <cstring>
+#include <string>
+#include "nmv-namespace.h"
+#include "nmv-api-macros.h"
+#include "nmv-ustring.h"
+
+NEMIVER_BEGIN_NAMESPACE (nemiver)
+NEMIVER_BEGIN_NAMESPACE (common)
+
+/// A handle on a string stored once for the whole process.
+///
+/// The names of functions, types and files are copied into a lot of
+/// frames, variables and breakpoints, but there are few different
+/// ones. An InternedString is a counted reference to an entry of a
+/// process wide table of strings: copying it doesn't copy the string,
+/// and two InternedStrings are equal if and only if they refer to the
+/// same entry. An entry is removed from the table when its last
+/// handle goes away.
+///
+/// Interning a string looks it up in the table, so it is not done
+/// implicitly for C strings.
+class NEMIVER_API InternedString
+{
+    struct Entry {
+        UString str;
+        size_t hash;
+        // Only changed with atomic operations.
+        volatile int refcount;
+    };
+
+    // Null for the empty string.
+    Entry *m_entry;
+
+    static Entry* intern (const char *a_str, size_t a_len);
+    static void ref (Entry *a_entry);
+    static void unref (Entry *a_entry);
+    static const UString& empty_string ();
+
+    friend struct InternTableShard;
+
+public:
+    InternedString () : m_entry (0) {}
+    InternedString (const UString &a_str) :
+        m_entry (intern (a_str.raw ().data (), a_str.raw ().size ()))
+    {
+    }
+    InternedString (const std::string &a_str) :
+        m_entry (intern (a_str.data (), a_str.size ()))
+    {
+    }
+    explicit InternedString (const char *a_str) :
+        m_entry (intern (a_str, a_str ? strlen (a_str) : 0))
+    {
+    }
+    InternedString (const InternedString &a) :
+        m_entry (a.m_entry)
+    {
+        if (m_entry)
+            ref (m_entry);
+    }
+    ~InternedString ()
+    {
+        if (m_entry)
+            unref (m_entry);
+    }
+
+    InternedString& operator= (const InternedString &a)
+    {
+        if (m_entry != a.m_entry) {
+            if (a.m_entry)
+                ref (a.m_entry);
+            if (m_entry)
+                unref (m_entry);
+            m_entry = a.m_entry;
+        }
+        return *this;
+    }
+
+    const UString& str () const
+    {
+        return m_entry ? m_entry->str : empty_string ();
+    }
+    const std::string& raw () const {return str ().raw ();}
+    operator const UString& () const {return str ();}
+    bool empty () const {return !m_entry;}
+    void clear ()
+    {
+        if (m_entry)
+            unref (m_entry);
+        m_entry = 0;
+    }
+
+    bool operator== (const InternedString &a) const
+    {
+        return m_entry == a.m_entry;
+    }
+    bool operator!= (const InternedString &a) const
+    {
+        return m_entry != a.m_entry;
+    }
+
+    /// \return the number of strings of the table.
+    static size_t table_size ();
+};// end class InternedString
+
+template<class Stream>
+Stream&
+operator<< (Stream &a_os, const InternedString &a)
+{
+    a_os << a.str ();
+    return a_os;
+}
+
+NEMIVER_END_NAMESPACE (common)
+NEMIVER_END_NAMESPACE (nemiver)
+
+#endif //__NMV_INTERNED_STRING_H__
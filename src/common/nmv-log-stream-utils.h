@@ -81,12 +81,26 @@ LOG_STREAM << LOG_LEVEL_NORMAL___ << LOG_MARKER_INFO << HERE << message << nemiv
 LOG_STREAM << LOG_LEVEL_NORMAL___ << LOG_MARKER_INFO << message << nemiver::common::endl
 #endif
 
+/// Tests whether the log site @site can log against @domain at
+/// @level. @domain is only evaluated when the answer cached by the
+/// site is stale, so a disabled site costs a single test.
+#ifndef LOG_SITE_ENABLED
+#define LOG_SITE_ENABLED(site, domain, level)                   \
+    (!(site).is_disabled ()                                     \
+     && ((site).is_enabled () || (site).update ((domain), (level))))
+#endif
+
 #ifndef LOG_D
-#define LOG_D(message, domain)                  \
-    do {                                        \
-        LOG_STREAM.push_domain (domain);        \
-        LOG (message) ;                         \
-        LOG_STREAM.pop_domain ();               \
+#define LOG_D(message, domain)                                          \
+    do {                                                                \
+        static nemiver::common::LogSite log_site;                       \
+        if (LOG_SITE_ENABLED                                            \
+            (log_site, domain,                                          \
+             nemiver::common::LogStream::LOG_LEVEL_NORMAL)) {           \
+            LOG_STREAM.push_domain (domain);                            \
+            LOG (message) ;                                             \
+            LOG_STREAM.pop_domain ();                                   \
+        }                                                               \
     } while (false)
 #endif
 
@@ -105,11 +119,16 @@ LOG_STREAM << LOG_LEVEL_NORMAL___ << LOG_MARKER_EXCEPTION << HERE << message <<
 #endif
 
 #ifndef LOG_ERROR_D
-#define LOG_ERROR_D(message, domain)            \
-    do {                                        \
-        LOG_STREAM.push_domain (domain);        \
-        LOG_ERROR (message) ;                   \
-        LOG_STREAM.pop_domain() ;               \
+#define LOG_ERROR_D(message, domain)                                    \
+    do {                                                                \
+        static nemiver::common::LogSite log_site;                       \
+        if (LOG_SITE_ENABLED                                            \
+            (log_site, domain,                                          \
+             nemiver::common::LogStream::LOG_LEVEL_NORMAL)) {           \
+            LOG_STREAM.push_domain (domain);                            \
+            LOG_ERROR (message) ;                                       \
+            LOG_STREAM.pop_domain() ;                                   \
+        }                                                               \
     } while (false)
 #endif
 
@@ -141,10 +160,18 @@ nemiver::common::ScopeLogger scope_logger (scopename, nemiver::common::LogStream
 nemiver::common::ScopeLogger scope_logger (scopename, nemiver::common::LogStream::LOG_LEVEL_NORMAL);
 #endif
 
+#ifndef LOG_SCOPE_SITE_D
+#define LOG_SCOPE_SITE_D(scopename, level, domain)                      \
+static nemiver::common::LogSite scope_log_site;                         \
+nemiver::common::ScopeSiteLogger scope_logger;                          \
+if (LOG_SITE_ENABLED (scope_log_site, domain, level))                   \
+    scope_logger.start (scopename, level, domain);
+#endif
+
 #ifndef LOG_SCOPE_D
 #define LOG_SCOPE_D(scopename, domain) \
-nemiver::common::ScopeLogger scope_logger \
-        (scopename, nemiver::common::LogStream::LOG_LEVEL_VERBOSE, domain);
+LOG_SCOPE_SITE_D (scopename, \
+                  nemiver::common::LogStream::LOG_LEVEL_VERBOSE, domain)
 #endif
 
 #ifndef LOG_SCOPE_NORMAL
@@ -154,8 +181,8 @@ nemiver::common::ScopeLogger scope_logger (scopename, nemiver::common::LogStream
 
 #ifndef LOG_SCOPE_NORMAL_D
 #define LOG_SCOPE_NORMAL_D(scopename, domain) \
-nemiver::common::ScopeLogger scope_logger \
-    (scopename, nemiver::common::LogStream::LOG_LEVEL_NORMAL, domain);
+LOG_SCOPE_SITE_D (scopename, \
+                  nemiver::common::LogStream::LOG_LEVEL_NORMAL, domain)
 #endif
 
 #ifndef LOG_FUNCTION_SCOPE
@@ -28,10 +28,13 @@
  *
  */
 #include "config.h"
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <sys/time.h>
 #include <iostream>
 #include <list>
+#include <map>
 #include <vector>
 #include <fstream>
 #include <glibmm.h>
@@ -56,6 +59,26 @@ static enum LogStream::StreamType s_stream_type = LogStream::COUT_STREAM;
 static enum LogStream::LogLevel s_level_filter = LogStream::LOG_LEVEL_NORMAL;
 static bool s_is_active = true;
 
+// The sites of the logging macros that cached an answer, and the
+// mutex that serializes their updates against the changes of the
+// filters. The mutex is never destroyed, so that streams logging
+// from static destructors can still use it.
+static LogSite *s_log_sites = 0;
+
+static Glib::Mutex&
+get_log_sites_mutex ()
+{
+    static Glib::Mutex *s_log_sites_mutex = new Glib::Mutex;
+    return *s_log_sites_mutex;
+}
+
+static void
+reset_log_sites_unlocked ()
+{
+    for (LogSite *site = s_log_sites; site; site = site->next)
+        g_atomic_int_set (&site->state, LogSite::STATE_UNKNOWN);
+}
+
 /// the base class of the destination
 /// of the messages send to a stream.
 /// each log stream uses a particular
@@ -80,26 +103,32 @@ public:
 
     virtual ~LogSink () {}
 
-    bool bad () const
+    virtual bool bad () const
     {
         Glib::Mutex::Lock lock (m_ostream_mutex);
         return m_out->bad ();
     }
 
-    bool good () const
+    virtual bool good () const
     {
         Glib::Mutex::Lock lock (m_ostream_mutex);
         return m_out->good ();
     }
 
-    void flush ()
+    virtual void flush ()
     {
         if (!m_out) throw runtime_error ("underlying ostream not initialized");
         Glib::Mutex::Lock lock (m_ostream_mutex);
         m_out->flush ();
     }
 
-    LogSink& write (const char *a_buf, long a_buflen)
+    /// Called at the end of each line logged with endl.
+    virtual void end_line ()
+    {
+        flush ();
+    }
+
+    virtual LogSink& write (const char *a_buf, long a_buflen)
     {
         if (!m_out) throw runtime_error ("underlying ostream not initialized");
         Glib::Mutex::Lock lock (m_ostream_mutex);
@@ -107,7 +136,7 @@ public:
         return *this;
     }
 
-    LogSink& operator<< (const Glib::ustring &a_string)
+    virtual LogSink& operator<< (const Glib::ustring &a_string)
     {
         if (!m_out) throw runtime_error ("underlying ostream not initialized");
         Glib::Mutex::Lock lock (m_ostream_mutex);
@@ -115,7 +144,7 @@ public:
         return *this;
     }
 
-    LogSink& operator<< (int an_int)
+    virtual LogSink& operator<< (int an_int)
     {
         if (!m_out) throw runtime_error ("underlying ostream not initialized");
         Glib::Mutex::Lock lock (m_ostream_mutex);
@@ -123,7 +152,7 @@ public:
         return *this;
     }
 
-    LogSink& operator<< (double a_double)
+    virtual LogSink& operator<< (double a_double)
     {
         if (!m_out) throw runtime_error ("underlying ostream not initialized");
         Glib::Mutex::Lock lock (m_ostream_mutex);
@@ -131,7 +160,7 @@ public:
         return *this;
     }
 
-    LogSink& operator<< (char a_char)
+    virtual LogSink& operator<< (char a_char)
     {
         if (!m_out) throw runtime_error ("underlying ostream not initialized");
         Glib::Mutex::Lock lock (m_ostream_mutex);
@@ -198,8 +227,392 @@ public:
 };//end class OfstreamLogSink
 
 typedef SafePtr<LogSink, ObjectRef, ObjectUnref> LogSinkSafePtr;
+
+/// A sink that hands the messages over to a writer thread, which
+/// writes them to a target sink by batches.
+///
+/// The messages go through a bounded queue that the logging threads
+/// fill without taking any lock. Each thread gathers the pieces of
+/// the message it is writing until the message ends with a new line
+/// or is flushed, so that the queue holds whole messages: the
+/// messages of different threads don't get mixed, and the messages
+/// are dropped as a whole. When the queue is full, the
+/// messages are either dropped, in which case the writer reports how
+/// many were lost, or the logging thread waits for the writer to
+/// make room. The only lock is taken to wake the writer up, when it
+/// sleeps because the queue was empty.
+///
+/// The messages a thread is writing are released when the thread
+/// exits.  Unfinished messages are then queued to their sinks, if
+/// these are still alive.
+class AsyncLogSink : public LogSink {
+public:
+    enum OverflowPolicy {
+        DROP_ON_OVERFLOW,
+        BLOCK_ON_OVERFLOW
+    };
+
+private:
+    // The maximum number of bytes the writer gathers before writing
+    // them to the target sink.
+    enum {MAX_BATCH_SIZE = 64 * 1024};
+
+    // A cell of the queue. Its sequence number tells whether it is
+    // free for the producer at a given position, or filled for the
+    // consumer at a given position.
+    struct Slot {
+        volatile gint sequence;
+        std::string data;
+    };
+
+    LogSinkSafePtr m_target;
+    OverflowPolicy m_policy;
+    std::vector<Slot> m_slots;
+    guint m_mask;
+    // The next position to fill, shared by the producers.
+    volatile gint m_enqueue_pos;
+    // The next position to empty, only used by the writer.
+    guint m_dequeue_pos;
+    // The position up to which the messages are written to the
+    // target.  Updated with m_wakeup_mutex held.
+    volatile gint m_written_pos;
+    volatile gint m_nb_dropped;
+    mutable volatile gint m_is_bad;
+    volatile gint m_is_stopping;
+    volatile gint m_writer_is_waiting;
+    // Identifies the sink in the messages pending in each thread.
+    gint m_id;
+    Glib::Mutex m_wakeup_mutex;
+    Glib::Cond m_wakeup_cond;
+    // Signalled when the writer has written a batch.
+    Glib::Cond m_written_cond;
+    Glib::Thread *m_writer;
+
+    // The messages a thread is writing to the asynchronous sinks and
+    // has not queued yet, indexed by the ids of the sinks.
+    typedef std::map<gint, std::string> PendingMessages;
+
+    //non copyable
+    AsyncLogSink (const AsyncLogSink &);
+    AsyncLogSink& operator= (const AsyncLogSink &);
+
+    bool try_enqueue (std::string &a_data)
+    {
+        guint pos = g_atomic_int_get (&m_enqueue_pos);
+        Slot *slot = 0;
+        for (;;) {
+            slot = &m_slots[pos & m_mask];
+            guint seq = g_atomic_int_get (&slot->sequence);
+            gint diff = (gint) (seq - pos);
+            if (diff == 0) {
+                if (g_atomic_int_compare_and_exchange (&m_enqueue_pos,
+                                                       (gint) pos,
+                                                       (gint) (pos + 1)))
+                    break;
+                pos = g_atomic_int_get (&m_enqueue_pos);
+            } else if (diff < 0) {
+                // The slot still holds the data of the previous lap:
+                // the queue is full.
+                return false;
+            } else {
+                pos = g_atomic_int_get (&m_enqueue_pos);
+            }
+        }
+        slot->data.swap (a_data);
+        g_atomic_int_set (&slot->sequence, (gint) (pos + 1));
+        return true;
+    }
+
+    bool try_dequeue (std::string &a_data)
+    {
+        Slot &slot = m_slots[m_dequeue_pos & m_mask];
+        guint seq = g_atomic_int_get (&slot.sequence);
+        if ((gint) (seq - (m_dequeue_pos + 1)) < 0)
+            return false;
+        a_data.swap (slot.data);
+        slot.data.clear ();
+        g_atomic_int_set (&slot.sequence,
+                          (gint) (m_dequeue_pos + m_mask + 1));
+        ++m_dequeue_pos;
+        return true;
+    }
+
+    bool is_empty ()
+    {
+        Slot &slot = m_slots[m_dequeue_pos & m_mask];
+        guint seq = g_atomic_int_get (&slot.sequence);
+        return (gint) (seq - (m_dequeue_pos + 1)) < 0;
+    }
+
+    void wake_writer_up ()
+    {
+        if (!g_atomic_int_get (&m_writer_is_waiting))
+            return;
+        Glib::Mutex::Lock lock (m_wakeup_mutex);
+        m_wakeup_cond.signal ();
+    }
+
+    void push (std::string &a_data)
+    {
+        while (!try_enqueue (a_data)) {
+            if (m_policy == DROP_ON_OVERFLOW) {
+                g_atomic_int_inc (&m_nb_dropped);
+                a_data.clear ();
+                break;
+            }
+            wake_writer_up ();
+            g_thread_yield ();
+        }
+        wake_writer_up ();
+    }
+
+    /// \return the messages of the calling thread.  They are
+    /// released by release_pending_messages when the thread exits.
+    /// The main thread keeps them until the end of the process.
+    static PendingMessages& get_pending_messages ()
+    {
+        static Glib::StaticPrivate<PendingMessages> s_messages =
+            GLIBMM_STATIC_PRIVATE_INIT;
+        PendingMessages *messages = s_messages.get ();
+        if (!messages) {
+            messages = new PendingMessages;
+            s_messages.set (messages, &release_pending_messages);
+        }
+        return *messages;
+    }
+
+    /// The live sinks, indexed by their ids.  Never destroyed, as
+    /// threads can exit after the static destructors ran.
+    static std::map<gint, AsyncLogSink*>& get_live_sinks ()
+    {
+        static std::map<gint, AsyncLogSink*> *s_sinks =
+            new std::map<gint, AsyncLogSink*>;
+        return *s_sinks;
+    }
+
+    static Glib::Mutex& get_live_sinks_mutex ()
+    {
+        static Glib::Mutex *s_mutex = new Glib::Mutex;
+        return *s_mutex;
+    }
+
+    /// Runs when a thread exits.  Queue the messages the thread left
+    /// unfinished, and free them.
+    static void release_pending_messages (void *a_messages)
+    {
+        PendingMessages *messages = static_cast<PendingMessages*> (a_messages);
+        {
+            Glib::Mutex::Lock lock (get_live_sinks_mutex ());
+            std::map<gint, AsyncLogSink*> &sinks = get_live_sinks ();
+            for (PendingMessages::iterator it = messages->begin ();
+                 it != messages->end ();
+                 ++it) {
+                std::map<gint, AsyncLogSink*>::iterator sink =
+                    sinks.find (it->first);
+                if (sink != sinks.end () && !it->second.empty ())
+                    sink->second->push (it->second);
+            }
+        }
+        delete messages;
+    }
+
+    /// \return the message the calling thread is writing to the
+    /// sink, that is not queued yet.
+    std::string& get_pending_message ()
+    {
+        return get_pending_messages ()[m_id];
+    }
+
+    void append (const char *a_buf, long a_buflen)
+    {
+        if (a_buflen <= 0)
+            return;
+        std::string &message = get_pending_message ();
+        message.append (a_buf, a_buflen);
+        if (a_buf[a_buflen - 1] == '\n')
+            push (message);
+    }
+
+    /// Runs in the writer thread.
+    void write_messages ()
+    {
+        std::string batch, data;
+        for (;;) {
+            // Read the stop request before draining the queue, so
+            // that what was queued before the request gets written.
+            bool is_stopping = g_atomic_int_get (&m_is_stopping);
+
+            batch.clear ();
+            while (batch.size () < MAX_BATCH_SIZE && try_dequeue (data))
+                batch += data;
+
+            gint nb_dropped = g_atomic_int_get (&m_nb_dropped);
+            if (nb_dropped) {
+                g_atomic_int_add (&m_nb_dropped, -nb_dropped);
+                char buf[64];
+                snprintf (buf, sizeof (buf),
+                          "|W|dropped %d log messages\n", nb_dropped);
+                batch += buf;
+            }
+
+            if (!batch.empty ()) {
+                m_target->write (batch.data (), batch.size ());
+                m_target->flush ();
+                if (m_target->bad ())
+                    g_atomic_int_set (&m_is_bad, 1);
+                Glib::Mutex::Lock lock (m_wakeup_mutex);
+                g_atomic_int_set (&m_written_pos, (gint) m_dequeue_pos);
+                m_written_cond.broadcast ();
+                continue;
+            }
+            if (is_stopping)
+                break;
+
+            Glib::Mutex::Lock lock (m_wakeup_mutex);
+            g_atomic_int_set (&m_writer_is_waiting, 1);
+            if (is_empty () && !g_atomic_int_get (&m_is_stopping))
+                m_wakeup_cond.wait (m_wakeup_mutex);
+            g_atomic_int_set (&m_writer_is_waiting, 0);
+        }
+    }
+
+public:
+
+    AsyncLogSink (const LogSinkSafePtr &a_target,
+                  OverflowPolicy a_policy,
+                  unsigned a_capacity) :
+        LogSink (0),
+        m_target (a_target),
+        m_policy (a_policy),
+        m_mask (0),
+        m_enqueue_pos (0),
+        m_dequeue_pos (0),
+        m_written_pos (0),
+        m_nb_dropped (0),
+        m_is_bad (0),
+        m_is_stopping (0),
+        m_writer_is_waiting (0),
+        m_writer (0)
+    {
+        static volatile gint s_last_id = 0;
+        m_id = g_atomic_int_add (&s_last_id, 1);
+
+        THROW_IF_FAIL (m_target);
+
+        // The target is then used by the writer thread, and the sink
+        // can be released by any of the logging threads.
+        enable_atomic_refcount ();
+        m_target->enable_atomic_refcount ();
+
+        // The capacity is rounded up to a power of two, so that
+        // positions map to slots with a mask.
+        guint nb_slots = 2;
+        while (nb_slots < a_capacity && nb_slots < (1u << 30))
+            nb_slots <<= 1;
+        m_slots.resize (nb_slots);
+        m_mask = nb_slots - 1;
+        for (guint i = 0; i < nb_slots; ++i)
+            m_slots[i].sequence = i;
+
+        m_writer = Glib::Thread::create
+            (sigc::mem_fun (*this, &AsyncLogSink::write_messages),
+             true /*joinable*/);
+
+        Glib::Mutex::Lock lock (get_live_sinks_mutex ());
+        get_live_sinks ()[m_id] = this;
+    }
+
+    virtual ~AsyncLogSink ()
+    {
+        {
+            Glib::Mutex::Lock lock (get_live_sinks_mutex ());
+            get_live_sinks ().erase (m_id);
+        }
+        end_line ();
+        get_pending_messages ().erase (m_id);
+        g_atomic_int_set (&m_is_stopping, 1);
+        {
+            Glib::Mutex::Lock lock (m_wakeup_mutex);
+            m_wakeup_cond.signal ();
+        }
+        if (m_writer)
+            m_writer->join ();
+        m_writer = 0;
+    }
+
+    bool bad () const
+    {
+        return g_atomic_int_get (&m_is_bad);
+    }
+
+    bool good () const
+    {
+        return !bad ();
+    }
+
+    /// Queues the message the calling thread is writing. The writer
+    /// flushes the target after each batch: don't make the logging
+    /// threads wait for it.
+    void end_line ()
+    {
+        std::string &message = get_pending_message ();
+        if (!message.empty ())
+            push (message);
+    }
+
+    /// Queues the message the calling thread is writing, and waits
+    /// until the writer has written it to the target, along with the
+    /// messages queued before it.
+    void flush ()
+    {
+        end_line ();
+        guint pos = g_atomic_int_get (&m_enqueue_pos);
+        Glib::Mutex::Lock lock (m_wakeup_mutex);
+        while ((gint) (g_atomic_int_get (&m_written_pos) - pos) < 0) {
+            m_wakeup_cond.signal ();
+            m_written_cond.wait (m_wakeup_mutex);
+        }
+    }
+
+    LogSink& write (const char *a_buf, long a_buflen)
+    {
+        append (a_buf, a_buflen);
+        return *this;
+    }
+
+    LogSink& operator<< (const Glib::ustring &a_string)
+    {
+        append (a_string.raw ().data (), a_string.raw ().size ());
+        return *this;
+    }
+
+    LogSink& operator<< (int an_int)
+    {
+        char buf[16];
+        snprintf (buf, sizeof (buf), "%d", an_int);
+        return write (buf, strlen (buf));
+    }
+
+    LogSink& operator<< (double a_double)
+    {
+        // The default formatting of std::ostream.
+        char buf[32];
+        snprintf (buf, sizeof (buf), "%g", a_double);
+        return write (buf, strlen (buf));
+    }
+
+    LogSink& operator<< (char a_char)
+    {
+        return write (&a_char, 1);
+    }
+};//end class AsyncLogSink
+
 struct LogStream::Priv
 {
+    // The default number of messages the queue of an asynchronous
+    // sink can hold.
+    enum {DEFAULT_ASYNC_CAPACITY = 16384};
+
     enum LogStream::StreamType stream_type;
     LogSinkSafePtr sink;
 
@@ -251,6 +664,12 @@ struct LogStream::Priv
     }
 
     bool is_logging_allowed (const std::string &a_domain)
+    {
+        return is_logging_allowed (a_domain, level);
+    }
+
+    bool is_logging_allowed (const std::string &a_domain,
+                             enum LogStream::LogLevel a_level)
     {
         if (!LogStream::is_active ())
             return false;
@@ -263,7 +682,7 @@ struct LogStream::Priv
         }
 
         //check log level
-        if (level > s_level_filter) {
+        if (a_level > s_level_filter) {
             return false;
         }
         return true;
@@ -284,6 +703,35 @@ struct LogStream::Priv
         UString domains_str = Glib::locale_to_utf8 (str);
         enabled_domains_from_env = domains_str.split_set (" ,");
     }
+
+    /// Reads NMV_LOG_ASYNC and NMV_LOG_ASYNC_CAPACITY.
+    /// \param a_is_async set to true if the streams are to be
+    /// asynchronous, left untouched otherwise.
+    static void get_async_config_from_env
+                        (bool &a_is_async,
+                         AsyncLogSink::OverflowPolicy &a_policy,
+                         unsigned &a_capacity)
+    {
+        a_policy = AsyncLogSink::DROP_ON_OVERFLOW;
+        a_capacity = DEFAULT_ASYNC_CAPACITY;
+
+        const char *str = g_getenv ("NMV_LOG_ASYNC_CAPACITY");
+        if (str && atoi (str) > 0)
+            a_capacity = atoi (str);
+
+        str = g_getenv ("NMV_LOG_ASYNC");
+        if (!str)
+            return;
+        if (!strcmp (str, "block")) {
+            a_policy = AsyncLogSink::BLOCK_ON_OVERFLOW;
+            a_is_async = true;
+        } else if (!strcmp (str, "drop")) {
+            a_is_async = true;
+        } else {
+            g_warning ("NMV_LOG_ASYNC should be 'drop' or 'block', "
+                       "not '%s'", str);
+        }
+    }
 }
 ;//end LogStream::Priv
 
@@ -316,6 +764,7 @@ void
 LogStream::set_log_level_filter (enum LogLevel a_level)
 {
     s_level_filter = a_level;
+    LogSite::reset_all ();
 }
 
 void
@@ -329,6 +778,7 @@ void
 LogStream::activate (bool a_activate)
 {
     s_is_active = a_activate;
+    LogSite::reset_all ();
 }
 
 bool
@@ -350,17 +800,32 @@ LogStream::LogStream (enum LogLevel a_level,
 {
 
     std::string file_path;
-    if (get_stream_type () == FILE_STREAM) {
+    bool is_async = false;
+    AsyncLogSink::OverflowPolicy policy = AsyncLogSink::DROP_ON_OVERFLOW;
+    unsigned capacity = 0;
+    LogStream::Priv::get_async_config_from_env (is_async, policy, capacity);
+
+    StreamType type = get_stream_type ();
+    if (type == ASYNC_FILE_STREAM
+        || type == ASYNC_COUT_STREAM
+        || type == ASYNC_CERR_STREAM)
+        is_async = true;
+
+    if (type == FILE_STREAM || type == ASYNC_FILE_STREAM) {
         m_priv->sink = LogSinkSafePtr
             (new OfstreamLogSink (get_stream_file_path ()));
-    } else if (get_stream_type () == COUT_STREAM) {
+    } else if (type == COUT_STREAM || type == ASYNC_COUT_STREAM) {
         m_priv->sink = LogSinkSafePtr (new CoutLogSink);
-    } else if (get_stream_type () == CERR_STREAM) {
+    } else if (type == CERR_STREAM || type == ASYNC_CERR_STREAM) {
         m_priv->sink = LogSinkSafePtr (new CerrLogSink);
     } else {
         g_critical ("LogStream type not supported");
         throw Exception ("LogStream type not supported");
     }
+    if (is_async) {
+        m_priv->sink = LogSinkSafePtr
+            (new AsyncLogSink (m_priv->sink, policy, capacity));
+    }
     m_priv->stream_type = get_stream_type ();
     m_priv->level = a_level;
     m_priv->load_enabled_domains_from_env ();
@@ -384,11 +849,13 @@ void
 LogStream::enable_domain (const string &a_domain,
                           bool a_do_enable)
 {
+    Glib::Mutex::Lock lock (get_log_sites_mutex ());
     if (a_do_enable) {
         m_priv->allowed_domains[a_domain.c_str ()] = true;
     } else {
         m_priv->allowed_domains.erase (a_domain.c_str ());
     }
+    reset_log_sites_unlocked ();
 }
 
 bool
@@ -401,6 +868,13 @@ LogStream::is_domain_enabled (const std::string &a_domain)
     return false;
 }
 
+bool
+LogStream::is_logging_allowed (const string &a_domain,
+                               enum LogLevel a_level)
+{
+    return m_priv->is_logging_allowed (a_domain, a_level);
+}
+
 LogStream&
 LogStream::write (const char* a_buf, long a_buflen, const string &a_domain)
 {
@@ -543,6 +1017,32 @@ LogStream::operator<< (LogStream& (*a_manipulator) (LogStream &))
     return *this;
 }
 
+bool
+LogSite::update (const string &a_domain,
+                 enum LogStream::LogLevel a_level)
+{
+    // Get the default stream before locking, as building it enables
+    // the domains set in the environment.
+    LogStream &stream = LogStream::default_log_stream ();
+
+    Glib::Mutex::Lock lock (get_log_sites_mutex ());
+    bool allowed = stream.is_logging_allowed (a_domain, a_level);
+    if (!is_registered) {
+        next = s_log_sites;
+        s_log_sites = this;
+        is_registered = true;
+    }
+    g_atomic_int_set (&state, allowed ? STATE_ENABLED : STATE_DISABLED);
+    return allowed;
+}
+
+void
+LogSite::reset_all ()
+{
+    Glib::Mutex::Lock lock (get_log_sites_mutex ());
+    reset_log_sites_unlocked ();
+}
+
 LogStream&
 timestamp (LogStream &a_stream)
 {
@@ -571,7 +1071,7 @@ endl (LogStream &a_stream)
         return a_stream;
 
     a_stream  << '\n';
-    a_stream << flush ;
+    a_stream.m_priv->sink->end_line ();
     return a_stream;
 }
 
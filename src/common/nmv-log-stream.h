@@ -30,6 +30,7 @@
 #ifndef __NMV_LOG_STREAM_H__
 #define __NMV_LOG_STREAM_H__
 #include <string>
+#include <glib.h>
 #include "nmv-api-macros.h"
 #include "nmv-ustring.h"
 #include "nmv-safe-ptr.h"
@@ -77,6 +78,12 @@ public:
         RFU0,//reserved for future usage
         RFU1,
         RFU2,
+        // The asynchronous variants of the streams above: the logging
+        // threads hand the messages over to a writer thread through a
+        // bounded queue, instead of writing them themselves.
+        ASYNC_FILE_STREAM,
+        ASYNC_COUT_STREAM,
+        ASYNC_CERR_STREAM
     };
 
     enum LogLevel {
@@ -87,6 +94,14 @@ public:
     /// \brief set the type of all the log streams that will be instanciated
     ///(either cout, cerr, or log file). By default, the type of stream is
     /// set to COUT_STREAM. All the logs are sent to stdout.
+    ///
+    /// Setting the NMV_LOG_ASYNC environment variable to "drop" or
+    /// "block" makes the streams asynchronous, as if the ASYNC_*
+    /// variant of their type had been set. It also sets what happens
+    /// when the queue of an asynchronous stream is full: the messages
+    /// are either dropped, or the logging threads wait for the writer
+    /// thread. The default is to drop. NMV_LOG_ASYNC_CAPACITY sets the
+    /// number of messages the queue can hold.
     /// \param a_type the type of the log stream
     static void set_stream_type (enum StreamType a_type);
 
@@ -163,6 +178,11 @@ public:
     /// \return true is logging is enabled for domain @a_domain
     bool is_domain_enabled (const string &a_domain);
 
+    /// \return true if a message of level @a_level logged against
+    /// domain @a_domain would actually be written by this stream.
+    bool is_logging_allowed (const string &a_domain,
+                             enum LogLevel a_level);
+
     /// \brief writes a text string to the stream
     /// \param a_buf the buffer that contains the text string.
     /// \param a_buflen the length of the buffer. If <0, a_buf is
@@ -231,6 +251,52 @@ public:
 
 };//end class LogStream
 
+/// \brief caches, for one call site of the logging macros, whether
+/// the default log stream lets that site log.
+///
+/// A LogSite is meant to be a function local static: it has no
+/// constructor so it is zero initialized at load time, without any
+/// guard, and testing a site that is disabled costs one load and one
+/// branch. The domain of the site is only evaluated when the cached
+/// answer has to be computed, that is the first time the site is
+/// reached and after the domains, the level filter or the activation
+/// of the log streams changed.
+struct NEMIVER_API LogSite
+{
+    enum State {
+        STATE_UNKNOWN = 0,
+        STATE_DISABLED,
+        STATE_ENABLED
+    };
+
+    volatile gint state;
+    // The next site in the list of the sites to reset when a filter
+    // of the log streams changes.
+    LogSite *next;
+    bool is_registered;
+
+    bool is_disabled ()
+    {
+        return g_atomic_int_get (&state) == STATE_DISABLED;
+    }
+
+    bool is_enabled ()
+    {
+        return g_atomic_int_get (&state) == STATE_ENABLED;
+    }
+
+    /// \brief computes and caches whether the site can log.
+    /// \param a_domain the domain the site logs against.
+    /// \param a_level the level the site logs at.
+    /// \return true if the default log stream lets the site log.
+    bool update (const string &a_domain,
+                 enum LogStream::LogLevel a_level);
+
+    /// \brief forget the answers cached by all the sites, so that
+    /// they are computed again the next time the sites are reached.
+    static void reset_all ();
+};//end struct LogSite
+
 /// \brief logs a timestamp. Basically the
 /// the current date. You use it like:
 /// nemiver::LogStream out; out << nemiver::timestamp ;
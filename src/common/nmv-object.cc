@@ -38,25 +38,23 @@ namespace nemiver {
 namespace common {
 
 struct ObjectPriv {
-    long refcount;
-    bool refcount_enabled;
     map<UString, const Object*> objects_map;
-
-    ObjectPriv () :
-        refcount (1),
-        refcount_enabled (true)
-    {}
 };//end struct ObjectPriv
 
 Object::Object ():
-        m_priv (new ObjectPriv ())
+        m_refcount (1),
+        m_refcount_enabled (true),
+        m_atomic_refcount (false)
 {
 }
 
 Object::Object (Object const &a_object):
-        m_priv (new ObjectPriv ())
+        m_refcount (a_object.get_refcount ()),
+        m_refcount_enabled (a_object.m_refcount_enabled),
+        m_atomic_refcount (a_object.m_atomic_refcount)
 {
-    *m_priv = *a_object.m_priv;
+    if (a_object.m_priv)
+        m_priv.reset (new ObjectPriv (*a_object.m_priv));
 }
 
 Object&
@@ -64,7 +62,13 @@ Object::operator= (Object const &a_object)
 {
     if (this == &a_object)
         return *this;
-    *m_priv = *a_object.m_priv;
+    m_refcount = a_object.get_refcount ();
+    m_refcount_enabled = a_object.m_refcount_enabled;
+    m_atomic_refcount = a_object.m_atomic_refcount;
+    if (a_object.m_priv)
+        m_priv.reset (new ObjectPriv (*a_object.m_priv));
+    else
+        m_priv.reset ();
     return *this;
 }
 
@@ -76,19 +80,27 @@ void
 Object::ref ()
 {
     if (!is_refcount_enabled ()) {return;}
-    m_priv->refcount ++;
+    if (m_atomic_refcount)
+        g_atomic_int_inc (&m_refcount);
+    else
+        m_refcount ++;
 }
 
 void
 Object::unref ()
 {
     if (!is_refcount_enabled ()) {return;}
-    if (m_priv && m_priv->refcount) {
-        m_priv->refcount --;
+    if (m_atomic_refcount) {
+        if (g_atomic_int_dec_and_test (&m_refcount))
+            delete this;
+        return;
     }
 
-    if (m_priv && m_priv->refcount <= 0) {
-        m_priv.reset ();
+    if (m_refcount) {
+        m_refcount --;
+    }
+
+    if (m_refcount <= 0) {
         delete this;
     }
 }
@@ -96,31 +108,41 @@ Object::unref ()
 void
 Object::enable_refcount (bool a_enabled)
 {
-    if (m_priv) {
-        m_priv->refcount_enabled = a_enabled;
-    }
+    m_refcount_enabled = a_enabled;
 }
 
 bool
 Object::is_refcount_enabled () const
 {
-    bool res (true);
-    if (m_priv) {
-        res = m_priv->refcount_enabled;
-    }
-    return res;
+    return m_refcount_enabled;
+}
+
+void
+Object::enable_atomic_refcount (bool a_enabled)
+{
+    m_atomic_refcount = a_enabled;
+}
+
+bool
+Object::is_atomic_refcount_enabled () const
+{
+    return m_atomic_refcount;
 }
 
 long
 Object::get_refcount () const
 {
-    return m_priv->refcount;
+    if (m_atomic_refcount)
+        return g_atomic_int_get (&m_refcount);
+    return m_refcount;
 }
 
 void
 Object::attach_object (const UString &a_key,
                        const Object *a_object)
 {
+    if (!m_priv)
+        m_priv.reset (new ObjectPriv);
     m_priv->objects_map[a_key] = a_object;
 }
 
@@ -128,6 +150,9 @@ bool
 Object::get_attached_object (const UString &a_key,
                              const Object *&a_object)
 {
+    if (!m_priv) {
+        return false;
+    }
     map<UString, const Object*>::const_iterator it =
                                     m_priv->objects_map.find (a_key);
     if (it == m_priv->objects_map.end ()) {
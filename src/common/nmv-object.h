@@ -30,6 +30,7 @@
 #ifndef __NMV_OBJECT_H__
 #define __NMV_OBJECT_H__
 
+#include <glib.h>
 #include "nmv-api-macros.h"
 #include "nmv-namespace.h"
 #include "nmv-safe-ptr.h"
@@ -43,6 +44,13 @@ class UString;
 class NEMIVER_API Object {
     friend struct ObjectPriv;
 
+    // The refcount lives in the object itself, and the table of the
+    // attached objects is only allocated when an object is first
+    // attached, so that building an Object allocates nothing.
+    mutable volatile gint m_refcount;
+    bool m_refcount_enabled;
+    bool m_atomic_refcount;
+
 protected:
     SafePtr<ObjectPriv> m_priv;
 
@@ -64,6 +72,15 @@ public:
 
     bool is_refcount_enabled () const;
 
+    /// \brief make ref and unref atomic operations.
+    ///
+    /// By default, the refcount is not protected against concurrent
+    /// updates. Objects that are referenced from several threads must
+    /// enable the atomic refcount before they are shared.
+    void enable_atomic_refcount (bool a_enabled=true);
+
+    bool is_atomic_refcount_enabled () const;
+
     long get_refcount () const;
 
     void attach_object (const UString &a_key,
@@ -28,7 +28,13 @@
  *
  */
 #include "config.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <unistd.h>
 #include <glibmm.h>
+#include <glibmm/thread.h>
 #include "nmv-exception.h"
 #include "nmv-ustring.h"
 #include "nmv-scope-logger.h"
@@ -39,6 +45,135 @@ namespace common {
 
 static const UString DELETE ("delete");
 
+/// Writes the begin and end events of the scopes to a file, in the
+/// Chrome trace event format, so that they can be looked at in a trace
+/// viewer: a JSON array of events, one event per line.
+class ScopeTracer
+{
+    Glib::Mutex m_mutex;
+    std::ofstream m_out;
+    bool m_is_first_event;
+    volatile gint m_is_active;
+
+    //forbid copy/assignation
+    ScopeTracer (ScopeTracer const &);
+    ScopeTracer& operator= (ScopeTracer const &);
+
+    static void append_escaped (std::string &a_out, const std::string &a_str)
+    {
+        for (std::string::const_iterator c = a_str.begin ();
+             c != a_str.end ();
+             ++c) {
+            if (*c == '"' || *c == '\\') {
+                a_out += '\\';
+                a_out += *c;
+            } else if ((unsigned char) *c < 0x20) {
+                char buf[8];
+                snprintf (buf, sizeof (buf), "\\u%04x", (unsigned char) *c);
+                a_out += buf;
+            } else {
+                a_out += *c;
+            }
+        }
+    }
+
+public:
+
+    ScopeTracer () :
+        m_is_first_event (true),
+        m_is_active (0)
+    {
+        const char *path = g_getenv ("NMV_TRACE_FILE");
+        if (path && *path)
+            start (path);
+    }
+
+    static void stop_at_exit ()
+    {
+        get ().stop ();
+    }
+
+    /// The tracer is never destroyed, so that the scopes ending in
+    /// static destructors can still use it; its file is closed at
+    /// exit.
+    static ScopeTracer* create ()
+    {
+        ScopeTracer *tracer = new ScopeTracer;
+        atexit (stop_at_exit);
+        return tracer;
+    }
+
+    static ScopeTracer& get ()
+    {
+        static ScopeTracer *s_tracer = create ();
+        return *s_tracer;
+    }
+
+    bool is_active ()
+    {
+        return g_atomic_int_get (&m_is_active);
+    }
+
+    bool start (const std::string &a_path)
+    {
+        Glib::Mutex::Lock lock (m_mutex);
+        if (m_out.is_open ())
+            return false;
+        m_out.open (a_path.c_str (), std::ios::out | std::ios::trunc);
+        if (!m_out.good ()) {
+            m_out.close ();
+            return false;
+        }
+        m_out << "[\n";
+        m_is_first_event = true;
+        g_atomic_int_set (&m_is_active, 1);
+        return true;
+    }
+
+    void stop ()
+    {
+        Glib::Mutex::Lock lock (m_mutex);
+        if (!m_out.is_open ())
+            return;
+        g_atomic_int_set (&m_is_active, 0);
+        m_out << "\n]\n";
+        m_out.close ();
+    }
+
+    /// \param a_phase 'B' for the beginning of a scope, 'E' for its end.
+    void write_event (char a_phase,
+                      const UString &a_name,
+                      const UString &a_domain)
+    {
+        struct timespec now;
+        clock_gettime (CLOCK_MONOTONIC, &now);
+
+        // Build the event before taking the lock.
+        std::string event ("{\"name\": \"");
+        append_escaped (event, a_name.raw ());
+        event += "\", \"cat\": \"";
+        append_escaped (event, a_domain.raw ());
+        char buf[128];
+        snprintf (buf, sizeof (buf),
+                  "\", \"ph\": \"%c\", \"ts\": %lld.%03ld"
+                  ", \"pid\": %ld, \"tid\": %lu}",
+                  a_phase,
+                  (long long) now.tv_sec * 1000000 + now.tv_nsec / 1000,
+                  (long) (now.tv_nsec % 1000),
+                  (long) getpid (),
+                  (unsigned long) GPOINTER_TO_SIZE (g_thread_self ()));
+        event += buf;
+
+        Glib::Mutex::Lock lock (m_mutex);
+        if (!m_out.is_open ())
+            return;
+        if (!m_is_first_event)
+            m_out << ",\n";
+        m_is_first_event = false;
+        m_out << event;
+    }
+};//end class ScopeTracer
+
 struct ScopeLoggerPriv
 {
     Glib::Timer timer;
@@ -46,12 +181,15 @@ struct ScopeLoggerPriv
     bool can_free;
     UString name;
     UString domain;
+    // True if the scope is written as trace events rather than as
+    // log lines.
+    bool is_traced;
 
     ScopeLoggerPriv (const char*a_scope_name,
                      enum LogStream::LogLevel a_level,
                      const UString &a_log_domain,
                      bool a_use_default_log_stream) :
-        out (0), can_free (false)
+        out (0), can_free (false), is_traced (false)
     {
         if (!a_use_default_log_stream) {
             out = new LogStream (a_level);
@@ -63,9 +201,18 @@ struct ScopeLoggerPriv
         name = a_scope_name;
         domain = a_log_domain;
 
-        out->push_domain (a_log_domain);
-        *out  << "|{|" << name << ":{" << common::endl;
-        out->pop_domain ();
+        // Like the log lines, the trace events of the scopes of
+        // disabled domains are not written.
+        is_traced = ScopeTracer::get ().is_active ()
+                    && out->is_logging_allowed (a_log_domain.raw (),
+                                                a_level);
+        if (is_traced) {
+            ScopeTracer::get ().write_event ('B', name, domain);
+        } else {
+            out->push_domain (a_log_domain);
+            *out  << "|{|" << name << ":{" << common::endl;
+            out->pop_domain ();
+        }
 
         timer.start ();
         out = out;
@@ -77,10 +224,14 @@ struct ScopeLoggerPriv
 
         if (!out) {return;}
 
-        out->push_domain (domain);
-        *out << "|}|" << name <<":}elapsed: "
-             << timer.elapsed () << "secs" << common::endl;
-        out->pop_domain ();
+        if (is_traced) {
+            ScopeTracer::get ().write_event ('E', name, domain);
+        } else {
+            out->push_domain (domain);
+            *out << "|}|" << name <<":}elapsed: "
+                 << timer.elapsed () << "secs" << common::endl;
+            out->pop_domain ();
+        }
         if (can_free) {
             if (out) {
                 delete out;
@@ -100,6 +251,24 @@ ScopeLogger::ScopeLogger (const char*a_scope_name,
 {
 }
 
+bool
+ScopeLogger::start_tracing (const std::string &a_path)
+{
+    return ScopeTracer::get ().start (a_path);
+}
+
+void
+ScopeLogger::stop_tracing ()
+{
+    ScopeTracer::get ().stop ();
+}
+
+bool
+ScopeLogger::is_tracing ()
+{
+    return ScopeTracer::get ().is_active ();
+}
+
 ScopeLogger::~ScopeLogger ()
 {
     //commented this out for performance reasons.
@@ -57,8 +57,64 @@ public:
 
     virtual ~ScopeLogger ();
 
+    /// \brief writes the scopes logged from now on as trace events,
+    /// rather than as log lines.
+    ///
+    /// The beginning and the end of each scope are written to
+    /// @a_path with their thread, domain and time, in the Chrome
+    /// trace event format, so that a whole session can be looked at
+    /// in a trace viewer. Only the scopes of the enabled log domains
+    /// are traced. Setting the NMV_TRACE_FILE environment variable
+    /// starts tracing to the file it names.
+    /// \param a_path the path of the trace file.
+    /// \return false if tracing is already started, or if the file
+    /// could not be opened.
+    static bool start_tracing (const std::string &a_path);
+
+    /// \brief stops tracing and closes the trace file.
+    static void stop_tracing ();
+
+    /// \return true if the scopes are being traced.
+    static bool is_tracing ();
+
 };//class ScopeLogger
 
+/// \brief a scope logger that is only built once
+/// ScopeSiteLogger::start is called.
+///
+/// It is what the scope logging macros instantiate: when the log site
+/// of the scope is disabled, start is not called and building and
+/// destroying this logger costs no allocation and no call.
+class ScopeSiteLogger
+{
+    ScopeLogger *m_logger;
+
+    //forbid copy/assignation
+    ScopeSiteLogger (ScopeSiteLogger const &);
+    ScopeSiteLogger& operator= (ScopeSiteLogger const &);
+
+public:
+
+    ScopeSiteLogger () :
+        m_logger (0)
+    {
+    }
+
+    void start (const char *a_scope_name,
+                enum LogStream::LogLevel a_level,
+                const UString &a_log_domain)
+    {
+        if (!m_logger)
+            m_logger = new ScopeLogger (a_scope_name, a_level, a_log_domain);
+    }
+
+    ~ScopeSiteLogger ()
+    {
+        if (m_logger)
+            delete m_logger;
+    }
+};//end class ScopeSiteLogger
+
 }//end namespace common
 }//end namespace nemiver
 
@@ -25,6 +25,7 @@
 #include "config.h"
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include "nmv-str-utils.h"
 #include "nmv-safe-ptr-utils.h"
 #include "nmv-exception.h"
@@ -336,14 +337,116 @@ vprintf (const UString &a_format, va_list a_args)
     return result;
 }
 
+// Masks used to check sizeof (unsigned long) bytes at a time.
+static const unsigned long ONES = ~0UL / 0xff;
+static const unsigned long HIGH_BITS = ONES * 0x80;
+
+/// \return the length of the longest prefix of a_buffer made of
+/// non-null ASCII characters.  The bulk of the buffer is checked a
+/// word at a time.
+static size_t
+get_ascii_prefix_length (const char *a_buffer, size_t a_len)
+{
+    size_t i = 0;
+    unsigned long word;
+    for (; i + sizeof (word) <= a_len; i += sizeof (word)) {
+        memcpy (&word, a_buffer + i, sizeof (word));
+        // Stop at the first word that contains a byte with its high
+        // bit set, or a null byte.
+        if ((word | ((word - ONES) & ~word)) & HIGH_BITS)
+            break;
+    }
+    for (; i < a_len; ++i)
+        if (!a_buffer[i] || (a_buffer[i] & 0x80))
+            break;
+    return i;
+}
+
 bool
 is_buffer_valid_utf8 (const char *a_buffer, unsigned a_len)
 {
-    
     RETURN_VAL_IF_FAIL (a_buffer, false);
+
+    // Most source files are mostly ASCII; only hand g_utf8_validate
+    // what comes after the ASCII prefix.
+    size_t ascii_len = get_ascii_prefix_length (a_buffer, a_len);
+    if (ascii_len == a_len)
+        return true;
     const char *end=0;
-    bool is_valid = g_utf8_validate (a_buffer, a_len, &end);
-    return is_valid;
+    return g_utf8_validate (a_buffer + ascii_len,
+                            a_len - ascii_len,
+                            &end);
+}
+
+/// Guess the encoding of a_buffer by looking at its first bytes
+/// only.  A guessed UTF-16 comes from a byte order mark or from the
+/// null bytes of ASCII characters, and can be trusted; ISO-8859-1
+/// and CP1252 are only the most likely 8-bit encodings.
+/// \return the name of the guessed encoding, or an empty string if
+/// the beginning of the buffer is plain ASCII.
+std::string
+guess_buffer_encoding (const char *a_buffer, size_t a_len)
+{
+    static const size_t SAMPLE_SIZE = 4096;
+
+    if (!a_buffer || !a_len)
+        return "";
+
+    const unsigned char *buf =
+        reinterpret_cast<const unsigned char*> (a_buffer);
+    if (a_len >= 3 && buf[0] == 0xef && buf[1] == 0xbb && buf[2] == 0xbf)
+        return "UTF-8";
+    if (a_len >= 2 && buf[0] == 0xff && buf[1] == 0xfe)
+        return "UTF-16LE";
+    if (a_len >= 2 && buf[0] == 0xfe && buf[1] == 0xff)
+        return "UTF-16BE";
+
+    size_t len = a_len < SAMPLE_SIZE ? a_len : SAMPLE_SIZE;
+    size_t ascii_len = get_ascii_prefix_length (a_buffer, len);
+    if (ascii_len == len)
+        return "";
+
+    // Text encoded in UTF-16 without BOM has a null byte in every
+    // other byte of its ASCII characters.
+    size_t nb_even_nulls = 0, nb_odd_nulls = 0;
+    for (size_t i = 0; i < len; ++i)
+        if (!buf[i])
+            ++(i % 2 ? nb_odd_nulls : nb_even_nulls);
+    if (nb_odd_nulls > len / 4 && nb_even_nulls <= len / 64)
+        return "UTF-16LE";
+    if (nb_even_nulls > len / 4 && nb_odd_nulls <= len / 64)
+        return "UTF-16BE";
+
+    const char *end = 0;
+    if (g_utf8_validate (a_buffer + ascii_len, len - ascii_len, &end))
+        return "UTF-8";
+    // The sample might end in the middle of a multibyte character.
+    if (len < a_len
+        && end >= a_buffer + len - 3
+        && g_utf8_get_char_validated (end, a_buffer + len - end)
+            == (gunichar) -2)
+        return "UTF-8";
+
+    // Bytes between 0x80 and 0x9f are control characters in
+    // ISO-8859 encodings, but are printable characters in CP1252.
+    for (size_t i = ascii_len; i < len; ++i)
+        if (buf[i] >= 0x80 && buf[i] <= 0x9f)
+            return "CP1252";
+    return "ISO-8859-1";
+}
+
+// Convert a_input from a_charset to UTF-8.
+static bool
+convert_to_utf8 (const std::string &a_input,
+                 const std::string &a_charset,
+                 UString &a_output)
+{
+    try {
+        a_output = Glib::convert (a_input, "UTF-8", a_charset);
+    } catch (Glib::Exception &e) {
+        return false;
+    }
+    return true;
 }
 
 bool
@@ -351,67 +454,66 @@ ensure_buffer_is_in_utf8 (const std::string &a_input,
 			  const std::list<std::string> &a_supported_encodings,
 			  UString &a_output)
 {
-    UString buf_content;
     if (is_buffer_valid_utf8 (a_input.c_str (), a_input.size ())) {
         a_output = a_input;
         return true;
     }
 
-    UString utf8_content;
-    bool converted = false;
-
     // get the list of candidate encodings that could be the encoding
     // of the a_input. If for a reason we cannot sucessfully proceed
     // with the conversion then we will fall back to a hardcoded list
     // of encodings.
-    std::string current_charset;
-    if (!a_supported_encodings.empty ()) {
-        std::list<std::string>::const_iterator it;
-        for (it = a_supported_encodings.begin ();
-             it != a_supported_encodings.end ();
-             ++it) {
-            current_charset = *it;
-            try {
-                utf8_content =
-                    Glib::convert (a_input, "UTF-8", current_charset);
-            } catch (Glib::Exception &e) {
-                continue;
-            } catch (...) {
-                return false;
-            }
-            converted = true;
-            break;
-        }
+    //
+    // Where the encoding guessed from the beginning of the buffer
+    // goes depends on how much it can be trusted.  UTF-16 is guessed
+    // from a byte order mark or from the null bytes of ASCII
+    // characters, and the 8-bit encodings the user might have listed
+    // would accept such text without complaining, so it is tried
+    // first.  ISO-8859-1 and CP1252 are mere guesses that never fail,
+    // so trying them first would override the choice of the user:
+    // they are tried after the encodings the user listed, but before
+    // the hardcoded ones.
+    std::list<std::string> candidates (a_supported_encodings);
+    std::string guessed_charset =
+        guess_buffer_encoding (a_input.data (), a_input.size ());
+    if (!guessed_charset.compare (0, 6, "UTF-16")) {
+        candidates.remove (guessed_charset);
+        candidates.push_front (guessed_charset);
+    } else if (!guessed_charset.empty ()
+               && std::find (candidates.begin (), candidates.end (),
+                             guessed_charset) == candidates.end ()) {
+        candidates.push_back (guessed_charset);
     }
+    for (unsigned int i=0; i < SIZE_OF_SUPPORTED_ENCODINGS; i++) {
+        if (std::find (candidates.begin (), candidates.end (),
+                       SUPPORTED_ENCODINGS[i]) == candidates.end ())
+            candidates.push_back (SUPPORTED_ENCODINGS[i]);
+    }
+    // The input is not valid UTF-8, so there is no point in trying to
+    // convert it from UTF-8.
+    candidates.remove ("UTF-8");
 
-    if (!converted) {
-        // fall back to trying the hardcoded list of supported encodings
-        for (unsigned int i=0; i < SIZE_OF_SUPPORTED_ENCODINGS; i++) {
-            try {
-                utf8_content =
-                    Glib::convert (a_input,
-                                   "UTF-8",
-                                   SUPPORTED_ENCODINGS[i]);
-            } catch (Glib::Exception &e) {
-                continue;
-            } catch (...) {
-                return false;
+    UString utf8_content;
+    bool converted = false;
+    std::list<std::string>::const_iterator it;
+    try {
+        for (it = candidates.begin (); it != candidates.end (); ++it) {
+            if (convert_to_utf8 (a_input, *it, utf8_content)) {
+                converted = true;
+                break;
             }
-            converted = true;
         }
-    }
-
-    if (!converted)
+    } catch (...) {
         return false;
+    }
 
-    const char *end=0;
-    if (utf8_content.empty ()
-        || !g_utf8_validate (utf8_content.raw ().c_str (),
-                             utf8_content.bytes (),
-                             &end)) {
+    if (!converted
+        || utf8_content.empty ()
+        || !is_buffer_valid_utf8 (utf8_content.raw ().c_str (),
+                                  utf8_content.bytes ())) {
         return false;
     }
-    a_output = utf8_content;
+    a_output.swap (utf8_content);
     return true;
 }
 
@@ -88,6 +88,8 @@ UString vprintf (const UString &a_format, va_list a_args);
 
 bool is_buffer_valid_utf8 (const char *a_buffer, unsigned a_len);
 
+std::string guess_buffer_encoding (const char *a_buffer, size_t a_len);
+
 bool ensure_buffer_is_in_utf8 (const std::string &a_input,
 			       const std::list<std::string> &supported_encodings,
 			       UString &a_output);
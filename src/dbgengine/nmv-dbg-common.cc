@@ -23,13 +23,132 @@
  *See COPYRIGHT file copyright information.
  */
 #include "config.h"
+#include <cstdlib>
+#include <algorithm>
+#include <typeinfo>
+#include <unordered_map>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+#include <glibmm.h>
 #include "common/nmv-exception.h"
 #include "nmv-dbg-common.h"
 
 NEMIVER_BEGIN_NAMESPACE (nemiver)
 
+// The outputs are classified by whether they have out of band
+// records, and by the kind of their result record, if any.  So there
+// are 2 * (1 + 6) classes of outputs.
+static const unsigned NB_RESULT_SLOTS = 1 + Output::ResultRecord::EXIT + 1;
+static const unsigned NB_OUTPUT_CLASSES = 2 * NB_RESULT_SLOTS;
+
+/// \return the class of a_output, in [0, NB_OUTPUT_CLASSES).
+static unsigned
+output_class (const Output &a_output)
+{
+    unsigned result_slot = 0;
+    if (a_output.has_result_record ())
+        result_slot = 1 + a_output.result_record ().kind ();
+    return 2 * result_slot + (a_output.has_out_of_band_record () ? 1 : 0);
+}
+
+/// \return the OutputHandler::OutputKind flags of the outputs of
+/// class a_class.
+static unsigned
+output_class_kinds (unsigned a_class)
+{
+    unsigned kinds = 0, result_slot = a_class / 2;
+    if (a_class % 2)
+        kinds |= OutputHandler::OUT_OF_BAND_OUTPUT;
+    if (result_slot)
+        kinds |= OutputHandler::UNDEFINED_RESULT_OUTPUT << (result_slot - 1);
+    return kinds;
+}
+
 struct OutputHandlerList::Priv {
-    list<OutputHandlerSafePtr> output_handlers;
+    struct Entry {
+        OutputHandlerSafePtr handler;
+        unsigned kinds;
+        list<UString> command_names;
+        HandlerStats stats;
+    };
+
+    // For each class of output, the indexes of the handlers that can
+    // possibly handle it, in the order the handlers were added.
+    typedef vector<vector<unsigned> > Dispatch;
+
+    vector<Entry> output_handlers;
+    // The dispatch for the outputs of the commands whose names are
+    // handled by a specific handler.
+    std::unordered_map<std::string, Dispatch> dispatch_by_command;
+    // The dispatch for the outputs of any other command.
+    Dispatch default_dispatch;
+    bool dispatch_is_up_to_date;
+    Glib::Timer timer;
+
+    Priv () :
+        dispatch_is_up_to_date (false)
+    {
+    }
+
+    /// Build the dispatch of the outputs of the command named
+    /// a_command_name.  If a_command_name is empty, build the
+    /// dispatch of the commands that have no specific handler.
+    void build_dispatch (const UString &a_command_name,
+                         Dispatch &a_dispatch) const
+    {
+        a_dispatch.assign (NB_OUTPUT_CLASSES, vector<unsigned> ());
+        for (unsigned i = 0; i < output_handlers.size (); ++i) {
+            const Entry &entry = output_handlers[i];
+            if (!entry.command_names.empty ()
+                && (a_command_name.empty ()
+                    || std::find (entry.command_names.begin (),
+                                  entry.command_names.end (),
+                                  a_command_name)
+                       == entry.command_names.end ()))
+                continue;
+            for (unsigned c = 0; c < NB_OUTPUT_CLASSES; ++c) {
+                if (entry.kinds == OutputHandler::ANY_OUTPUT
+                    || (entry.kinds & output_class_kinds (c)))
+                    a_dispatch[c].push_back (i);
+            }
+        }
+    }
+
+    void build_dispatch ()
+    {
+        dispatch_by_command.clear ();
+        build_dispatch ("", default_dispatch);
+        vector<Entry>::const_iterator it;
+        list<UString>::const_iterator name;
+        for (it = output_handlers.begin ();
+             it != output_handlers.end ();
+             ++it) {
+            for (name = it->command_names.begin ();
+                 name != it->command_names.end ();
+                 ++name) {
+                if (dispatch_by_command.count (name->raw ()))
+                    continue;
+                build_dispatch (*name, dispatch_by_command[name->raw ()]);
+            }
+        }
+        dispatch_is_up_to_date = true;
+    }
+
+    const vector<unsigned>& handlers_of (const CommandAndOutput &a_cao)
+    {
+        if (!dispatch_is_up_to_date)
+            build_dispatch ();
+
+        const Dispatch *dispatch = &default_dispatch;
+        if (a_cao.has_command () && !dispatch_by_command.empty ()) {
+            std::unordered_map<std::string, Dispatch>::const_iterator it =
+                dispatch_by_command.find (a_cao.command ().name ().raw ());
+            if (it != dispatch_by_command.end ())
+                dispatch = &it->second;
+        }
+        return (*dispatch)[output_class (a_cao.output ())];
+    }
 };//end OutputHandlerList
 
 OutputHandlerList::OutputHandlerList ()
@@ -45,22 +164,68 @@ void
 OutputHandlerList::add (const OutputHandlerSafePtr &a_handler)
 {
     THROW_IF_FAIL (m_priv);
-    m_priv->output_handlers.push_back (a_handler);
+    THROW_IF_FAIL (a_handler);
+
+    Priv::Entry entry;
+    entry.handler = a_handler;
+    entry.kinds = a_handler->handled_output_kinds ();
+    a_handler->handled_command_names (entry.command_names);
+    entry.stats.name = typeid (*a_handler).name ();
+#ifdef __GNUC__
+    int status = 0;
+    char *name = abi::__cxa_demangle (entry.stats.name.c_str (),
+                                      0, 0, &status);
+    if (name) {
+        if (!status)
+            entry.stats.name = name;
+        free (name);
+    }
+#endif
+    m_priv->output_handlers.push_back (entry);
+    m_priv->dispatch_is_up_to_date = false;
 }
 
 void
 OutputHandlerList::submit_command_and_output (CommandAndOutput &a_cao)
 {
-    list<OutputHandlerSafePtr>::iterator iter;
-    for (iter = m_priv->output_handlers.begin ();
-            iter != m_priv->output_handlers.end ();
-            ++iter)
-    {
-        if ((*iter)->can_handle (a_cao)) {
-            NEMIVER_TRY;
-            (*iter)->do_handle (a_cao);
-            NEMIVER_CATCH_NOX;
-        }
+    const vector<unsigned> &handlers = m_priv->handlers_of (a_cao);
+    vector<unsigned>::const_iterator iter;
+    for (iter = handlers.begin (); iter != handlers.end (); ++iter) {
+        Priv::Entry &entry = m_priv->output_handlers[*iter];
+        ++entry.stats.nb_queries;
+        if (!entry.handler->can_handle (a_cao))
+            continue;
+        // Most queries fail and are cheap: only time the handling.
+        ++entry.stats.nb_hits;
+        m_priv->timer.start ();
+        NEMIVER_TRY;
+        entry.handler->do_handle (a_cao);
+        NEMIVER_CATCH_NOX;
+        entry.stats.time_spent += m_priv->timer.elapsed ();
+    }
+}
+
+void
+OutputHandlerList::get_stats (list<HandlerStats> &a_stats) const
+{
+    vector<Priv::Entry>::const_iterator it;
+    for (it = m_priv->output_handlers.begin ();
+         it != m_priv->output_handlers.end ();
+         ++it) {
+        a_stats.push_back (it->stats);
+    }
+}
+
+void
+OutputHandlerList::clear_stats ()
+{
+    vector<Priv::Entry>::iterator it;
+    for (it = m_priv->output_handlers.begin ();
+         it != m_priv->output_handlers.end ();
+         ++it) {
+        UString name = it->stats.name;
+        it->stats = HandlerStats ();
+        it->stats.name = name;
     }
 }
 
@@ -236,5 +401,334 @@ update_debugger_variable (IDebugger::Variable &a_to,
 
 
 
-NEMIVER_END_NAMESPACE (nemiver)
+MemoryCache::MemoryCache (size_t a_max_nb_pages) :
+    m_max_nb_pages (a_max_nb_pages),
+    m_clock (0),
+    m_last_full_invalidation (0),
+    m_nb_hits (0),
+    m_nb_misses (0)
+{
+}
+
+void
+MemoryCache::erase (std::map<size_t, Page>::iterator a_page)
+{
+    m_lru.erase (a_page->second.lru_it);
+    m_pages.erase (a_page);
+}
+
+void
+MemoryCache::get_missing_ranges (size_t a_addr,
+                                 size_t a_size,
+                                 std::list<Range> &a_ranges)
+{
+    if (!a_size)
+        return;
+
+    size_t last_page = page_of (a_addr + a_size - 1);
+    for (size_t page = page_of (a_addr); ; page += CACHE_PAGE_SIZE) {
+        std::map<size_t, Page>::iterator it = m_pages.find (page);
+        if (it != m_pages.end ()) {
+            ++m_nb_hits;
+            m_lru.splice (m_lru.begin (), m_lru, it->second.lru_it);
+        } else {
+            ++m_nb_misses;
+            if (!a_ranges.empty ()
+                && a_ranges.back ().first + a_ranges.back ().second == page)
+                a_ranges.back ().second += CACHE_PAGE_SIZE;
+            else
+                a_ranges.push_back (Range (page, CACHE_PAGE_SIZE));
+        }
+        if (page == last_page)
+            break;
+    }
+}
+
+bool
+MemoryCache::read (size_t a_addr,
+                   size_t a_size,
+                   std::vector<uint8_t> &a_values) const
+{
+    std::vector<uint8_t> values;
+    values.reserve (a_size);
+    size_t addr = a_addr, end = a_addr + a_size;
+    while (addr < end) {
+        size_t page = page_of (addr);
+        std::map<size_t, Page>::const_iterator it = m_pages.find (page);
+        if (it == m_pages.end ())
+            return false;
+        size_t page_end = std::min (page + CACHE_PAGE_SIZE, end);
+        values.insert (values.end (),
+                       it->second.bytes.begin () + (addr - page),
+                       it->second.bytes.begin () + (page_end - page));
+        addr = page_end;
+    }
+    a_values.swap (values);
+    return true;
+}
+
+void
+MemoryCache::store (size_t a_addr,
+                    const std::vector<uint8_t> &a_values,
+                    unsigned long a_stamp)
+{
+    if (!m_max_nb_pages || m_last_full_invalidation > a_stamp)
+        return;
+
+    size_t end = a_addr + a_values.size ();
+    size_t page = page_of (a_addr);
+    if (page != a_addr)
+        page += CACHE_PAGE_SIZE;
+    for (; page + CACHE_PAGE_SIZE <= end; page += CACHE_PAGE_SIZE) {
+        std::map<size_t, unsigned long>::const_iterator invalidation =
+            m_page_invalidations.find (page);
+        if (invalidation != m_page_invalidations.end ()
+            && invalidation->second > a_stamp)
+            continue;
+
+        std::map<size_t, Page>::iterator it = m_pages.find (page);
+        if (it == m_pages.end ()) {
+            it = m_pages.insert (std::make_pair (page, Page ())).first;
+            m_lru.push_front (page);
+        } else {
+            m_lru.splice (m_lru.begin (), m_lru, it->second.lru_it);
+        }
+        it->second.lru_it = m_lru.begin ();
+        std::vector<uint8_t>::const_iterator from =
+            a_values.begin () + (page - a_addr);
+        it->second.bytes.assign (from, from + CACHE_PAGE_SIZE);
+    }
+
+    while (m_pages.size () > m_max_nb_pages)
+        erase (m_pages.find (m_lru.back ()));
+}
+
+bool
+MemoryCache::invalidated_since (size_t a_addr,
+                                size_t a_size,
+                                unsigned long a_stamp) const
+{
+    if (m_last_full_invalidation > a_stamp)
+        return true;
+    if (!a_size)
+        return false;
+    std::map<size_t, unsigned long>::const_iterator it, end;
+    it = m_page_invalidations.lower_bound (page_of (a_addr));
+    end = m_page_invalidations.upper_bound (page_of (a_addr + a_size - 1));
+    for (; it != end; ++it) {
+        if (it->second > a_stamp)
+            return true;
+    }
+    return false;
+}
+
+void
+MemoryCache::invalidate (size_t a_addr, size_t a_size)
+{
+    if (!a_size)
+        return;
+    ++m_clock;
+    size_t last_page = page_of (a_addr + a_size - 1);
+    for (size_t page = page_of (a_addr); ; page += CACHE_PAGE_SIZE) {
+        m_page_invalidations[page] = m_clock;
+        std::map<size_t, Page>::iterator it = m_pages.find (page);
+        if (it != m_pages.end ())
+            erase (it);
+        if (page == last_page)
+            break;
+    }
+}
+
+void
+MemoryCache::invalidate ()
+{
+    ++m_clock;
+    m_last_full_invalidation = m_clock;
+    m_page_invalidations.clear ();
+    m_pages.clear ();
+    m_lru.clear ();
+}
+
+VarObjPool::VarObjPool (size_t a_max_nb_variables,
+                        size_t a_max_nb_frames) :
+    m_max_nb_variables (a_max_nb_variables),
+    m_max_nb_frames (a_max_nb_frames),
+    m_nb_variables (0),
+    m_nb_hits (0),
+    m_nb_misses (0)
+{
+}
+
+void
+VarObjPool::erase (std::list<Entry>::iterator a_entry)
+{
+    m_nb_variables -= a_entry->nb_variables ();
+    m_index.erase (a_entry->key);
+    m_entries.erase (a_entry);
+}
+
+void
+VarObjPool::evict (std::list<Entry>::iterator a_entry,
+                   IDebugger::VariableList &a_evicted)
+{
+    a_evicted.insert (a_evicted.end (),
+                      a_entry->local_variables.begin (),
+                      a_entry->local_variables.end ());
+    a_evicted.insert (a_evicted.end (),
+                      a_entry->function_arguments.begin (),
+                      a_entry->function_arguments.end ());
+    erase (a_entry);
+}
+
+void
+VarObjPool::put (const FrameKey &a_key,
+                 const IDebugger::VariableList &a_local_variables,
+                 const IDebugger::VariableList &a_function_arguments,
+                 IDebugger::VariableList &a_evicted)
+{
+    IDebugger::VariableList evicted;
+    std::map<FrameKey, std::list<Entry>::iterator>::iterator it =
+        m_index.find (a_key);
+    if (it != m_index.end ())
+        evict (it->second, evicted);
 
+    size_t nb_variables =
+        a_local_variables.size () + a_function_arguments.size ();
+    if (nb_variables > m_max_nb_variables || !m_max_nb_frames) {
+        evicted.insert (evicted.end (),
+                        a_local_variables.begin (),
+                        a_local_variables.end ());
+        evicted.insert (evicted.end (),
+                        a_function_arguments.begin (),
+                        a_function_arguments.end ());
+    } else if (nb_variables) {
+        while (m_nb_variables + nb_variables > m_max_nb_variables
+               || m_entries.size () >= m_max_nb_frames)
+            evict (--m_entries.end (), evicted);
+
+        m_entries.push_front (Entry (a_key));
+        Entry &entry = m_entries.front ();
+        entry.local_variables = a_local_variables;
+        entry.function_arguments = a_function_arguments;
+        m_index.insert (std::make_pair (a_key, m_entries.begin ()));
+        m_nb_variables += nb_variables;
+    }
+
+    // A variable that was put again, e.g, when a frame replaces
+    // itself, is not evicted.
+    IDebugger::VariableList::const_iterator var_it;
+    for (var_it = evicted.begin (); var_it != evicted.end (); ++var_it) {
+        if (std::find (a_local_variables.begin (),
+                       a_local_variables.end (),
+                       *var_it) == a_local_variables.end ()
+            && std::find (a_function_arguments.begin (),
+                          a_function_arguments.end (),
+                          *var_it) == a_function_arguments.end ())
+            a_evicted.push_back (*var_it);
+    }
+}
+
+bool
+VarObjPool::take (const FrameKey &a_key,
+                  IDebugger::VariableList &a_local_variables,
+                  IDebugger::VariableList &a_function_arguments)
+{
+    std::map<FrameKey, std::list<Entry>::iterator>::iterator it =
+        m_index.find (a_key);
+    if (it == m_index.end ()) {
+        ++m_nb_misses;
+        return false;
+    }
+    ++m_nb_hits;
+    a_local_variables = it->second->local_variables;
+    a_function_arguments = it->second->function_arguments;
+    erase (it->second);
+    return true;
+}
+
+void
+VarObjPool::clear ()
+{
+    // Clear the list in a copy, as destroying the variables might
+    // make the engine call us back.
+    std::list<Entry> entries;
+    entries.swap (m_entries);
+    m_index.clear ();
+    m_nb_variables = 0;
+}
+
+std::string
+CommandLatencyStats::command_key (const Command &a_command)
+{
+    if (!a_command.name ().empty ())
+        return a_command.name ().raw ();
+    const std::string &value = a_command.value ().raw ();
+    return value.substr (0, value.find (' '));
+}
+
+void
+CommandLatencyStats::record (const Command &a_command,
+                             const ResultTimes &a_times)
+{
+    if (!a_command.issued_time ())
+        return;
+
+    int64_t queued = a_command.queued_time ()
+        ? a_command.queued_time ()
+        : a_command.issued_time ();
+    // The first byte of the result might have been read along with
+    // the tail of the previous record, before the command was even
+    // issued.
+    int64_t first_byte = std::max (a_times.first_byte,
+                                   a_command.issued_time ());
+
+    typedef IDebugger::CommandLatency Latency;
+    Latency &latency = m_stats[command_key (a_command)];
+    latency.phases[Latency::QUEUED_PHASE].add
+        (a_command.issued_time () - queued);
+    latency.phases[Latency::DEBUGGER_PHASE].add
+        (first_byte - a_command.issued_time ());
+    latency.phases[Latency::RECEIVE_PHASE].add
+        (a_times.received - first_byte);
+    latency.phases[Latency::PARSE_PHASE].add
+        (a_times.parsed - a_times.parsing);
+    latency.phases[Latency::HANDLERS_PHASE].add
+        (a_times.handled - a_times.parsed);
+    latency.phases[Latency::TOTAL_PHASE].add
+        (a_times.handled - queued);
+}
+
+void
+CommandLatencyStats::write (std::ostream &a_out) const
+{
+    typedef IDebugger::CommandLatency Latency;
+    IDebugger::CommandLatencyMap::const_iterator it;
+    for (it = m_stats.begin (); it != m_stats.end (); ++it) {
+        std::string name;
+        for (std::string::const_iterator c = it->first.begin ();
+             c != it->first.end ();
+             ++c) {
+            if (*c == '"' || *c == '\\')
+                name += '\\';
+            name += *c;
+        }
+        for (int p = 0; p < Latency::NB_PHASES; ++p) {
+            const Latency::Histogram &h = it->second.phases[p];
+            a_out << "{\"command\": \"" << name << "\""
+                  << ", \"phase\": \""
+                  << Latency::phase_to_string ((Latency::Phase) p) << "\""
+                  << ", \"count\": " << h.nb_samples
+                  << ", \"total_us\": " << h.total
+                  << ", \"max_us\": " << h.max
+                  << ", \"buckets\": [";
+            for (int b = 0; b < Latency::NB_BUCKETS; ++b) {
+                if (b)
+                    a_out << ", ";
+                a_out << h.buckets[b];
+            }
+            a_out << "]}\n";
+        }
+    }
+}
+
+NEMIVER_END_NAMESPACE (nemiver)
@@ -28,6 +28,7 @@
 #define __NMV_DBG_COMMON_H_H__
 #include "nmv-i-debugger.h"
 #include <memory>
+#include <ostream>
 
 NEMIVER_BEGIN_NAMESPACE (nemiver)
 
@@ -93,13 +94,19 @@ class Command {
     IDebugger::VariableSafePtr m_var;
     sigc::slot_base m_slot;
     bool m_should_emit_signal;
+    unsigned m_token;
+    int64_t m_queued_time;
+    int64_t m_issued_time;
 
 public:
 
     Command () :
     m_tag2 (0),
       m_slot (0),
-      m_should_emit_signal (true)
+      m_should_emit_signal (true),
+      m_token (0),
+      m_queued_time (0),
+      m_issued_time (0)
     {
         clear ();
     }
@@ -109,7 +116,10 @@ public:
     m_value (a_value),
       m_tag2 (0),
       m_slot (0),
-      m_should_emit_signal (true)
+      m_should_emit_signal (true),
+      m_token (0),
+      m_queued_time (0),
+      m_issued_time (0)
     {
     }
 
@@ -118,7 +128,10 @@ public:
       m_value (a_value),
       m_tag2 (0),
       m_slot (0),
-      m_should_emit_signal (true)
+      m_should_emit_signal (true),
+      m_token (0),
+      m_queued_time (0),
+      m_issued_time (0)
     {
     }
 
@@ -130,7 +143,10 @@ public:
       m_value (a_value),
       m_tag2 (0),
       m_slot (0),
-      m_should_emit_signal (true)
+      m_should_emit_signal (true),
+      m_token (0),
+      m_queued_time (0),
+      m_issued_time (0)
     {
     }
 
@@ -185,6 +201,21 @@ public:
     bool should_emit_signal () const {return m_should_emit_signal;}
     void should_emit_signal (bool a) {m_should_emit_signal = a;}
 
+    /// The GDB/MI token the command was sent with, or 0 if it was
+    /// sent without any.  GDB echoes the token back at the start of
+    /// the result record of the command.
+    unsigned token () const {return m_token;}
+    void token (unsigned a_in) {m_token = a_in;}
+
+    /// When the command was queued and when it was sent to the
+    /// debugger, as returned by g_get_monotonic_time, or 0 if it
+    /// wasn't.
+    int64_t queued_time () const {return m_queued_time;}
+    void queued_time (int64_t a_in) {m_queued_time = a_in;}
+
+    int64_t issued_time () const {return m_issued_time;}
+    void issued_time (int64_t a_in) {m_issued_time = a_in;}
+
     /// @}
 
     void clear ()
@@ -197,6 +228,9 @@ public:
         m_tag3.clear ();
         m_tag4.clear ();
 	m_should_emit_signal = true;
+        m_token = 0;
+        m_queued_time = 0;
+        m_issued_time = 0;
     }
 };//end class Command
 
@@ -447,6 +481,9 @@ public:
 
     private:
         Kind m_kind;
+        // The token of the command this record is the result of, or
+        // 0 if GDB didn't send any.
+        unsigned m_token;
         map<string, IDebugger::Breakpoint> m_breakpoints;
         map<UString, UString> m_attrs;
 
@@ -515,6 +552,9 @@ public:
         // Children variables of a given variable.
         vector<IDebugger::VariableSafePtr> m_variable_children;
         bool m_has_variable_children;
+        // Set when -var-list-children reports that the variable has
+        // children past the window of children it returned.
+        bool m_has_more_variable_children;
 
 	// A list of the changes that occurred on a given variable.
 	// Whenever a user issues IDebugger::list_changed_variables on
@@ -534,6 +574,10 @@ public:
         UString m_path_expression;
         bool m_has_path_expression;
 
+        // The depth of the stack, as reported by -stack-info-depth.
+        // -1 by default.
+        int m_stack_depth;
+
         // The variable format of a variable object
         IDebugger::Variable::Format m_variable_format;
         bool m_has_variable_format;
@@ -545,6 +589,7 @@ public:
         void clear ()
         {
             m_kind = UNDEFINED;
+            m_token = 0;
             m_breakpoints.clear ();
             m_attrs.clear ();
             m_call_stack.clear ();
@@ -577,11 +622,13 @@ public:
 	    m_has_variable = false;
             m_nb_variable_deleted = 0;
             m_has_variable_children = false;
+            m_has_more_variable_children = false;
 	    m_var_changes.clear ();
             m_has_var_changes = false;
 	    m_new_num_children = -1;
             m_path_expression.clear ();
             m_has_path_expression = false;
+            m_stack_depth = -1;
             m_variable_format = IDebugger::Variable::UNDEFINED_FORMAT;
             m_has_variable_format = false;
         }
@@ -592,6 +639,9 @@ public:
         Kind kind () const {return m_kind;}
         void kind (Kind a_in) {m_kind = a_in;}
 
+        unsigned token () const {return m_token;}
+        void token (unsigned a_in) {m_token = a_in;}
+
         const map<string, IDebugger::Breakpoint>& breakpoints () const
         {
             return m_breakpoints;
@@ -821,6 +871,15 @@ public:
             has_variable_children (true);
         }
 
+        bool has_more_variable_children () const
+        {
+            return m_has_more_variable_children;
+        }
+        void has_more_variable_children (bool a_in)
+        {
+            m_has_more_variable_children = a_in;
+        }
+
         bool has_var_changes () const
         {
             return m_has_var_changes;
@@ -878,6 +937,10 @@ public:
             m_has_path_expression = a;
         }
 
+        bool has_stack_depth () const {return m_stack_depth >= 0;}
+        int stack_depth () const {return m_stack_depth;}
+        void stack_depth (int a_depth) {m_stack_depth = a_depth;}
+
         IDebugger::Variable::Format variable_format () const
         {
             return m_variable_format;
@@ -1007,6 +1070,40 @@ public:
 /// implementations fire their signals from.
 struct OutputHandler : Object {
 
+    /// The kinds of output a handler can be interested in.
+    /// OutputHandlerList only queries a handler about the outputs
+    /// of the kinds it declared, see handled_output_kinds.
+    enum OutputKind {
+        // The output has out of band records.
+        OUT_OF_BAND_OUTPUT = 1,
+        // The output has a result record of the given kind.
+        UNDEFINED_RESULT_OUTPUT = 1 << 1,
+        DONE_RESULT_OUTPUT = 1 << 2,
+        RUNNING_RESULT_OUTPUT = 1 << 3,
+        CONNECTED_RESULT_OUTPUT = 1 << 4,
+        ERROR_RESULT_OUTPUT = 1 << 5,
+        EXIT_RESULT_OUTPUT = 1 << 6,
+        ANY_RESULT_OUTPUT = UNDEFINED_RESULT_OUTPUT
+                            | DONE_RESULT_OUTPUT
+                            | RUNNING_RESULT_OUTPUT
+                            | CONNECTED_RESULT_OUTPUT
+                            | ERROR_RESULT_OUTPUT
+                            | EXIT_RESULT_OUTPUT,
+        // Any output, including the ones that have no record at
+        // all, e.g, because they failed to parse.
+        ANY_OUTPUT = OUT_OF_BAND_OUTPUT | ANY_RESULT_OUTPUT
+    };//end enum OutputKind
+
+    /// \return the or-ed OutputKind values of the outputs this
+    /// handler can possibly handle.
+    virtual unsigned handled_output_kinds () const {return ANY_OUTPUT;}
+
+    /// Fill a_names with the names of the commands this handler can
+    /// possibly handle the output of.  Leaving it empty means the
+    /// handler can handle the output of any command, as well as
+    /// outputs that are not the result of any command.
+    virtual void handled_command_names (list<UString> &) const {}
+
     //a method supposed to return
     //true if the current handler knows
     //how to handle a given debugger output
@@ -1023,6 +1120,7 @@ typedef SafePtr<OutputHandler, ObjectRef, ObjectUnref> OutputHandlerSafePtr;
 /// Instances of CommandAndOutput can be submitted
 /// to this list or OutputHandlers.
 /// Upon submission of a CommandAndOutput, each OutputHandler of the list
+/// that declared it can handle outputs of that kind, for that command,
 /// is queried (by a call on OutputHandler::can_handle())
 /// to see if it wants to 'handle' the submitted CommandAndOutput.
 /// If it wants to handle it, then it is called on OutputHandler::do_handle()
@@ -1038,12 +1136,316 @@ class OutputHandlerList : Object {
     OutputHandlerList& operator= (const OutputHandlerList&);
 
 public:
+
+    /// Usage statistics of an OutputHandler.
+    struct HandlerStats {
+        // The name of the type of the handler.
+        UString name;
+        // How many times OutputHandler::can_handle was called.
+        unsigned long nb_queries;
+        // How many times OutputHandler::do_handle was called.
+        unsigned long nb_hits;
+        // The time spent in OutputHandler::do_handle, in seconds.
+        double time_spent;
+
+        HandlerStats () :
+            nb_queries (0),
+            nb_hits (0),
+            time_spent (0)
+        {}
+    };//end struct HandlerStats
+
     OutputHandlerList ();
     ~OutputHandlerList ();
     void add (const OutputHandlerSafePtr &a_handler);
     void submit_command_and_output (CommandAndOutput &a_cao);
+
+    /// Get the statistics of the handlers, in the order they were
+    /// added.
+    void get_stats (list<HandlerStats> &a_stats) const;
+
+    void clear_stats ();
 };//end class OutputHandlerList
 
+/// A cache of the memory of the inferior.
+///
+/// The memory is cached by pages of CACHE_PAGE_SIZE bytes, aligned
+/// on CACHE_PAGE_SIZE.  Only whole pages are cached, so that a page
+/// is either entirely known or has to be fetched from the inferior.
+/// The cache holds at most max_nb_pages () pages; the least recently
+/// used ones are dropped first.
+class MemoryCache {
+    // non copyable
+    MemoryCache (const MemoryCache&);
+    MemoryCache& operator= (const MemoryCache&);
+
+    struct Page {
+        std::vector<uint8_t> bytes;
+        // Where the page is in m_lru.
+        std::list<size_t>::iterator lru_it;
+    };
+
+    // The cached pages, keyed by their address.
+    std::map<size_t, Page> m_pages;
+    // The addresses of the cached pages, the most recently used
+    // first.
+    std::list<size_t> m_lru;
+    size_t m_max_nb_pages;
+    // Incremented by each invalidation.
+    unsigned long m_clock;
+    // The clock of the last invalidation of all the pages.
+    unsigned long m_last_full_invalidation;
+    // The clock of the last invalidation of the pages invalidated
+    // one by one since the last invalidation of all the pages.
+    std::map<size_t, unsigned long> m_page_invalidations;
+    unsigned long m_nb_hits;
+    unsigned long m_nb_misses;
+
+    void erase (std::map<size_t, Page>::iterator a_page);
+
+public:
+    enum {
+        CACHE_PAGE_SIZE = 512,
+        // 1MB worth of pages.
+        DEFAULT_MAX_NB_PAGES = 2048
+    };
+
+    typedef std::pair<size_t, size_t> Range;
+
+    MemoryCache (size_t a_max_nb_pages = DEFAULT_MAX_NB_PAGES);
+
+    /// \return the address of the page containing a_addr.
+    static size_t page_of (size_t a_addr)
+    {
+        return a_addr - a_addr % CACHE_PAGE_SIZE;
+    }
+
+    /// Get the ranges of memory to fetch from the inferior so that
+    /// [a_addr, a_addr + a_size) is entirely cached.  This accounts
+    /// for the cached pages as hits and for the others as misses,
+    /// and makes the cached pages the most recently used ones.
+    /// \param a_ranges output parameter.  Filled with the (address,
+    /// size) pairs of the ranges of contiguous missing pages.
+    void get_missing_ranges (size_t a_addr,
+                             size_t a_size,
+                             std::list<Range> &a_ranges);
+
+    /// Read [a_addr, a_addr + a_size) from the cache.
+    /// \return true if the whole range is cached, false otherwise,
+    /// in which case a_values is left untouched.
+    bool read (size_t a_addr,
+               size_t a_size,
+               std::vector<uint8_t> &a_values) const;
+
+    /// Cache memory read from the inferior.  The parts of a_values
+    /// that don't fill whole pages are ignored, and so are the pages
+    /// that were invalidated after the memory was read.
+    /// \param a_stamp the value of clock () when the memory was
+    /// requested from the inferior.
+    void store (size_t a_addr,
+                const std::vector<uint8_t> &a_values,
+                unsigned long a_stamp);
+
+    /// \return true if a page intersecting [a_addr, a_addr + a_size)
+    /// was invalidated after clock () was a_stamp.
+    bool invalidated_since (size_t a_addr,
+                            size_t a_size,
+                            unsigned long a_stamp) const;
+
+    /// Forget about the pages that intersect [a_addr, a_addr + a_size).
+    void invalidate (size_t a_addr, size_t a_size);
+
+    /// Forget about all the pages.
+    void invalidate ();
+
+    /// \return the number of invalidations so far.  Memory requested
+    /// from the inferior is stamped with it, so that the pages
+    /// invalidated in the mean time are not cached.
+    unsigned long clock () const {return m_clock;}
+
+    size_t nb_pages () const {return m_pages.size ();}
+
+    size_t max_nb_pages () const {return m_max_nb_pages;}
+
+    /// \return the number of page lookups that hit the cache.
+    unsigned long nb_hits () const {return m_nb_hits;}
+
+    /// \return the number of page lookups that missed the cache.
+    unsigned long nb_misses () const {return m_nb_misses;}
+};//end class MemoryCache
+
+/// A pool of the variable objects of the frames that were recently
+/// displayed.
+///
+/// When a frame is left, its local variables and arguments can be
+/// put in the pool, which keeps their variable objects alive.  When
+/// the frame is displayed again, they are taken back from the pool
+/// and just need to be updated, instead of being created again.  The
+/// pool keeps at most a given number of root variables and of
+/// frames; the least recently put frames are dropped first.
+class VarObjPool {
+public:
+    /// Identifies a frame in the pool.
+    struct FrameKey {
+        int thread_id;
+        std::string function_name;
+        /// The number of frames between the frame and the
+        /// outermost frame of the thread.
+        int depth;
+
+        FrameKey (int a_thread_id,
+                  const std::string &a_function_name,
+                  int a_depth) :
+            thread_id (a_thread_id),
+            function_name (a_function_name),
+            depth (a_depth)
+        {
+        }
+
+        bool operator< (const FrameKey &a_other) const
+        {
+            if (thread_id != a_other.thread_id)
+                return thread_id < a_other.thread_id;
+            if (depth != a_other.depth)
+                return depth < a_other.depth;
+            return function_name < a_other.function_name;
+        }
+    };
+
+private:
+    // non copyable
+    VarObjPool (const VarObjPool&);
+    VarObjPool& operator= (const VarObjPool&);
+
+    struct Entry {
+        FrameKey key;
+        IDebugger::VariableList local_variables;
+        IDebugger::VariableList function_arguments;
+
+        Entry (const FrameKey &a_key) :
+            key (a_key)
+        {
+        }
+
+        size_t nb_variables () const
+        {
+            return local_variables.size () + function_arguments.size ();
+        }
+    };
+
+    // The entries, the most recently put first.
+    std::list<Entry> m_entries;
+    std::map<FrameKey, std::list<Entry>::iterator> m_index;
+    size_t m_max_nb_variables;
+    size_t m_max_nb_frames;
+    size_t m_nb_variables;
+    unsigned long m_nb_hits;
+    unsigned long m_nb_misses;
+
+    void erase (std::list<Entry>::iterator a_entry);
+
+    void evict (std::list<Entry>::iterator a_entry,
+                IDebugger::VariableList &a_evicted);
+
+public:
+    enum {
+        DEFAULT_MAX_NB_VARIABLES = 512,
+        DEFAULT_MAX_NB_FRAMES = 32
+    };
+
+    VarObjPool (size_t a_max_nb_variables = DEFAULT_MAX_NB_VARIABLES,
+                size_t a_max_nb_frames = DEFAULT_MAX_NB_FRAMES);
+
+    /// Put the variables of a frame in the pool, replacing those the
+    /// pool might already have for that frame.  Frames are dropped
+    /// from the pool, least recently put first, until it holds at
+    /// most max_nb_variables () variables and max_nb_frames ()
+    /// frames.
+    /// \param a_evicted output parameter.  Set to the variables that
+    /// were dropped from the pool, or that couldn't be put in it.
+    /// Nobody is going to reuse their variable objects, so the
+    /// caller should delete them.
+    void put (const FrameKey &a_key,
+              const IDebugger::VariableList &a_local_variables,
+              const IDebugger::VariableList &a_function_arguments,
+              IDebugger::VariableList &a_evicted);
+
+    /// Take the variables of a frame out of the pool.
+    /// \return true if the pool had variables for the frame, false
+    /// otherwise.
+    bool take (const FrameKey &a_key,
+               IDebugger::VariableList &a_local_variables,
+               IDebugger::VariableList &a_function_arguments);
+
+    /// Drop all the variables of the pool.
+    void clear ();
+
+    size_t max_nb_variables () const {return m_max_nb_variables;}
+
+    size_t max_nb_frames () const {return m_max_nb_frames;}
+
+    size_t nb_frames () const {return m_entries.size ();}
+
+    size_t nb_variables () const {return m_nb_variables;}
+
+    /// \return the number of calls to take that found their frame.
+    unsigned long nb_hits () const {return m_nb_hits;}
+
+    /// \return the number of calls to take that didn't.
+    unsigned long nb_misses () const {return m_nb_misses;}
+};//end class VarObjPool
+
+/// Gathers the latencies of the commands sent to the debugger, by
+/// command name.
+class CommandLatencyStats {
+public:
+    /// The times at which the result of a command went through the
+    /// engine, as returned by g_get_monotonic_time.
+    struct ResultTimes {
+        // When the first byte of the output record was read.
+        int64_t first_byte;
+        // When the last byte of the output record was read.
+        int64_t received;
+        // When the parsing of the output record started.  The
+        // records read at once are parsed and handled one after the
+        // other.
+        int64_t parsing;
+        // When the output record was parsed.
+        int64_t parsed;
+        // When the output handlers were done with it.
+        int64_t handled;
+
+        ResultTimes () :
+            first_byte (0),
+            received (0),
+            parsing (0),
+            parsed (0),
+            handled (0)
+        {}
+    };//end struct ResultTimes
+
+private:
+    IDebugger::CommandLatencyMap m_stats;
+
+public:
+    /// Account for the result of a command.  Commands that were sent
+    /// without being queued are accounted for as if they were queued
+    /// when they were sent.
+    void record (const Command &a_command, const ResultTimes &a_times);
+
+    const IDebugger::CommandLatencyMap& stats () const {return m_stats;}
+
+    void clear () {m_stats.clear ();}
+
+    /// Write the statistics in a_out, one JSON object per line and
+    /// per phase of each command name.
+    void write (std::ostream &a_out) const;
+
+    /// \return the name a_command is accounted under: its name, or
+    /// the GDB/MI command it sends if it has none.
+    static std::string command_key (const Command &a_command);
+};//end class CommandLatencyStats
+
 NEMIVER_END_NAMESPACE (nemiver)
 
 #endif //__NMV_DBG_COMMON_H_H__
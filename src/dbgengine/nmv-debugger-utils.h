@@ -109,6 +109,11 @@ dump_variable_value (const IDebugger::Variable &a_var,
             a_os << "\n";
             dump_variable_value (**it, a_indent_num + 2, a_os, true);
         }
+        // Only the first children of a big container might have
+        // been unfolded.  Say so, rather than silently dropping the
+        // others.
+        if (a_var.needs_more_unfolding ())
+            a_os << "\n" << ws_string << "  ...";
         a_os << "\n" << ws_string <<  "}";
     } else {
         if (a_print_var_name)
@@ -22,6 +22,7 @@
  *
  *See COPYRIGHT file copyright information.
  */
+#include <cstdlib>
 #include <cstring>
 #include <ctype.h>
 #include <unistd.h>
@@ -30,6 +31,7 @@
 #include <termios.h>
 #include <sstream>
 #include <algorithm>
+#include <set>
 #include <memory>
 #include <fstream>
 #include <iostream>
@@ -63,10 +65,16 @@ using nemiver::debugger_utils::null_default_slot;
 using nemiver::debugger_utils::null_breakpoints_slot;
 
 static const char* GDBMI_OUTPUT_DOMAIN = "gdbmi-output-domain";
+static const char* OUTPUT_HANDLER_STATS_DOMAIN = "output-handler-stats-domain";
+static const char* COMMAND_LATENCY_DOMAIN = "command-latency-domain";
 static const char* DEFAULT_GDB_BINARY = "default-gdb-binary";
 static const char* GDB_DEFAULT_PRETTY_PRINTING_VISUALIZER =
     "gdb.default_visualizer";
 static const char* GDB_NULL_PRETTY_PRINTING_VISUALIZER = "None";
+// The maximum number of step commands waiting in the queue.  The
+// steps requested past that, e.g. by a step key held down, are
+// dropped.
+static const unsigned MAX_QUEUED_STEPS = 2;
 
 NEMIVER_BEGIN_NAMESPACE (nemiver)
 
@@ -204,12 +212,66 @@ public:
     Glib::RefPtr<Glib::IOChannel> gdb_stdout_channel;
     Glib::RefPtr<Glib::IOChannel> gdb_stderr_channel;
     Glib::RefPtr<Glib::IOChannel> master_pty_channel;
-    std::string gdb_stdout_buffer;
+    GDBMIRecordReader gdb_stdout_reader;
     std::string gdb_stderr_buffer;
     list<Command> queued_commands;
+    // The commands that have been sent to GDB and whose result
+    // record hasn't been received yet, in the order they were sent.
     list<Command> started_commands;
-    bool line_busy;
+    // The maximum number of commands that can be sent to GDB without
+    // waiting for their results.
+    unsigned max_commands_in_flight;
+    unsigned last_command_token;
+    // The token of the started command whose output is being
+    // handled, or 0 if there is none, e.g, while an out of band
+    // record is handled.
+    unsigned handled_command_token;
+    // When the first byte of the output record being read from GDB
+    // was read, or 0 if no record is partially read.
+    int64_t stdout_first_byte_time;
+    // When the output records being handled were completely read.
+    int64_t stdout_received_time;
+    // The latencies of the commands, by command name.
+    CommandLatencyStats latency_stats;
     map<string, IDebugger::Breakpoint> cached_breakpoints;
+    // The memory of the inferior, as read since it last ran.
+    MemoryCache memory_cache;
+    // The variable objects of the frames recently displayed.
+    VarObjPool varobj_pool;
+    // A root variable object to update with the next
+    // -var-update --all-values * command.
+    struct VarUpdateRequest {
+        IDebugger::VariableSafePtr root;
+        ConstVariableListSlot slot;
+        UString cookie;
+    };
+    // The requests waiting for the next -var-update * command.
+    list<VarUpdateRequest> var_update_requests;
+    // The requests waiting for the result of -var-update * commands,
+    // keyed by the tag2 of the commands.
+    map<int, list<VarUpdateRequest> > var_update_batches;
+    int last_var_update_batch;
+    // The changes that -var-update * commands reported for the root
+    // variable objects no request was about, keyed by the name of
+    // the roots.  They are applied when the roots are updated next.
+    map<UString, list<VarChangePtr> > unclaimed_var_changes;
+    // The internal names of the root variable objects that were
+    // created and not deleted yet.  Only their unclaimed changes
+    // are kept.
+    set<UString> live_var_roots;
+    // The memory writes that one of their -data-write-memory-bytes
+    // commands failed for, keyed by the tag2 of the commands.
+    set<int> failed_memory_writes;
+    // The read_memory requests to answer from the memory cache, from
+    // an idle source.
+    struct CachedMemoryRead {
+        size_t addr;
+        size_t size;
+        UString cookie;
+    };
+    list<CachedMemoryRead> cached_memory_reads;
+    sigc::connection cached_memory_reads_connection;
+    int last_memory_write;
     enum InBufferStatus {
         DEFAULT,
         FILLING,
@@ -499,9 +561,15 @@ public:
 
         Output output (a_buf);
 
-        UString::size_type from (0), to (0), end (a_buf.size ());
-        gdbmi_parser.push_input (a_buf);
+        UString::size_type from (0), to (0), end (a_buf.bytes ());
+        // a_buf outlives the parsing below, so let the parser work
+        // directly on its bytes instead of on a copy.
+        gdbmi_parser.push_input (a_buf.raw ().data (), end);
+        CommandLatencyStats::ResultTimes times;
+        times.first_byte = stdout_first_byte_time;
+        times.received = stdout_received_time;
         for (; from < end;) {
+            times.parsing = g_get_monotonic_time ();
             if (!gdbmi_parser.parse_output_record (from, to, output)) {
                 LOG_ERROR ("output record parsing failed: "
                         << a_buf.substr (from, end - from)
@@ -510,11 +578,13 @@ public:
                         << "\nto: " << (int) to << "\n"
                         << "\nstrlen: " << (int) a_buf.size ());
                 gdbmi_parser.skip_output_record (from, to);
+                // Don't let the previous record pass for this one.
+                output = Output (a_buf);
                 output.parsing_succeeded (false);
             } else {
                 output.parsing_succeeded (true);
             }
-
+            times.parsed = g_get_monotonic_time ();
 
             // Check if the output contains the result to a command issued by
             // the user. If yes, build the CommandAndResult, update the
@@ -525,34 +595,44 @@ public:
             output_value.assign (a_buf, from, to - from +1);
             output.raw_value (output_value);
             CommandAndOutput command_and_output;
+            unsigned token = output.has_result_record ()
+                ? output.result_record ().token ()
+                : 0;
             if (output.has_result_record ()) {
-                if (!started_commands.empty ()) {
-                    command_and_output.command (*started_commands.begin ());
+                list<Command>::iterator it = find_started_command (token);
+                if (it != started_commands.end ()) {
+                    command_and_output.command (*it);
                 }
             }
             command_and_output.output (output);
             LOG_DD ("received command was: '"
                     << command_and_output.command ().name ()
                     << "'");
+            handled_command_token = command_and_output.has_command ()
+                ? command_and_output.command ().token ()
+                : 0;
             stdout_signal.emit (command_and_output);
+            handled_command_token = 0;
+            if (command_and_output.has_command ()) {
+                times.handled = g_get_monotonic_time ();
+                latency_stats.record (command_and_output.command (), times);
+            }
             from = to;
             while (from < end && isspace (a_buf.raw ()[from])) {++from;}
             if (output.has_result_record ()/*gdb acknowledged previous
-                                             cmd*/
-                || !output.parsing_succeeded ()) {
+                                             cmd*/) {
                 LOG_DD ("here");
-                if (!started_commands.empty ()) {
-                    started_commands.erase (started_commands.begin ());
+                // The handlers might have changed started_commands,
+                // so look the command up again.
+                list<Command>::iterator it = find_started_command (token);
+                if (it != started_commands.end ()) {
+                    started_commands.erase (it);
                     LOG_DD ("clearing the line");
-                    // we can send another cmd down the wire
-                    line_busy = false;
-                }
-                if (!line_busy
-                    && started_commands.empty ()
-                    && !queued_commands.empty ()) {
-                    issue_command (*queued_commands.begin ());
-                    queued_commands.erase (queued_commands.begin ());
                 }
+                // we can send other cmds down the wire
+                issue_queued_commands ();
+            } else if (!output.parsing_succeeded ()) {
+                on_unparsed_output_record (output_value);
             }
         }
         gdbmi_parser.pop_input ();
@@ -564,7 +644,13 @@ public:
         gdb_stdout_fd (0), gdb_stderr_fd (0),
         master_pty_fd (0),
         is_attached (false),
-        line_busy (false),
+        max_commands_in_flight (4),
+        last_command_token (0),
+        handled_command_token (0),
+        stdout_first_byte_time (0),
+        stdout_received_time (0),
+        last_var_update_batch (0),
+        last_memory_write (0),
         error_buffer_status (DEFAULT),
         state (IDebugger::NOT_STARTED),
         is_running (false),
@@ -583,6 +669,10 @@ public:
         enable_pretty_printing =
             g_getenv ("NMV_DISABLE_PRETTY_PRINTING") == 0;
 
+        const char *max_in_flight = g_getenv ("NMV_MAX_COMMANDS_IN_FLIGHT");
+        if (max_in_flight && atoi (max_in_flight) > 0)
+            max_commands_in_flight = atoi (max_in_flight);
+
         gdb_stdout_signal.connect (sigc::mem_fun
                 (*this, &Priv::on_gdb_stdout_signal));
         master_pty_signal.connect (sigc::mem_fun
@@ -651,8 +741,10 @@ public:
         //right after. Yeah, the next command in the queue will somehow
         //have to be issued to the underlying debugger, leading to
         //the state being switched to IDebugger::RUNNING
+        //The same goes if other commands than the one being
+        //handled are still waiting for their results.
         if (a_state == IDebugger::READY &&
-            !queued_commands.empty ()) {
+            (!queued_commands.empty () || has_other_commands_in_flight ())) {
             return;
         }
 
@@ -900,6 +992,198 @@ public:
         return launch_gdb_real (argv);
     }
 
+    /// \return true if a_command can be sent to GDB while other
+    /// commands are still waiting for their results.
+    static bool can_be_pipelined (const Command &a_command)
+    {
+        const std::string &value = a_command.value ().raw ();
+
+        // The commands that change the execution state of the
+        // inferior must be sent alone, as the commands following
+        // them could otherwise reach GDB while the inferior is
+        // running.  The same goes for the CLI commands and for
+        // -break-insert, as GDB might answer them with an
+        // interactive prompt that would swallow the commands sent
+        // after them.
+        return !value.empty ()
+            && value[0] == '-'
+            && value.compare (0, 6, "-exec-")
+            && value.compare (0, 8, "-target-")
+            && value.compare (0, 11, "-file-exec-")
+            && value.compare (0, 17, "-interpreter-exec")
+            && value.compare (0, 9, "-gdb-exit")
+            && value.compare (0, 13, "-break-insert");
+    }
+
+    /// \return true if a_command can be sent to GDB right away.
+    bool can_issue_command (const Command &a_command) const
+    {
+        if (started_commands.empty ())
+            return true;
+        // A command that can't be pipelined is always alone on
+        // the line.
+        return started_commands.size () < max_commands_in_flight
+            && can_be_pipelined (a_command)
+            && can_be_pipelined (started_commands.front ());
+    }
+
+    /// \return true if a_command steps the inferior.
+    static bool is_step_command (const Command &a_command)
+    {
+        const UString &name = a_command.name ();
+        return name == "step-over"
+            || name == "step-in"
+            || name == "step-out"
+            || name == "step-over-asm"
+            || name == "step-in-asm";
+    }
+
+    /// \return true if commands other than the one whose output is
+    /// being handled were sent to GDB and wait for their results.
+    /// While an out of band record is handled, that is any started
+    /// command.
+    bool has_other_commands_in_flight () const
+    {
+        list<Command>::const_iterator it;
+        for (it = started_commands.begin ();
+             it != started_commands.end ();
+             ++it) {
+            if (it->token () != handled_command_token)
+                return true;
+        }
+        return false;
+    }
+
+    /// \return true if a step command is queued or started.
+    bool has_pending_steps () const
+    {
+        list<Command>::const_iterator it;
+        for (it = started_commands.begin ();
+             it != started_commands.end ();
+             ++it) {
+            if (is_step_command (*it))
+                return true;
+        }
+        for (it = queued_commands.begin ();
+             it != queued_commands.end ();
+             ++it) {
+            if (is_step_command (*it))
+                return true;
+        }
+        return false;
+    }
+
+    /// Queue a step command, unless MAX_QUEUED_STEPS step commands
+    /// are queued already.
+    /// \return true if the command was issued right away.
+    bool queue_step_command (const Command &a_command)
+    {
+        unsigned nb_steps = 0;
+        list<Command>::const_iterator it;
+        for (it = queued_commands.begin ();
+             it != queued_commands.end ();
+             ++it) {
+            if (is_step_command (*it))
+                ++nb_steps;
+        }
+        if (nb_steps >= MAX_QUEUED_STEPS) {
+            LOG_DD ("dropping step command '" << a_command.name ()
+                    << "': " << nb_steps << " steps queued already");
+            return false;
+        }
+        return queue_command (a_command);
+    }
+
+    /// Remove the step commands that haven't been sent to GDB yet.
+    /// The steps that were sent already can't be taken back.
+    void drop_queued_steps ()
+    {
+        list<Command>::iterator it = queued_commands.begin ();
+        while (it != queued_commands.end ()) {
+            if (is_step_command (*it)) {
+                LOG_DD ("dropping queued step command '"
+                        << it->name () << "'");
+                it = queued_commands.erase (it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    /// Find the started command a result record is the result of.
+    /// \param a_token the token of the result record.
+    /// \return an iterator to the command, or started_commands.end ()
+    /// if it wasn't found.
+    list<Command>::iterator find_started_command (unsigned a_token)
+    {
+        list<Command>::iterator it;
+        for (it = started_commands.begin ();
+             it != started_commands.end ();
+             ++it) {
+            if (it->token () == a_token)
+                return it;
+        }
+        // GDB might not have echoed the token back, e.g, if it
+        // failed to parse the command.  The results come in the
+        // order the commands were sent, though.
+        if (!a_token && !started_commands.empty ())
+            return started_commands.begin ();
+        return started_commands.end ();
+    }
+
+    /// Look at the beginning of an output record that couldn't be
+    /// parsed, to tell what kind of record it is.
+    /// \param a_record the raw output record.
+    /// \param a_token out parameter. The token the record starts
+    /// with, or zero if it has none.
+    /// \return the character that tells the kind of the record,
+    /// e.g, '^' for a result record, or 0 if there is none.  If the
+    /// token doesn't fit in an unsigned int, that is its first digit.
+    static char get_output_record_kind (const UString &a_record,
+                                        unsigned &a_token)
+    {
+        const std::string &raw = a_record.raw ();
+        GDBMIParser parser;
+        parser.push_input (raw.data (), raw.size ());
+        UString::size_type cur = 0;
+        parser.parse_token (0, cur, a_token);
+        parser.pop_input ();
+        return cur < raw.size () ? raw[cur] : 0;
+    }
+
+    /// Handle an output record that couldn't be parsed.  If it is
+    /// the result record of a started command, that command is done.
+    /// If that command can't be told, the results of all the started
+    /// commands are considered lost, rather than guessing which one
+    /// the record was the result of.
+    void on_unparsed_output_record (const UString &a_record)
+    {
+        unsigned token = 0;
+        char kind = get_output_record_kind (a_record, token);
+        if (kind && strchr ("*+=~@&", kind))
+            // An out of band record is not the result of a command.
+            return;
+
+        if (kind == '^' && token) {
+            list<Command>::iterator it = find_started_command (token);
+            if (it != started_commands.end ()) {
+                LOG_DD ("clearing the line of command "
+                        << it->name ());
+                started_commands.erase (it);
+                issue_queued_commands ();
+                return;
+            }
+        }
+
+        LOG_ERROR ("could not tell the command of an output record, "
+                   "dropping the " << (int) started_commands.size ()
+                   << " started commands");
+        started_commands.clear ();
+        error_signal.emit (UString ("Could not parse the output of GDB: ")
+                           + a_record);
+        issue_queued_commands ();
+    }
+
     bool issue_command (const Command &a_command,
                         bool a_do_record = true)
     {
@@ -918,18 +1202,31 @@ public:
             set_tty_attributes ();
         }
 
+        // Tag the GDB/MI commands we are going to wait for with a
+        // token, so that their result records can be matched back
+        // to them.
+        Command command (a_command);
+        UString value = command.value ();
+        if (a_do_record && value.raw ().compare (0, 1, "-") == 0) {
+            if (++last_command_token == 0)
+                ++last_command_token;
+            command.token (last_command_token);
+            value = UString::from_int (last_command_token) + value;
+        }
+        command.issued_time (g_get_monotonic_time ());
+
         if (master_pty_channel->write
-                (a_command.value () + "\n") == Glib::IO_STATUS_NORMAL) {
+                (value + "\n") == Glib::IO_STATUS_NORMAL) {
             master_pty_channel->flush ();
-            THROW_IF_FAIL (started_commands.size () <= 1);
-
-            if (a_do_record)
-                started_commands.push_back (a_command);
+            if (a_do_record) {
+                THROW_IF_FAIL (started_commands.size ()
+                               < max_commands_in_flight);
+                started_commands.push_back (command);
+            }
 
             //usually, when we send a command to the debugger,
             //it becomes busy (in a running state), untill it gets
             //back to us saying the converse.
-            line_busy = true;
             set_state (IDebugger::RUNNING);
             return true;
         }
@@ -937,16 +1234,31 @@ public:
         return false;
     }
 
+    /// Send the queued commands to GDB, for as long as they can be
+    /// sent without waiting for the results of the started ones.
+    void issue_queued_commands ()
+    {
+        while (!queued_commands.empty ()
+               && can_issue_command (queued_commands.front ())) {
+            Command command = queued_commands.front ();
+            queued_commands.pop_front ();
+            if (!issue_command (command))
+                break;
+        }
+    }
+
     bool queue_command (const Command &a_command)
     {
-        bool result (false);
         LOG_DD ("queuing command: '" << a_command.value () << "'");
-        queued_commands.push_back (a_command);
-        if (!line_busy && started_commands.empty ()) {
-            result = issue_command (*queued_commands.begin (), true);
-            queued_commands.erase (queued_commands.begin ());
+        Command command (a_command);
+        command.queued_time (g_get_monotonic_time ());
+        queued_commands.push_back (command);
+        if (queued_commands.size () == 1
+            && can_issue_command (command)) {
+            queued_commands.pop_front ();
+            return issue_command (command, true);
         }
-        return result;
+        return false;
     }
 
     /// Resets the GDB command queue so that it is in its initial
@@ -961,7 +1273,7 @@ public:
 
         started_commands.clear ();
         queued_commands.clear ();
-        line_busy = false;
+        failed_memory_writes.clear ();
     }
 
     void set_debugger_parameter (const UString &a_name,
@@ -1068,6 +1380,16 @@ public:
                                     "set inferior-tty " + a_tty_path));
     }
 
+    /// \return true if a_slice is only made of white spaces.
+    static bool is_blank (const GDBMIStringSlice &a_slice)
+    {
+        for (UString::size_type i = 0; i < a_slice.size (); ++i) {
+            if (!isspace (a_slice[i]))
+                return false;
+        }
+        return true;
+    }
+
     bool on_gdb_stdout_has_data_signal (Glib::IOCondition a_cond)
     {
         if (!gdb_stdout_channel) {
@@ -1081,58 +1403,50 @@ public:
             gsize nb_read (0), CHUNK_SIZE(10*1024);
             char buf[CHUNK_SIZE+1];
             Glib::IOStatus status (Glib::IO_STATUS_NORMAL);
-            std::string meaningful_buffer;
+            int64_t read_time = g_get_monotonic_time ();
+            if (!stdout_first_byte_time)
+                stdout_first_byte_time = read_time;
             while (true) {
-                memset (buf, 0, CHUNK_SIZE + 1);
                 status = gdb_stdout_channel->read (buf, CHUNK_SIZE, nb_read);
                 if (status == Glib::IO_STATUS_NORMAL &&
                     nb_read && (nb_read <= CHUNK_SIZE)) {
-                    std::string raw_str (buf, nb_read);
-                    gdb_stdout_buffer.append (raw_str);
+                    LOG_DD ("gdb stdout chunk: <buf>"
+                            << std::string (buf, nb_read)
+                            << "</buf>");
+                    gdb_stdout_reader.append (buf, nb_read);
                 } else {
                     break;
                 }
                 nb_read = 0;
             }
-            LOG_DD ("gdb_stdout_buffer: <buf>"
-                    << gdb_stdout_buffer
-                    << "</buf>");
-
-            UString::size_type i = 0;
-            while ((i = gdb_stdout_buffer.find ("\n(gdb)")) !=
-                   std::string::npos) {
-                i += 6;/*is the offset in the buffer of the end of
-                         *of the '(gdb)' prompt
-                         */
-                int size = i+1;
-                //basically, gdb can send more or less than a complete
-                //output record. So let's take that in account in the way
-                //we manage he incoming buffer.
-                //TODO: optimize the way we handle this so that we do
-                //less allocation and copying.
-                meaningful_buffer = gdb_stdout_buffer.substr (0, size);
-                str_utils::chomp (meaningful_buffer);
+
+            // Basically, gdb can send more or less than a complete
+            // output record.  The reader keeps the incomplete ones
+            // around until the rest of their bytes comes in.
+            GDBMIStringSlice record;
+            stdout_received_time = g_get_monotonic_time ();
+            while (gdb_stdout_reader.next_record (record)) {
+                UString meaningful_buffer = record.to_ustring ();
                 meaningful_buffer += '\n';
                 LOG_DD ("emiting gdb_stdout_signal () with '"
                         << meaningful_buffer << "'");
                 gdb_stdout_signal.emit (meaningful_buffer);
-                gdb_stdout_buffer.erase (0, size);
-                while (!gdb_stdout_buffer.empty ()
-                       && isspace (gdb_stdout_buffer[0])) {
-                    gdb_stdout_buffer.erase (0,1);
-                }
+                // The bytes of the records that follow were read
+                // just now.
+                stdout_first_byte_time = read_time;
             }
-            if (gdb_stdout_buffer.find ("[0] cancel")
-                    != std::string::npos
-                && gdb_stdout_buffer.find ("> ")
-                    != std::string::npos) {
+            GDBMIStringSlice pending = gdb_stdout_reader.pending ();
+            if (is_blank (pending))
+                stdout_first_byte_time = 0;
+            if (pending.find ("[0] cancel") != UString::npos
+                && pending.find ("> ") != UString::npos) {
                 // this is not a gdbmi ouptut, but rather a plain gdb
                 // command line. It is actually a prompt sent by gdb
                 // to let the user choose between a list of
                 // overloaded functions
                 LOG_DD ("emitting gdb_stdout_signal.emit()");
-                gdb_stdout_signal.emit (gdb_stdout_buffer);
-                gdb_stdout_buffer.clear ();
+                gdb_stdout_signal.emit (pending.to_ustring ());
+                gdb_stdout_reader.clear ();
             }
         }
         if (a_cond & Glib::IO_HUP) {
@@ -1207,6 +1521,295 @@ public:
     void on_running_signal ()
     {
         is_running = true;
+        // The memory of the inferior is about to change.
+        memory_cache.invalidate ();
+    }
+
+    /// Answer the read_memory requests from the memory cache.  This
+    /// is called from an idle source, so that the read_memory_signal
+    /// is emitted asynchronously, as when the memory is read from GDB.
+    bool on_cached_memory_reads ()
+    {
+        NEMIVER_TRY
+
+        // Requests made by the slots of read_memory_signal need a
+        // new idle source.
+        cached_memory_reads_connection = sigc::connection ();
+        list<CachedMemoryRead> reads;
+        reads.swap (cached_memory_reads);
+
+        list<CachedMemoryRead>::const_iterator it;
+        for (it = reads.begin (); it != reads.end (); ++it) {
+            vector<uint8_t> values;
+            if (memory_cache.read (it->addr, it->size, values)) {
+                read_memory_signal.emit (it->addr, values, it->cookie);
+            } else {
+                // The cache was invalidated in the mean time.
+                read_memory (it->addr, it->size, it->cookie);
+            }
+        }
+
+        NEMIVER_CATCH_NOX
+        return false;
+    }
+
+    void read_memory (size_t a_addr,
+                      size_t a_num_bytes,
+                      const UString &a_cookie)
+    {
+        // A read that would fill a good part of the cache is not
+        // cached, lest it evicts its own first pages before its last
+        // ones are read.
+        if (a_num_bytes > memory_cache.max_nb_pages ()
+                          * MemoryCache::CACHE_PAGE_SIZE / 2) {
+            UString cmd;
+            cmd.printf ("-data-read-memory-bytes %zu %zu",
+                        a_addr, a_num_bytes);
+            Command command ("read-memory", cmd, a_cookie);
+            command.tag0 ("read-memory");
+            queue_command (command);
+            return;
+        }
+
+        list<MemoryCache::Range> ranges;
+        memory_cache.get_missing_ranges (a_addr, a_num_bytes, ranges);
+
+        if (ranges.empty ()) {
+            CachedMemoryRead read = {a_addr, a_num_bytes, a_cookie};
+            cached_memory_reads.push_back (read);
+            if (!cached_memory_reads_connection.connected ()) {
+                Glib::RefPtr<Glib::IdleSource> source =
+                    Glib::IdleSource::create ();
+                cached_memory_reads_connection =
+                    source->connect (sigc::mem_fun
+                                        (*this,
+                                         &Priv::on_cached_memory_reads));
+                source->attach (get_event_loop_context ());
+            }
+            return;
+        }
+
+        // Fetch the missing pages.  The handler of the last command
+        // answers the whole request from the cache.  The commands
+        // are stamped with the clock of the cache, so that the pages
+        // written after the memory was requested are not cached.
+        list<MemoryCache::Range>::const_iterator it;
+        for (it = ranges.begin (); it != ranges.end ();) {
+            UString cmd;
+            cmd.printf ("-data-read-memory-bytes %zu %zu",
+                        it->first, it->second);
+            Command command ("read-memory", cmd, a_cookie);
+            command.tag0 ("read-memory");
+            command.tag1 (UString::from_int (a_addr));
+            command.tag3 (UString::from_int (a_num_bytes));
+            command.tag4 (UString::from_int (memory_cache.clock ()));
+            if (++it == ranges.end ())
+                command.tag2 (1);
+            queue_command (command);
+        }
+    }
+
+    /// Record that a command of a memory write is done.
+    /// \param a_write the tag2 of the command.
+    /// \param a_is_last true if it is the last command of the write.
+    /// \param a_failed true if the command failed.
+    /// \return true if a_is_last is true and none of the commands of
+    /// the write failed.
+    bool end_memory_write_command (int a_write,
+                                   bool a_is_last,
+                                   bool a_failed)
+    {
+        if (!a_is_last) {
+            if (a_failed)
+                failed_memory_writes.insert (a_write);
+            return false;
+        }
+        bool an_earlier_command_failed = failed_memory_writes.erase (a_write);
+        return !a_failed && !an_earlier_command_failed;
+    }
+
+    /// Register a root variable object to update with the next
+    /// -var-update --all-values * command.  That command is sent from
+    /// an idle source, so that all the roots registered until then,
+    /// typically by all the widgets that handle the stopped signal,
+    /// are updated at once.
+    void list_changed_variables_of_all (const IDebugger::VariableSafePtr a_root,
+                                   const ConstVariableListSlot &a_slot,
+                                   const UString &a_cookie)
+    {
+        if (var_update_requests.empty ()) {
+            Glib::RefPtr<Glib::IdleSource> source =
+                Glib::IdleSource::create ();
+            source->connect (sigc::mem_fun
+                                (*this, &Priv::on_update_all_variables));
+            source->attach (get_event_loop_context ());
+        }
+        VarUpdateRequest request;
+        request.root = a_root;
+        request.slot = a_slot;
+        request.cookie = a_cookie;
+        var_update_requests.push_back (request);
+    }
+
+    bool on_update_all_variables ()
+    {
+        NEMIVER_TRY
+
+        if (var_update_requests.empty ())
+            return false;
+
+        int batch = ++last_var_update_batch;
+        var_update_batches[batch].swap (var_update_requests);
+
+        Command command ("update-all-variables",
+                         "-var-update --all-values *");
+        command.tag2 (batch);
+        queue_command (command);
+
+        NEMIVER_CATCH_NOX
+
+        return false;
+    }
+
+    /// Append the changes a_new_changes to a_changes, which were
+    /// reported earlier for the same root.  A change that only
+    /// carries a new value is superseded by a later change of the
+    /// same variable, which carries the newer value, so it is
+    /// dropped.  This keeps the unclaimed changes of a root from
+    /// growing at each stop.
+    static void append_var_changes (list<VarChangePtr> &a_changes,
+                                    list<VarChangePtr> &a_new_changes)
+    {
+        set<UString> changed_vars;
+        list<VarChangePtr>::const_iterator new_it;
+        for (new_it = a_new_changes.begin ();
+             new_it != a_new_changes.end ();
+             ++new_it)
+            changed_vars.insert ((*new_it)->variable ()->internal_name ());
+
+        list<VarChangePtr>::iterator it = a_changes.begin ();
+        while (it != a_changes.end ()) {
+            if ((*it)->new_num_children () < 0
+                && changed_vars.count ((*it)->variable ()->internal_name ()))
+                it = a_changes.erase (it);
+            else
+                ++it;
+        }
+        a_changes.splice (a_changes.end (), a_new_changes);
+    }
+
+    /// Move the changes that were reported for the root variable
+    /// object named a_root_name, but were not applied yet, to
+    /// a_changes.
+    void take_unclaimed_var_changes (const UString &a_root_name,
+                                     list<VarChangePtr> &a_changes)
+    {
+        map<UString, list<VarChangePtr> >::iterator it =
+            unclaimed_var_changes.find (a_root_name);
+        if (it == unclaimed_var_changes.end ())
+            return;
+        a_changes.splice (a_changes.end (), it->second);
+        unclaimed_var_changes.erase (it);
+    }
+
+    /// Forget about a root variable object that is being deleted,
+    /// and about its unclaimed changes.
+    void forget_var_root (const UString &a_internal_name)
+    {
+        live_var_roots.erase (a_internal_name);
+        unclaimed_var_changes.erase (a_internal_name);
+    }
+
+    /// Forget about all the root variable objects, e.g, because
+    /// their inferior is gone.
+    void forget_var_roots ()
+    {
+        live_var_roots.clear ();
+        unclaimed_var_changes.clear ();
+    }
+
+    /// Apply the changes reported by the -var-update * command of
+    /// the batch a_batch to the roots of its requests, and invoke
+    /// their slots.
+    void dispatch_var_changes (int a_batch,
+                               const list<VarChangePtr> &a_changes)
+    {
+        map<int, list<VarUpdateRequest> >::iterator batch_it =
+            var_update_batches.find (a_batch);
+        if (batch_it == var_update_batches.end ())
+            return;
+        list<VarUpdateRequest> requests;
+        requests.swap (batch_it->second);
+        var_update_batches.erase (batch_it);
+
+        // The names of the children of a variable object start with
+        // the name of their root, followed by a dot.
+        map<UString, list<VarChangePtr> > changes_by_root;
+        list<VarChangePtr>::const_iterator change_it;
+        for (change_it = a_changes.begin ();
+             change_it != a_changes.end ();
+             ++change_it) {
+            const UString &name = (*change_it)->variable ()->internal_name ();
+            changes_by_root[name.substr (0, name.find ('.'))]
+                .push_back (*change_it);
+        }
+
+        list<VarUpdateRequest>::const_iterator it;
+        for (it = requests.begin (); it != requests.end (); ++it) {
+            list<VarChangePtr> changes;
+            take_unclaimed_var_changes (it->root->internal_name (), changes);
+            map<UString, list<VarChangePtr> >::iterator root_changes =
+                changes_by_root.find (it->root->internal_name ());
+            if (root_changes != changes_by_root.end ()) {
+                changes.splice (changes.end (), root_changes->second);
+                changes_by_root.erase (root_changes);
+            }
+
+            list<IDebugger::VariableSafePtr> vars;
+            for (change_it = changes.begin ();
+                 change_it != changes.end ();
+                 ++change_it)
+                (*change_it)->apply_to_variable (it->root, vars);
+
+            it->slot (vars);
+            changed_variables_signal.emit (vars, it->cookie);
+        }
+
+        // Keep the changes of the other roots until they are updated,
+        // unless they were deleted in the mean time.
+        map<UString, list<VarChangePtr> >::iterator root_changes;
+        for (root_changes = changes_by_root.begin ();
+             root_changes != changes_by_root.end ();
+             ++root_changes) {
+            if (!live_var_roots.count (root_changes->first))
+                continue;
+            append_var_changes (unclaimed_var_changes[root_changes->first],
+                                root_changes->second);
+        }
+    }
+
+    /// Forget about the requests served by a -var-update * command
+    /// that failed.  Their slots are invoked with no changed
+    /// variables.  The unclaimed changes are kept for the next
+    /// update.
+    ///
+    /// \param a_batch the identifier of the requests.
+    void drop_var_update_batch (int a_batch)
+    {
+        map<int, list<VarUpdateRequest> >::iterator batch_it =
+            var_update_batches.find (a_batch);
+        if (batch_it == var_update_batches.end ())
+            return;
+        list<VarUpdateRequest> requests;
+        requests.swap (batch_it->second);
+        var_update_batches.erase (batch_it);
+
+        list<VarUpdateRequest>::const_iterator it;
+        for (it = requests.begin (); it != requests.end (); ++it) {
+            list<IDebugger::VariableSafePtr> vars;
+            it->slot (vars);
+            changed_variables_signal.emit (vars, it->cookie);
+        }
     }
 
     void on_state_changed_signal (IDebugger::State a_state)
@@ -1313,6 +1916,7 @@ public:
 
     ~Priv ()
     {
+        cached_memory_reads_connection.disconnect ();
         kill_gdb ();
     }
 };//end GDBEngine::Priv
@@ -1333,6 +1937,11 @@ struct OnStreamRecordHandler: OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return OUT_OF_BAND_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (!a_in.output ().has_out_of_band_record ()) {
@@ -1390,6 +1999,16 @@ struct OnDetachHandler : OutputHandler {
     {
     }
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("detach-from-target");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -1574,6 +2193,11 @@ struct OnBreakpointHandler: OutputHandler {
         m_engine->breakpoints_set_signal ().emit (bps, "");
     }
 
+    unsigned handled_output_kinds () const
+    {
+        return OUT_OF_BAND_OUTPUT | ANY_RESULT_OUTPUT;
+    }
+
     bool
     can_handle (CommandAndOutput &a_in)
     {
@@ -1717,6 +2341,11 @@ struct OnStoppedHandler: OutputHandler {
         m_is_stopped (false)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return OUT_OF_BAND_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (!a_in.output ().has_out_of_band_record ()) {
@@ -1770,6 +2399,15 @@ struct OnStoppedHandler: OutputHandler {
                     (m_out_of_band_record.frame ().level ());
         }
 
+        // The steps queued behind the one that just ended would carry
+        // on from wherever the inferior stopped, e.g. from a breakpoint
+        // or a signal, or fail because it exited.  Drop them, before
+        // the stop is signalled, so that the views see no pending steps
+        // and are refreshed.
+        if (reason != IDebugger::END_STEPPING_RANGE
+            && reason != IDebugger::FUNCTION_FINISHED)
+            m_engine->drop_queued_steps ();
+
         m_engine->stopped_signal ().emit
                     (m_out_of_band_record.stop_reason (),
                      m_out_of_band_record.has_frame (),
@@ -1797,6 +2435,11 @@ struct OnFileListHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return ANY_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         THROW_IF_FAIL (m_engine);
@@ -1829,6 +2472,11 @@ struct OnThreadListHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return ANY_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         THROW_IF_FAIL (m_engine);
@@ -1861,6 +2509,11 @@ struct OnThreadSelectedHandler : OutputHandler {
         has_frame (false)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return OUT_OF_BAND_OUTPUT | ANY_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         THROW_IF_FAIL (m_engine);
@@ -1928,6 +2581,11 @@ struct OnCommandDoneHandler : OutputHandler {
         return true;
     }
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record () &&
@@ -2021,6 +2679,11 @@ struct OnRunningHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return RUNNING_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record () &&
@@ -2062,6 +2725,11 @@ struct OnConnectedHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return CONNECTED_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record () &&
@@ -2089,6 +2757,11 @@ struct OnFramesListedHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -2134,6 +2807,11 @@ struct OnFramesParamsListedHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -2175,6 +2853,11 @@ struct OnCurrentFrameHandler : OutputHandler {
     {
     }
 
+    unsigned handled_output_kinds () const
+    {
+        return ANY_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().result_record
@@ -2202,6 +2885,11 @@ struct OnInfoProcHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return OUT_OF_BAND_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.has_command ()
@@ -2239,6 +2927,11 @@ struct OnLocalVariablesListedHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -2277,6 +2970,16 @@ struct OnGlobalVariablesListedHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return ANY_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("list-global-variables");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.command ().name () == "list-global-variables") {
@@ -2336,6 +3039,23 @@ struct OnResultRecordHandler : OutputHandler {
 
     // TODO: split this OutputHandler into several different handlers.
     // Ideally there should be one handler per command sent to GDB.
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("print-variable-value");
+        a_names.push_back ("get-variable-value");
+        a_names.push_back ("print-pointed-variable-value");
+        a_names.push_back ("dereference-variable");
+        a_names.push_back ("set-register-value");
+        a_names.push_back ("set-memory");
+        a_names.push_back ("assign-variable");
+        a_names.push_back ("evaluate-expression");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if ((a_in.command ().name () == "print-variable-value"
@@ -2514,6 +3234,17 @@ struct OnVariableTypeHandler : OutputHandler {
         THROW_IF_FAIL (m_engine);
     }
 
+    unsigned handled_output_kinds () const
+    {
+        return OUT_OF_BAND_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("print-variable-type");
+        a_names.push_back ("get-variable-type");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if ((a_in.command ().name () == "print-variable-type"
@@ -2612,6 +3343,11 @@ struct OnSignalReceivedHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return OUT_OF_BAND_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (!a_in.output ().has_out_of_band_record ()) {
@@ -2650,6 +3386,11 @@ struct OnRegisterNamesListedHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -2680,6 +3421,11 @@ struct OnChangedRegistersListedHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -2710,6 +3456,11 @@ struct OnRegisterValuesListedHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -2740,6 +3491,16 @@ struct OnSetRegisterValueHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("set-register-value");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -2764,6 +3525,58 @@ struct OnSetRegisterValueHandler : OutputHandler {
     }
 };//struct OnSetRegisterValueHandler
 
+/// Answer a read_memory request that part of the memory couldn't be
+/// read for.  The answer starts at the requested address, so that
+/// the requester can tell it is the answer to its request, and stops
+/// at the first byte that couldn't be read.  So the requester is told
+/// that the rest of the range is unreadable by an answer shorter than
+/// requested, possibly empty.
+/// \param a_engine the engine to emit read_memory_signal from.
+/// \param a_command the last command of the request.
+/// \param a_record the result record of a_command, if it has one.
+static void
+emit_partial_memory_read (GDBEngine *a_engine,
+                          const Command &a_command,
+                          const Output::ResultRecord *a_record)
+{
+    size_t addr = strtoull (a_command.tag1 ().c_str (), 0, 10);
+    size_t size = strtoull (a_command.tag3 ().c_str (), 0, 10);
+    size_t end = addr + size;
+    LOG_DD ("could not read the whole range at " << (int) addr);
+
+    // The parts of the last range that are not whole pages are not
+    // cached, they are only in the record.
+    size_t record_addr = 0;
+    const vector<uint8_t> *record_values = 0;
+    if (a_record && a_record->has_memory_values ()) {
+        record_addr = a_record->memory_address ();
+        record_values = &a_record->memory_values ();
+    }
+
+    MemoryCache &cache = a_engine->get_memory_cache ();
+    vector<uint8_t> values;
+    while (addr + values.size () < end) {
+        size_t cur = addr + values.size ();
+        size_t page_end = std::min (MemoryCache::page_of (cur)
+                                    + MemoryCache::CACHE_PAGE_SIZE,
+                                    end);
+        vector<uint8_t> chunk;
+        if (!cache.read (cur, page_end - cur, chunk)) {
+            if (!record_values
+                || cur < record_addr
+                || cur >= record_addr + record_values->size ())
+                break;
+            size_t chunk_end =
+                std::min (record_addr + record_values->size (), page_end);
+            chunk.assign (record_values->begin () + (cur - record_addr),
+                          record_values->begin () + (chunk_end - record_addr));
+        }
+        values.insert (values.end (), chunk.begin (), chunk.end ());
+    }
+    a_engine->read_memory_signal ().emit (addr, values,
+                                          a_command.cookie ());
+}
+
 struct OnReadMemoryHandler : OutputHandler {
 
     GDBEngine *m_engine;
@@ -2772,6 +3585,16 @@ struct OnReadMemoryHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("read-memory");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -2787,10 +3610,45 @@ struct OnReadMemoryHandler : OutputHandler {
     void do_handle (CommandAndOutput &a_in)
     {
         LOG_FUNCTION_SCOPE_NORMAL_DD;
-        m_engine->read_memory_signal ().emit
-            (a_in.output ().result_record ().memory_address (),
-             a_in.output ().result_record ().memory_values (),
-             a_in.command ().cookie ());
+
+        const Output::ResultRecord &record = a_in.output ().result_record ();
+        if (a_in.command ().name () != "read-memory"
+            || a_in.command ().tag3 ().empty ()) {
+            m_engine->read_memory_signal ().emit
+                (record.memory_address (),
+                 record.memory_values (),
+                 a_in.command ().cookie ());
+            m_engine->set_state (IDebugger::READY);
+            return;
+        }
+
+        // The pages invalidated since the command was queued, e.g,
+        // because the memory was written, might be out of date in
+        // what the command read, so they are not cached.
+        MemoryCache &cache = m_engine->get_memory_cache ();
+        unsigned long stamp =
+            strtoul (a_in.command ().tag4 ().c_str (), 0, 10);
+        cache.store (record.memory_address (), record.memory_values (),
+                     stamp);
+
+        // A read can be split into several commands, one per range of
+        // missing pages.  Only the last one answers the request.
+        if (a_in.command ().tag2 ()) {
+            size_t addr = strtoull (a_in.command ().tag1 ().c_str (), 0, 10);
+            size_t size = strtoull (a_in.command ().tag3 ().c_str (), 0, 10);
+            vector<uint8_t> values;
+            if (cache.read (addr, size, values)) {
+                m_engine->read_memory_signal ().emit
+                    (addr, values, a_in.command ().cookie ());
+            } else if (cache.invalidated_since (addr, size, stamp)) {
+                // Read the memory again, as it is now.
+                m_engine->read_memory (addr, size,
+                                       a_in.command ().cookie ());
+            } else {
+                emit_partial_memory_read (m_engine, a_in.command (),
+                                          &record);
+            }
+        }
         m_engine->set_state (IDebugger::READY);
     }
 };//struct OnReadMemoryHandler
@@ -2803,6 +3661,16 @@ struct OnSetMemoryHandler : OutputHandler
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("set-memory");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -2818,13 +3686,29 @@ struct OnSetMemoryHandler : OutputHandler
     void do_handle (CommandAndOutput &a_in)
     {
         LOG_FUNCTION_SCOPE_NORMAL_DD;
-        size_t addr = 0;
-        std::istringstream istream (a_in.command ().tag1 ());
-        istream >> std::hex >> addr;
-        m_engine->set_memory_signal ().emit
-            (addr,
-             std::vector<uint8_t>(), // FIXME: get memory value here
-             a_in.command ().cookie ());
+
+        // A write can be split into several commands.  Only the last
+        // one carries the whole write, and notifies about it if none
+        // of the commands failed.
+        bool is_last = !a_in.command ().tag3 ().empty ();
+        if (m_engine->end_memory_write_command (a_in.command ().tag2 (),
+                                                is_last,
+                                                false)) {
+            size_t addr = 0;
+            std::istringstream istream (a_in.command ().tag1 ());
+            istream >> std::hex >> addr;
+
+            const std::string &hex = a_in.command ().tag3 ().raw ();
+            std::vector<uint8_t> bytes;
+            bytes.reserve (hex.size () / 2);
+            for (std::string::size_type i = 0; i + 1 < hex.size (); i += 2) {
+                bytes.push_back
+                    (static_cast<uint8_t> (g_ascii_xdigit_value (hex[i]) << 4
+                                           | g_ascii_xdigit_value (hex[i + 1])));
+            }
+            m_engine->set_memory_signal ().emit (addr, bytes,
+                                                 a_in.command ().cookie ());
+        }
         m_engine->set_state (IDebugger::READY);
     }
 };//struct OnSetRegisterValueHandler
@@ -2838,6 +3722,11 @@ struct OnErrorHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return ERROR_RESULT_OUTPUT;
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -2854,6 +3743,28 @@ struct OnErrorHandler : OutputHandler {
         LOG_FUNCTION_SCOPE_NORMAL_DD;
 
         THROW_IF_FAIL (m_engine);
+        if (a_in.command ().name () == "set-memory")
+            m_engine->end_memory_write_command
+                (a_in.command ().tag2 (),
+                 !a_in.command ().tag3 ().empty (),
+                 true);
+        // The request a read of memory was split for still gets its
+        // answer if its last command failed.
+        if (a_in.command ().name () == "read-memory"
+            && a_in.command ().tag2 ()
+            && !a_in.command ().tag3 ().empty ())
+            emit_partial_memory_read (m_engine, a_in.command (), 0);
+        if (a_in.command ().name () == "update-all-variables")
+            m_engine->drop_var_update_batch (a_in.command ().tag2 ());
+        // The caller of a windowed unfolding gets its variable back
+        // unchanged, so that it can offer to unfold the window again.
+        if (a_in.command ().name () == "unfold-variable"
+            && a_in.command ().tag2 ()
+            && a_in.command ().has_slot ()) {
+            typedef sigc::slot<void, const IDebugger::VariableSafePtr> SlotType;
+            SlotType slot = a_in.command ().get_slot<SlotType> ();
+            slot (a_in.command ().variable ());
+        }
         m_engine->error_signal ().emit
             (a_in.output ().result_record ().attrs ()["msg"]);
 
@@ -2872,6 +3783,17 @@ struct OnDisassembleHandler : OutputHandler {
         m_engine (a_engine)
     {}
 
+    unsigned handled_output_kinds () const
+    {
+        return ANY_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("disassemble-address-range");
+        a_names.push_back ("disassemble-line-range-in-file");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (!a_in.command ().name ().raw ().compare (0,
@@ -2925,9 +3847,19 @@ struct OnCreateVariableHandler : public OutputHandler
 {
     GDBEngine *m_engine;
 
-    OnCreateVariableHandler (GDBEngine *a_engine) :
-        m_engine (a_engine)
+    OnCreateVariableHandler (GDBEngine *a_engine) :
+        m_engine (a_engine)
+    {
+    }
+
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
     {
+        a_names.push_back ("create-variable");
     }
 
     bool can_handle (CommandAndOutput &a_in)
@@ -2948,6 +3880,7 @@ struct OnCreateVariableHandler : public OutputHandler
         VariableSafePtr var = a_in.output ().result_record ().variable ();
         if (!var->internal_name ().empty ())
         var->debugger (m_engine);
+        m_engine->register_var_root (var->internal_name ());
 
         // Set the name of the variable to the name that got stored
         // in the tag0 member of the command.
@@ -2983,6 +3916,16 @@ struct OnDeleteVariableHandler : public OutputHandler {
     {
     }
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("delete-variable");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -3033,6 +3976,16 @@ struct OnUnfoldVariableHandler : public OutputHandler {
     {
     }
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("unfold-variable");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if ((a_in.output ().result_record ().kind ()
@@ -3061,6 +4014,23 @@ struct OnUnfoldVariableHandler : public OutputHandler {
              ++it) {
             parent_var->append (*it);
         }
+        // When only a window of the children was asked for, GDB tells
+        // whether there are children past it.  It says there are none
+        // when all the children were asked for.
+        parent_var->has_more_children
+            (a_in.output ().result_record ().has_more_variable_children ());
+
+        // GDB keeps updating all the children of a dynamic variable
+        // object, even those that were not listed.  Limit its updates
+        // to the children unfolded so far.
+        if (a_in.command ().tag2 () && parent_var->is_dynamic ()) {
+            UString range;
+            range.printf (" 0 %d", (int) parent_var->members ().size ());
+            m_engine->queue_command
+                (Command ("set-variable-update-range",
+                          "-var-set-update-range "
+                          + parent_var->internal_name () + range));
+        }
 
         // Call the slot associated to IDebugger::unfold_variable (), if
         // any.
@@ -3086,6 +4056,16 @@ struct OnListChangedVariableHandler : public OutputHandler
     {
     }
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("list-changed-variables");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.output ().has_result_record ()
@@ -3120,6 +4100,17 @@ struct OnListChangedVariableHandler : public OutputHandler
 
         IDebugger::VariableSafePtr variable = a_in.command ().variable ();
 
+        // A previous -var-update * command might have reported changes
+        // of the variable that were not applied yet.
+        list<VarChangePtr> unclaimed_changes;
+        m_engine->take_unclaimed_var_changes (variable->internal_name (),
+                                              unclaimed_changes);
+        for (list<VarChangePtr>::const_iterator i =
+                 unclaimed_changes.begin ();
+             i != unclaimed_changes.end ();
+             ++i)
+            (*i)->apply_to_variable (variable, vars);
+
         // Each element of var_changes is either a change of variable
         // itself, or a change of one its children.  So apply those
         // changes to variable so that it reflects its new state, and
@@ -3165,6 +4156,107 @@ struct OnListChangedVariableHandler : public OutputHandler
     }
 };//end OnListChangedVariableHandler
 
+struct OnUpdateAllVariablesHandler : public OutputHandler
+{
+    GDBEngine *m_engine;
+
+    OnUpdateAllVariablesHandler (GDBEngine *a_engine) :
+        m_engine (a_engine)
+    {
+    }
+
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("update-all-variables");
+    }
+
+    bool can_handle (CommandAndOutput &a_in)
+    {
+        if (a_in.output ().has_result_record ()
+            && a_in.output ().result_record ().kind ()
+                == Output::ResultRecord::DONE
+            && a_in.output ().result_record ().has_var_changes ()
+            && a_in.command ().name () == "update-all-variables") {
+            LOG_DD ("handler selected");
+            return true;
+        }
+        return false;
+    }
+
+    void do_handle (CommandAndOutput &a_in)
+    {
+        m_engine->dispatch_var_changes
+            (a_in.command ().tag2 (),
+             a_in.output ().result_record ().var_changes ());
+    }
+};//end OnUpdateAllVariablesHandler
+
+struct OnPooledFrameVariablesHandler : public OutputHandler
+{
+    GDBEngine *m_engine;
+
+    OnPooledFrameVariablesHandler (GDBEngine *a_engine) :
+        m_engine (a_engine)
+    {
+    }
+
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("get-pooled-frame-variables");
+    }
+
+    bool can_handle (CommandAndOutput &a_in)
+    {
+        if (a_in.output ().has_result_record ()
+            && a_in.output ().result_record ().kind ()
+                == Output::ResultRecord::DONE
+            && a_in.output ().result_record ().has_stack_depth ()
+            && a_in.command ().name () == "get-pooled-frame-variables") {
+            LOG_DD ("handler selected");
+            return true;
+        }
+        return false;
+    }
+
+    void do_handle (CommandAndOutput &a_in)
+    {
+        // The depth of the stack counts the frames from the
+        // innermost one; the depth of the frame is counted from the
+        // outermost one, so that it doesn't change as other frames
+        // are pushed and popped.
+        int frame_depth = a_in.output ().result_record ().stack_depth ()
+                          - a_in.command ().tag2 ();
+        int thread_id = atoi (a_in.command ().tag1 ().c_str ());
+        VarObjPool::FrameKey key (thread_id,
+                                  a_in.command ().tag0 ().raw (),
+                                  frame_depth);
+        IDebugger::VariableList local_variables, function_arguments;
+        if (m_engine->get_varobj_pool ().take (key,
+                                               local_variables,
+                                               function_arguments)) {
+            LOG_DD ("reusing the variables of " << key.function_name
+                    << " at depth " << frame_depth);
+        }
+
+        if (a_in.command ().has_slot ()) {
+            IDebugger::PooledFrameVariablesSlot slot =
+                a_in.command ().get_slot<IDebugger::PooledFrameVariablesSlot> ();
+            slot (thread_id, frame_depth,
+                  local_variables, function_arguments);
+        }
+    }
+};//end OnPooledFrameVariablesHandler
+
 struct OnVariableFormatHandler : public OutputHandler
 {
     GDBEngine *m_engine;
@@ -3174,6 +4266,16 @@ struct OnVariableFormatHandler : public OutputHandler
     {
     }
 
+    unsigned handled_output_kinds () const
+    {
+        return DONE_RESULT_OUTPUT;
+    }
+
+    void handled_command_names (list<UString> &a_names) const
+    {
+        a_names.push_back ("query-variable-format");
+    }
+
     bool can_handle (CommandAndOutput &a_in)
     {
         if (a_in.command ().name () == "query-variable-format"
@@ -3220,6 +4322,40 @@ GDBEngine::GDBEngine (DynamicModule *a_dynmod) : IDebugger (a_dynmod)
 GDBEngine::~GDBEngine ()
 {
     LOG_D ("delete", "destructor-domain");
+
+    if (!m_priv)
+        return;
+
+    // The pooled variables use the engine as they are destroyed.
+    m_priv->varobj_pool.clear ();
+
+    // Report how the output handlers were used during the life time
+    // of the engine.
+    list<OutputHandlerList::HandlerStats> stats;
+    m_priv->output_handler_list.get_stats (stats);
+    list<OutputHandlerList::HandlerStats>::const_iterator it;
+    for (it = stats.begin (); it != stats.end (); ++it) {
+        LOG_D (it->name
+               << ": queried: " << (int) it->nb_queries
+               << ", handled: " << (int) it->nb_hits
+               << ", time: " << it->time_spent << "s",
+               OUTPUT_HANDLER_STATS_DOMAIN);
+    }
+
+    // Report the latencies of the commands as JSON lines, in the
+    // command latency domain and in the file named by
+    // NMV_COMMAND_LATENCY_FILE, if it is set.
+    std::ostringstream latencies;
+    m_priv->latency_stats.write (latencies);
+    LOG_D ("\n" << latencies.str (), COMMAND_LATENCY_DOMAIN);
+    const char *latency_file = g_getenv ("NMV_COMMAND_LATENCY_FILE");
+    if (latency_file && *latency_file) {
+        std::ofstream out (latency_file, std::ios::out | std::ios::app);
+        if (out)
+            out << latencies.str ();
+        else
+            LOG_ERROR ("could not open " << latency_file);
+    }
 }
 
 /// Load an inferior program to debug.
@@ -3681,6 +4817,10 @@ GDBEngine::init_output_handlers ()
             (OutputHandlerSafePtr (new OnUnfoldVariableHandler (this)));
     m_priv->output_handler_list.add
             (OutputHandlerSafePtr (new OnListChangedVariableHandler (this)));
+    m_priv->output_handler_list.add
+            (OutputHandlerSafePtr (new OnUpdateAllVariablesHandler (this)));
+    m_priv->output_handler_list.add
+            (OutputHandlerSafePtr (new OnPooledFrameVariablesHandler (this)));
     m_priv->output_handler_list.add
             (OutputHandlerSafePtr (new OnVariableFormatHandler (this)));
 }
@@ -4294,6 +5434,8 @@ GDBEngine::on_detached_from_target_signal ()
     NEMIVER_TRY;
 
     m_priv->is_attached = false;
+    m_priv->varobj_pool.clear ();
+    m_priv->forget_var_roots ();
 
     NEMIVER_CATCH_NOX;
 }
@@ -4306,6 +5448,8 @@ GDBEngine::on_program_finished_signal ()
     NEMIVER_TRY;
 
     m_priv->is_attached = false;
+    m_priv->varobj_pool.clear ();
+    m_priv->forget_var_roots ();
 
     NEMIVER_CATCH_NOX;
 }
@@ -4381,6 +5525,9 @@ void
 GDBEngine::execute_command (const Command &a_command)
 {
     THROW_IF_FAIL (m_priv && m_priv->is_gdb_running ());
+    // We can't tell what the command does to the memory of the
+    // inferior.
+    m_priv->memory_cache.invalidate ();
     queue_command (a_command);
 }
 
@@ -4442,6 +5589,11 @@ void
 GDBEngine::run (const UString &a_cookie)
 {
     LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+    // The pooled variable objects belong to the previous run.
+    m_priv->varobj_pool.clear ();
+    m_priv->forget_var_roots ();
+
     Command command ("run",
                      "-exec-run",
                      a_cookie);
@@ -4595,7 +5747,7 @@ GDBEngine::step_in (const UString &a_cookie)
     Command command ("step-in",
                      "-exec-step",
                      a_cookie);
-    queue_command (command);
+    m_priv->queue_step_command (command);
 }
 
 void
@@ -4606,7 +5758,7 @@ GDBEngine::step_out (const UString &a_cookie)
     Command command ("step-out",
                      "-exec-finish",
                      a_cookie);
-    queue_command (command);
+    m_priv->queue_step_command (command);
 }
 
 void
@@ -4617,7 +5769,7 @@ GDBEngine::step_over (const UString &a_cookie)
     Command command ("step-over",
                      "-exec-next ",
                      a_cookie);
-    queue_command (command);
+    m_priv->queue_step_command (command);
 }
 
 void
@@ -4628,7 +5780,7 @@ GDBEngine::step_over_asm (const UString &a_cookie)
     Command command ("step-over-asm",
                      "-exec-next-instruction",
                      a_cookie);
-    queue_command (command);
+    m_priv->queue_step_command (command);
 }
 
 void
@@ -4639,7 +5791,15 @@ GDBEngine::step_in_asm (const UString &a_cookie)
     Command command ("step-in-asm",
                      "-exec-step-instruction",
                      a_cookie);
-    queue_command (command);
+    m_priv->queue_step_command (command);
+}
+
+/// \return true if step commands are queued, or sent to GDB and
+/// waiting for their results.
+bool
+GDBEngine::has_pending_steps () const
+{
+    return m_priv->has_pending_steps ();
 }
 
 void
@@ -5058,6 +6218,121 @@ GDBEngine::get_cached_breakpoints ()
     return m_priv->cached_breakpoints;
 }
 
+MemoryCache&
+GDBEngine::get_memory_cache ()
+{
+    return m_priv->memory_cache;
+}
+
+VarObjPool&
+GDBEngine::get_varobj_pool ()
+{
+    return m_priv->varobj_pool;
+}
+
+/// Record that a -data-write-memory-bytes command of a write issued
+/// by GDBEngine::set_memory is done.
+///
+/// \param a_write the tag2 of the command.
+///
+/// \param a_is_last true if it is the last command of the write.
+///
+/// \param a_failed true if the command failed.
+///
+/// \return true if the whole write is done and succeeded.
+bool
+GDBEngine::end_memory_write_command (int a_write,
+                                     bool a_is_last,
+                                     bool a_failed)
+{
+    return m_priv->end_memory_write_command (a_write, a_is_last, a_failed);
+}
+
+/// Apply the changes reported by a -var-update * command to the
+/// roots that were registered with
+/// GDBEngine::list_changed_variables_of_all, and notify them.
+///
+/// \param a_batch the identifier of the requests served by the
+/// command.
+///
+/// \param a_changes the changes reported by the command.
+void
+GDBEngine::dispatch_var_changes (int a_batch,
+                                 const list<VarChangePtr> &a_changes)
+{
+    m_priv->dispatch_var_changes (a_batch, a_changes);
+}
+
+/// Forget about the requests served by a -var-update * command
+/// that failed, invoking their slots with no changed variables.
+///
+/// \param a_batch the identifier of the requests.
+void
+GDBEngine::drop_var_update_batch (int a_batch)
+{
+    m_priv->drop_var_update_batch (a_batch);
+}
+
+/// Remove the step commands that are queued, but not sent to GDB
+/// yet.
+void
+GDBEngine::drop_queued_steps ()
+{
+    m_priv->drop_queued_steps ();
+}
+
+/// Register a root variable object that was created, so that the
+/// changes a -var-update * command reports for it are kept until it
+/// is updated.
+///
+/// \param a_internal_name the internal name of the root.
+void
+GDBEngine::register_var_root (const UString &a_internal_name)
+{
+    if (!a_internal_name.empty ())
+        m_priv->live_var_roots.insert (a_internal_name);
+}
+
+/// Get the changes of a root variable object that a -var-update *
+/// command reported, but that were not applied to it yet.
+///
+/// \param a_root_name the internal name of the root.
+///
+/// \param a_changes output parameter.  The changes are appended to
+/// it.
+void
+GDBEngine::take_unclaimed_var_changes (const UString &a_root_name,
+                                       list<VarChangePtr> &a_changes)
+{
+    m_priv->take_unclaimed_var_changes (a_root_name, a_changes);
+}
+
+void
+GDBEngine::get_memory_cache_stats (unsigned long &a_nb_hits,
+                                   unsigned long &a_nb_misses) const
+{
+    a_nb_hits = m_priv->memory_cache.nb_hits ();
+    a_nb_misses = m_priv->memory_cache.nb_misses ();
+}
+
+/// Get the latencies of the commands sent to GDB so far.  Each
+/// phase of the life of a command is timed, from its queuing to the
+/// end of the handling of its result record.
+///
+/// \param a_stats output parameter.  Set to the latencies, by
+/// command name.
+void
+GDBEngine::get_command_latency_stats (CommandLatencyMap &a_stats) const
+{
+    a_stats = m_priv->latency_stats.stats ();
+}
+
+void
+GDBEngine::clear_command_latency_stats ()
+{
+    m_priv->latency_stats.clear ();
+}
+
 bool
 GDBEngine::get_breakpoint_from_cache (const string &a_num,
                                       IDebugger::Breakpoint &a_bp) const
@@ -5438,6 +6713,9 @@ GDBEngine::evaluate_expression (const UString &a_expr,
     LOG_FUNCTION_SCOPE_NORMAL_DD;
     if (a_expr == "") {return;}
 
+    // The expression can have side effects on the memory.
+    m_priv->memory_cache.invalidate ();
+
     Command command ("evaluate-expression",
                      "-data-evaluate-expression " + a_expr,
                      a_cookie);
@@ -5451,6 +6729,9 @@ GDBEngine::call_function (const UString &a_expr,
     LOG_FUNCTION_SCOPE_NORMAL_DD;
     if (a_expr.empty ()) {return;}
 
+    // The function can write anywhere in the memory.
+    m_priv->memory_cache.invalidate ();
+
     Command command ("call-function",
                      "-data-evaluate-expression " + a_expr,
                      a_cookie);
@@ -6006,22 +7287,7 @@ GDBEngine::read_memory (size_t a_start_addr,
                         const UString& a_cookie)
 {
     LOG_FUNCTION_SCOPE_NORMAL_DD;
-    UString cmd;
-    // format: -data-read-memory ADDR WORD_FORMAT WORD_SIZE NR_ROW NR_COLS
-    // We assume the following for now:
-    //  - output values in hex format (x)
-    //  - word size of 1 byte
-    //  - a single row of output
-    // When we parse the output from the command,
-    // we assume that there's only a
-    // single row of output -- if this ever changes,
-    // the parsing function will need to be updated
-    cmd.printf ("-data-read-memory %zu x 1 1 %zu",
-                a_start_addr,
-                a_num_bytes);
-    queue_command (Command ("read-memory",
-                            cmd,
-                            a_cookie));
+    m_priv->read_memory (a_start_addr, a_num_bytes, a_cookie);
 }
 
 void
@@ -6030,17 +7296,43 @@ GDBEngine::set_memory (size_t a_addr,
                        const UString& a_cookie)
 {
     LOG_FUNCTION_SCOPE_NORMAL_DD;
-    for (std::vector<uint8_t>::const_iterator iter = a_bytes.begin ();
-            iter != a_bytes.end (); ++iter)
-    {
+
+    if (a_bytes.empty ())
+        return;
+
+    m_priv->memory_cache.invalidate (a_addr, a_bytes.size ());
+
+    // Commands reach GDB through a pty, whose lines are limited to
+    // 4KiB, so big writes are split in several commands.
+    static const size_t MAX_BYTES_PER_COMMAND = 1024;
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+
+    UString start_addr;
+    start_addr.printf ("0x%zx", a_addr);
+    int write = ++m_priv->last_memory_write;
+    std::string hex;
+    hex.reserve (2 * a_bytes.size ());
+    for (size_t offset = 0; offset < a_bytes.size ();) {
+        size_t end = std::min (offset + MAX_BYTES_PER_COMMAND,
+                               a_bytes.size ());
+        std::string::size_type chunk_start = hex.size ();
+        for (; offset < end; ++offset) {
+            hex += HEX_DIGITS[a_bytes[offset] >> 4];
+            hex += HEX_DIGITS[a_bytes[offset] & 0xf];
+        }
+
         UString cmd_str;
-        cmd_str.printf ("-data-evaluate-expression "
-                        "\"*(unsigned char*)%zu = 0x%X\"",
-                a_addr++,
-                *iter);
+        cmd_str.printf ("-data-write-memory-bytes %zu ",
+                        a_addr + chunk_start / 2);
+        cmd_str += hex.substr (chunk_start);
         Command command ("set-memory", cmd_str, a_cookie);
         command.tag0 ("set-memory");
-        command.tag1 (UString ().printf ("0x%X",a_addr));
+        command.tag1 (start_addr);
+        command.tag2 (write);
+        if (end == a_bytes.size ()) {
+            // This is the last command of the write.
+            command.tag3 (hex);
+        }
         queue_command (command);
     }
 }
@@ -6282,6 +7574,8 @@ GDBEngine::delete_variable (const VariableSafePtr a_var,
     THROW_IF_FAIL (a_var);
     THROW_IF_FAIL (!a_var->internal_name ().empty ());
 
+    m_priv->forget_var_root (a_var->internal_name ());
+
     Command command ("delete-variable",
                      "-var-delete " + a_var->internal_name (),
                      a_cookie);
@@ -6312,6 +7606,8 @@ GDBEngine::delete_variable (const UString &a_internal_name,
 
     THROW_IF_FAIL (!a_internal_name.empty ());
 
+    m_priv->forget_var_root (a_internal_name);
+
     Command command ("delete-variable",
                      "-var-delete " + a_internal_name,
                      a_cookie);
@@ -6424,6 +7720,64 @@ GDBEngine::unfold_variable (VariableSafePtr a_var,
     queue_command (command);
 }
 
+/// Query the backend for a window of the member variables of a
+/// given variable, and append them to its members.
+///
+/// This lets big containers be unfolded piecemeal, as GDB then
+/// only builds the variable objects of the children of the window.
+///
+/// \param a_var the variable to act upon.
+///
+/// \param a_from the index of the first child to unfold.
+///
+/// \param a_to the index following the last child to unfold.
+///
+/// \param a_slot a slot function to be invoked upon completion of the
+/// backend side of this command, even if it failed.
+///
+/// \param a_cookie a string that is going to be passed to signal
+/// IDebugger::variable_unfolded_signal.
+void
+GDBEngine::unfold_variable (VariableSafePtr a_var,
+                            int a_from,
+                            int a_to,
+                            const ConstVariableSlot &a_slot,
+                            const UString &a_cookie)
+{
+    LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+    THROW_IF_FAIL (a_var);
+    THROW_IF_FAIL (a_from >= 0 && a_from <= a_to);
+
+    // The visualizer is set on the members one by one, once they are
+    // all unfolded.
+    if (a_var->needs_revisualizing ()) {
+        unfold_variable (a_var, a_slot, a_cookie);
+        return;
+    }
+    if (a_var->internal_name ().empty ()) {
+        UString qname;
+        a_var->build_qualified_internal_name (qname);
+        a_var->internal_name (qname);
+    }
+    THROW_IF_FAIL (!a_var->internal_name ().empty ());
+
+    Command command ("unfold-variable",
+                     "-var-list-children "
+                     " --all-values "
+                     + a_var->internal_name ()
+                     + " " + UString::from_int (a_from)
+                     + " " + UString::from_int (a_to),
+                     a_cookie);
+    command.variable (a_var);
+    command.set_slot (a_slot);
+    // Tell OnErrorHandler to invoke the slot if the command fails,
+    // and OnUnfoldVariableHandler to limit the updates of a dynamic
+    // variable object to the unfolded children.
+    command.tag2 (1);
+    queue_command (command);
+}
+
 void
 GDBEngine::assign_variable (const VariableSafePtr a_var,
                             const UString &a_expression,
@@ -6447,6 +7801,9 @@ GDBEngine::assign_variable
     THROW_IF_FAIL (!a_var->internal_name ().empty ());
     THROW_IF_FAIL (!a_expression.empty ());
 
+    // The assignment writes to the memory.
+    m_priv->memory_cache.invalidate ();
+
     Command command ("assign-variable",
                      "-var-assign "
                      + a_var->internal_name ()
@@ -6520,6 +7877,109 @@ GDBEngine::list_changed_variables
     queue_command (command);
 }
 
+/// Put the local variables and the arguments of a frame in the pool
+/// of variable objects, so that they can be reused if the frame is
+/// displayed again.
+///
+/// \param a_thread_id the thread of the frame.
+///
+/// \param a_frame the frame.
+///
+/// \param a_frame_depth the depth of the frame, as passed to the
+/// slot of GDBEngine::get_pooled_frame_variables.
+///
+/// \param a_local_variables the local variables of the frame.
+///
+/// \param a_function_arguments the arguments of the frame.
+void
+GDBEngine::pool_frame_variables (int a_thread_id,
+                                 const Frame &a_frame,
+                                 int a_frame_depth,
+                                 const VariableList &a_local_variables,
+                                 const VariableList &a_function_arguments)
+{
+    LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+    VarObjPool::FrameKey key (a_thread_id,
+                              a_frame.function_name (),
+                              a_frame_depth);
+    VariableList evicted;
+    m_priv->varobj_pool.put (key, a_local_variables, a_function_arguments,
+                             evicted);
+    LOG_DD ("the pool has " << (int) m_priv->varobj_pool.nb_variables ()
+            << " variables of " << (int) m_priv->varobj_pool.nb_frames ()
+            << " frames, " << (int) evicted.size () << " were evicted");
+
+    // Delete the variable objects of the variables dropped from the
+    // pool now, rather than whenever the last reference to them goes
+    // away.  The variables are detached from the engine, so that they
+    // don't delete them again when they are destroyed.
+    VariableList::const_iterator it;
+    for (it = evicted.begin (); it != evicted.end (); ++it) {
+        if (!(*it)->internal_name ().empty () && is_attached_to_target ())
+            delete_variable ((*it)->internal_name (), DefaultSlot ());
+        (*it)->debugger (0);
+    }
+}
+
+/// Take the variables of a frame of the current thread out of the
+/// pool of variable objects.  This queries the depth of the stack,
+/// which identifies the frame along with its thread and function.
+///
+/// \param a_frame the frame.
+///
+/// \param a_slot the slot to invoke with the current thread, the
+/// depth of the frame and the variables of the frame that were in
+/// the pool, if any.
+///
+/// \param a_cookie a string passed to the slot.
+void
+GDBEngine::get_pooled_frame_variables
+                        (const Frame &a_frame,
+                         const PooledFrameVariablesSlot &a_slot,
+                         const UString &a_cookie)
+{
+    LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+    UString thread;
+    get_mi_thread_location (thread);
+
+    Command command ("get-pooled-frame-variables",
+                     "-stack-info-depth " + thread,
+                     a_cookie);
+    command.tag0 (a_frame.function_name ());
+    command.tag1 (UString::from_int (get_current_thread ()));
+    command.tag2 (a_frame.level ());
+    command.set_slot (a_slot);
+    queue_command (command);
+}
+
+/// Like GDBEngine::list_changed_variables, but all the roots
+/// registered with this function during the same iteration of the
+/// event loop are updated by a single -var-update --all-values *
+/// command, instead of one command per root.
+///
+/// \param a_root the variable to consider.
+///
+/// \param a_slot the slot to invoke with the sub-variables of a_root
+/// (including a_root) that changed.
+///
+/// \param a_cookie the cookie passed to
+/// IDebugger::changed_variables_signal.
+void
+GDBEngine::list_changed_variables_of_all
+                (VariableSafePtr a_root,
+                 const ConstVariableListSlot &a_slot,
+                 const UString &a_cookie)
+{
+    LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+    THROW_IF_FAIL (a_root);
+    THROW_IF_FAIL (!a_root->internal_name ().empty ());
+
+    m_priv->list_changed_variables_of_all (a_root, a_slot, a_cookie);
+}
+
 void
 GDBEngine::query_variable_path_expr (const VariableSafePtr a_var,
                                      const UString &a_cookie)
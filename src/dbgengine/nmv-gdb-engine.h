@@ -373,6 +373,8 @@ public:
 
     void step_in_asm (const UString &a_cookie);
 
+    bool has_pending_steps () const;
+
     void continue_to_position (const UString &a_path,
                                gint a_line_num,
                                const UString &a_cookie) ;
@@ -446,6 +448,26 @@ public:
 
     map<string, IDebugger::Breakpoint>& get_cached_breakpoints ();
 
+    MemoryCache& get_memory_cache ();
+
+    VarObjPool& get_varobj_pool ();
+
+    bool end_memory_write_command (int a_write,
+                                   bool a_is_last,
+                                   bool a_failed);
+
+    void dispatch_var_changes (int a_batch,
+                               const list<VarChangePtr> &a_changes);
+
+    void drop_var_update_batch (int a_batch);
+
+    void drop_queued_steps ();
+
+    void register_var_root (const UString &a_internal_name);
+
+    void take_unclaimed_var_changes (const UString &a_root_name,
+                                     list<VarChangePtr> &a_changes);
+
     bool get_breakpoint_from_cache (const string &a_num,
 				    IDebugger::Breakpoint &a_bp) const;
 
@@ -563,6 +585,13 @@ public:
                      const std::vector<uint8_t>& a_bytes,
                      const UString& a_cookie);
 
+    void get_memory_cache_stats (unsigned long &a_nb_hits,
+                                 unsigned long &a_nb_misses) const;
+
+    void get_command_latency_stats (CommandLatencyMap &a_stats) const;
+
+    void clear_command_latency_stats ();
+
     void disassemble (size_t a_start_addr,
                       bool a_start_addr_relative_to_pc,
                       size_t a_end_addr,
@@ -626,6 +655,12 @@ public:
                           const UString &a_cookie,
 			  bool a_should_emit_signal);
 
+    void unfold_variable (VariableSafePtr a_var,
+                          int a_from,
+                          int a_to,
+                          const ConstVariableSlot &a_s,
+                          const UString &a_cookie);
+
     void assign_variable (const VariableSafePtr a_var,
                           const UString &a_expression,
                           const UString &a_cookie);
@@ -651,6 +686,21 @@ public:
                  const ConstVariableListSlot &a_slot,
                  const UString &a_cookie);
 
+    void list_changed_variables_of_all
+                (VariableSafePtr a_root,
+                 const ConstVariableListSlot &a_slot,
+                 const UString &a_cookie);
+
+    void pool_frame_variables (int a_thread_id,
+                               const Frame &a_frame,
+                               int a_frame_depth,
+                               const VariableList &a_local_variables,
+                               const VariableList &a_function_arguments);
+
+    void get_pooled_frame_variables (const Frame &a_frame,
+                                     const PooledFrameVariablesSlot &a_slot,
+                                     const UString &a_cookie);
+
     void query_variable_path_expr (const VariableSafePtr a_root,
                                    const UString &a_cookie);
 
@@ -24,7 +24,11 @@
  *See COPYRIGHT file copyright information.
  */
 #include "config.h"
+#include <climits>
+#include <cstdlib>
 #include <cstring>
+#include <algorithm>
+#include <new>
 #include <iostream>
 #include <sstream>
 #include "common/nmv-str-utils.h"
@@ -39,17 +43,15 @@ static const UString GDBMI_OUTPUT_DOMAIN = "gdbmi-output-domain";
 
 #define LOG_PARSING_ERROR(a_from) \
 do { \
-Glib::ustring str_01 (m_priv->input, (a_from), m_priv->end - (a_from));\
 LOG_ERROR ("parsing failed for buf: >>>" \
-             << m_priv->input << "<<<" \
+             << m_priv->input () << "<<<" \
              << " cur index was: " << (int)(a_from)); \
 } while (0)
 
 #define LOG_PARSING_ERROR_MSG(a_from, msg) \
 do { \
-Glib::ustring str_01 (m_priv->input, (a_from), m_priv->end - (a_from));\
 LOG_ERROR ("parsing failed for buf: >>>" \
-             << m_priv->input << "<<<" \
+             << m_priv->input () << "<<<" \
              << " cur index was: " << (int)(a_from) \
              << ", reason: " << msg); \
 } while (0)
@@ -78,9 +80,7 @@ while (!m_priv->index_passed_end (a_from)  \
 
 #define RAW_CHAR_AT(cur) m_priv->raw_char_at (cur)
 
-#define UCHAR_AT(cur) m_priv->m_priv->input (cur)
-
-#define RAW_INPUT m_priv->input.raw ()
+#define RAW_INPUT m_priv->input_slice ()
 
 using namespace std;
 using namespace nemiver::common;
@@ -125,6 +125,170 @@ GDBMITuple::clear ()
 // </Definitions of GDBMITuple>
 // *******************************
 
+// *************************************
+// <Definitions of GDBMIStringSlice>
+// *************************************
+
+int
+GDBMIStringSlice::compare (UString::size_type a_pos,
+                           UString::size_type a_len,
+                           const char *a_str) const
+{
+    if (a_pos > m_size)
+        return 1;
+
+    UString::size_type len = std::min (a_len, m_size - a_pos);
+    UString::size_type str_len = strlen (a_str);
+    int result = memcmp (m_data + a_pos, a_str, std::min (len, str_len));
+    if (result)
+        return result;
+    if (len < str_len)
+        return -1;
+    if (len > str_len)
+        return 1;
+    return 0;
+}
+
+UString::size_type
+GDBMIStringSlice::find (const char *a_str,
+                        UString::size_type a_pos) const
+{
+    if (a_pos > m_size)
+        return UString::npos;
+
+    const char *end = m_data + m_size;
+    const char *it = std::search (m_data + a_pos, end,
+                                  a_str, a_str + strlen (a_str));
+    if (it == end && *a_str)
+        return UString::npos;
+    return it - m_data;
+}
+
+GDBMIStringSlice
+GDBMIStringSlice::substr (UString::size_type a_pos,
+                          UString::size_type a_len) const
+{
+    if (a_pos > m_size)
+        return GDBMIStringSlice ();
+    return GDBMIStringSlice (m_data + a_pos,
+                             std::min (a_len, m_size - a_pos));
+}
+
+UString
+GDBMIStringSlice::to_ustring () const
+{
+    if (!m_size)
+        return UString ();
+    return Glib::ustring (m_data, m_data + m_size);
+}
+
+bool
+GDBMIStringSlice::operator== (const char *a_str) const
+{
+    return !compare (0, m_size, a_str);
+}
+
+// *************************************
+// </Definitions of GDBMIStringSlice>
+// *************************************
+
+// *************************************
+// <Definitions of GDBMIRecordReader>
+// *************************************
+
+static const char GDBMI_PROMPT[] = "\n(gdb)";
+static const std::string::size_type GDBMI_PROMPT_LEN =
+                                            sizeof (GDBMI_PROMPT) - 1;
+
+GDBMIRecordReader::GDBMIRecordReader () :
+    m_begin (0),
+    m_scan (0)
+{
+}
+
+void
+GDBMIRecordReader::append (const char *a_data,
+                           std::string::size_type a_len)
+{
+    if (m_begin == m_buffer.size ()) {
+        // Everything has been consumed; start over without moving
+        // anything.
+        m_buffer.clear ();
+        m_begin = m_scan = 0;
+    } else if (m_begin && m_begin >= m_buffer.size () - m_begin) {
+        // Drop the consumed prefix.  As this only happens when the
+        // prefix is at least as big as the bytes that are moved, the
+        // cost of the moves is linear in the size of the stream.
+        m_buffer.erase (0, m_begin);
+        m_scan -= m_begin;
+        m_begin = 0;
+    }
+    m_buffer.append (a_data, a_len);
+}
+
+bool
+GDBMIRecordReader::next_record (GDBMIStringSlice &a_record)
+{
+    const char *data = m_buffer.data ();
+    std::string::size_type size = m_buffer.size ();
+
+    while (m_scan < size) {
+        const char *nl =
+            static_cast<const char*> (memchr (data + m_scan, '\n',
+                                              size - m_scan));
+        if (!nl) {
+            m_scan = size;
+            return false;
+        }
+        std::string::size_type i = nl - data;
+        if (size - i < GDBMI_PROMPT_LEN) {
+            // We can't tell yet if this is the start of a prompt;
+            // resume from this very new line next time.
+            m_scan = i;
+            return false;
+        }
+        if (memcmp (nl, GDBMI_PROMPT, GDBMI_PROMPT_LEN)) {
+            m_scan = i + 1;
+            continue;
+        }
+
+        // The record ends right after the "(gdb)" prompt and the
+        // white space that usually follows it.
+        std::string::size_type end =
+            std::min (i + GDBMI_PROMPT_LEN + 1, size);
+        std::string::size_type from = m_begin, to = end;
+        while (from < to && isspace (data[from]))
+            ++from;
+        while (to > from && isspace (data[to - 1]))
+            --to;
+        a_record = GDBMIStringSlice (data + from, to - from);
+        m_begin = m_scan = end;
+        return true;
+    }
+    return false;
+}
+
+GDBMIStringSlice
+GDBMIRecordReader::pending () const
+{
+    std::string::size_type from = m_begin;
+    while (from < m_buffer.size () && isspace (m_buffer[from]))
+        ++from;
+    return GDBMIStringSlice (m_buffer.data () + from,
+                             m_buffer.size () - from);
+}
+
+void
+GDBMIRecordReader::clear ()
+{
+    m_buffer.clear ();
+    m_begin = m_scan = 0;
+}
+
+// *************************************
+// </Definitions of GDBMIRecordReader>
+// *************************************
+
 // prefixes of command output records.
 static const char* PREFIX_DONE = "^done";
 static const char* PREFIX_RUNNING = "^running";
@@ -147,6 +311,7 @@ static const char* PREFIX_REGISTER_NAMES = "register-names=";
 static const char* PREFIX_CHANGED_REGISTERS = "changed-registers=";
 static const char* PREFIX_REGISTER_VALUES = "register-values=";
 static const char* PREFIX_MEMORY_VALUES = "addr=";
+static const char* PREFIX_MEMORY_BYTES = "memory=[";
 static const char* PREFIX_RUNNING_ASYNC_OUTPUT = "*running,";
 static const char* PREFIX_STOPPED_ASYNC_OUTPUT = "*stopped,";
 static const char* PREFIX_THREAD_SELECTED_ASYNC_OUTPUT = "=thread-selected,";
@@ -159,6 +324,9 @@ static const char* PREFIX_VARIABLES_CHANGED_LIST = "changelist=[";
 static const char* CHANGELIST = "changelist";
 static const char* PREFIX_PATH_EXPR = "path_expr=";
 static const char* PATH_EXPR = "path_expr";
+static const char* PREFIX_STACK_DEPTH = "depth=\"";
+static const char* STACK_DEPTH = "depth";
+static const char* PREFIX_HAS_MORE = "has_more=\"";
 static const char* PREFIX_ASM_INSTRUCTIONS= "asm_insns=";
 const char* PREFIX_VARIABLE_FORMAT = "format=";
 
@@ -516,32 +684,267 @@ struct QuickUStringLess : public std::binary_function<const UString,
     }
 };//end struct QuickUstringLess
 
+//******************************
+//<GDB/MI nodes arena>
+//******************************
+
+static void
+release_gdbmi_children (GDBMITuple &a_tuple)
+{
+    a_tuple.clear ();
+}
+
+static void
+release_gdbmi_children (GDBMIList &a_list)
+{
+    a_list.clear ();
+}
+
+static void
+release_gdbmi_children (GDBMIValue &a_value)
+{
+    a_value.content (false);
+}
+
+static void
+release_gdbmi_children (GDBMIResult &a_result)
+{
+    a_result.value (GDBMIValueSafePtr ());
+}
+
+/// A memory region the GDB/MI nodes built while parsing an output
+/// record are allocated from.
+///
+/// The nodes are carved out of big blocks of memory and their
+/// reference counting is disabled.  They are all destroyed at once
+/// by GDBMIArena::clear when the output record has been parsed, and
+/// the blocks are kept around to be reused by the next output
+/// record.  So in the steady state, building a GDB/MI tree costs no
+/// allocation for the nodes themselves.
+///
+/// The nodes keep their usual layout, linked through SafePtr, rather
+/// than being laid out flat in vectors indexed by the parser: the
+/// code walking the trees relies on that layout.
+class GDBMIArena {
+    GDBMIArena (const GDBMIArena&);
+    GDBMIArena& operator= (const GDBMIArena&);
+
+    struct Node {
+        void *object;
+        void (*release) (void*);
+        void (*destroy) (void*);
+    };
+
+    enum {
+        BLOCK_SIZE = 16 * 1024,
+        // The number of blocks kept around after a clear, so that a
+        // huge output record doesn't pin its memory forever.
+        MAX_KEPT_BLOCKS = 16,
+        ALIGNMENT = 2 * sizeof (void*)
+    };
+
+    vector<char*> m_blocks;
+    size_t m_cur_block;
+    size_t m_cur_offset;
+    vector<Node> m_nodes;
+
+    template <class T>
+    static void release_node (void *a_node)
+    {
+        release_gdbmi_children (*static_cast<T*> (a_node));
+    }
+
+    template <class T>
+    static void destroy_node (void *a_node)
+    {
+        static_cast<T*> (a_node)->~T ();
+    }
+
+public:
+
+    GDBMIArena () :
+        m_cur_block (0),
+        m_cur_offset (0)
+    {
+    }
+
+    ~GDBMIArena ()
+    {
+        clear ();
+        for (size_t i = 0; i < m_blocks.size (); ++i) {
+            delete [] m_blocks[i];
+        }
+    }
+
+    void* allocate (size_t a_size)
+    {
+        a_size = (a_size + ALIGNMENT - 1) & ~((size_t) ALIGNMENT - 1);
+        THROW_IF_FAIL (a_size <= BLOCK_SIZE);
+
+        if (m_cur_block < m_blocks.size ()
+            && m_cur_offset + a_size > BLOCK_SIZE) {
+            ++m_cur_block;
+            m_cur_offset = 0;
+        }
+        if (m_cur_block == m_blocks.size ()) {
+            m_blocks.push_back (new char[BLOCK_SIZE]);
+            m_cur_offset = 0;
+        }
+        void *result = m_blocks[m_cur_block] + m_cur_offset;
+        m_cur_offset += a_size;
+        return result;
+    }
+
+    /// Register a node that was constructed in memory returned by
+    /// allocate, so that it is destroyed by the next clear.
+    template <class T>
+    void adopt (T *a_node)
+    {
+        a_node->enable_refcount (false);
+        Node node = {a_node, &release_node<T>, &destroy_node<T>};
+        m_nodes.push_back (node);
+    }
+
+    /// Destroy all the nodes allocated so far and make their memory
+    /// available for new nodes.
+    void clear ()
+    {
+        // Nodes can point to nodes that were created before or after
+        // them, so drop all the links between nodes first, while
+        // they are all alive.
+        vector<Node>::const_iterator it;
+        for (it = m_nodes.begin (); it != m_nodes.end (); ++it) {
+            it->release (it->object);
+        }
+        for (it = m_nodes.begin (); it != m_nodes.end (); ++it) {
+            it->destroy (it->object);
+        }
+        m_nodes.clear ();
+
+        while (m_blocks.size () > MAX_KEPT_BLOCKS) {
+            delete [] m_blocks.back ();
+            m_blocks.pop_back ();
+        }
+        m_cur_block = 0;
+        m_cur_offset = 0;
+    }
+};//end class GDBMIArena
+
+//******************************
+//</GDB/MI nodes arena>
+//******************************
+
 //******************************
 //<Parser methods>
 //******************************
 struct GDBMIParser::Priv {
-    UString input;
+    /// An entry of the input stack.  If the input was pushed by
+    /// copy, it is held in owned_input and buf points into it.
+    /// Otherwise, buf points into memory borrowed from the caller of
+    /// GDBMIParser::push_input and owned_input is only filled lazily,
+    /// if somebody asks for the input as an UString.
+    struct Input {
+        UString owned_input;
+        const char *buf;
+        UString::size_type len;
+        bool is_borrowed;
+
+        Input () :
+            buf (0),
+            len (0),
+            is_borrowed (false)
+        {}
+    };
+
+    /// While this is alive, the GDB/MI nodes created by the parser
+    /// are allocated from GDBMIParser::Priv::arena.  They are all
+    /// destroyed when the outermost scope goes away.  Nothing
+    /// pointing to these nodes must thus outlive the scope.
+    struct ArenaScope {
+        Priv &priv;
+
+        ArenaScope (Priv &a_priv) :
+            priv (a_priv)
+        {
+            ++priv.arena_depth;
+        }
+
+        ~ArenaScope ()
+        {
+            if (!--priv.arena_depth)
+                priv.arena.clear ();
+        }
+    };
+
+    const char *buf;
     UString::size_type end;
     Mode mode;
-    list<UString> input_stack;
+    list<Input> input_stack;
+    GDBMIArena arena;
+    int arena_depth;
 
     Priv (Mode a_mode = GDBMIParser::STRICT_MODE):
+        buf (0),
         end (0),
-        mode (a_mode)
+        mode (a_mode),
+        arena_depth (0)
     {
     }
 
     Priv (const UString &a_input, Mode a_mode) :
+        buf (0),
         end (0),
-        mode (a_mode)
+        mode (a_mode),
+        arena_depth (0)
 
     {
         push_input (a_input);
     }
 
+    /// Create a new GDB/MI node.  Inside an ArenaScope, the node is
+    /// allocated from the arena, otherwise it is a normal reference
+    /// counted heap object.
+    template <class T>
+    SafePtr<T, ObjectRef, ObjectUnref> new_node ()
+    {
+        if (!arena_depth)
+            return SafePtr<T, ObjectRef, ObjectUnref> (new T);
+        T *node = new (arena.allocate (sizeof (T))) T;
+        arena.adopt (node);
+        return SafePtr<T, ObjectRef, ObjectUnref> (node);
+    }
+
+    template <class T, class A>
+    SafePtr<T, ObjectRef, ObjectUnref> new_node (const A &a_arg)
+    {
+        if (!arena_depth)
+            return SafePtr<T, ObjectRef, ObjectUnref> (new T (a_arg));
+        T *node = new (arena.allocate (sizeof (T))) T (a_arg);
+        arena.adopt (node);
+        return SafePtr<T, ObjectRef, ObjectUnref> (node);
+    }
+
+    template <class T, class A, class B, class C>
+    SafePtr<T, ObjectRef, ObjectUnref> new_node (const A &a_arg0,
+                                                 const B &a_arg1,
+                                                 const C &a_arg2)
+    {
+        if (!arena_depth)
+            return SafePtr<T, ObjectRef, ObjectUnref>
+                (new T (a_arg0, a_arg1, a_arg2));
+        T *node = new (arena.allocate (sizeof (T)))
+            T (a_arg0, a_arg1, a_arg2);
+        arena.adopt (node);
+        return SafePtr<T, ObjectRef, ObjectUnref> (node);
+    }
+
     UString::value_type raw_char_at (UString::size_type at) const
     {
-        return input.raw ()[at];
+        // A borrowed input is not necessarily zero terminated, so
+        // reading at the end must not peek past it.
+        if (at >= end)
+            return 0;
+        return buf[at];
     }
 
     bool index_passed_end (UString::size_type a_index)
@@ -557,22 +960,53 @@ struct GDBMIParser::Priv {
         return true;
     }
 
-    void set_input (const UString &a_input)
+    GDBMIStringSlice input_slice () const
+    {
+        return GDBMIStringSlice (buf, end);
+    }
+
+    const UString& input ()
     {
-        input = a_input;
-        end = a_input.bytes ();
+        static const UString s_empty;
+        if (input_stack.empty ())
+            return s_empty;
+        Input &top = input_stack.front ();
+        if (top.is_borrowed && top.owned_input.bytes () != top.len) {
+            top.owned_input = input_slice ().to_ustring ();
+        }
+        return top.owned_input;
+    }
+
+    void set_input (const Input &a_input)
+    {
+        buf = a_input.buf;
+        end = a_input.len;
     }
 
     void clear_input ()
     {
-        input.clear ();
+        buf = 0;
         end = 0;
     }
 
     void push_input (const UString &a_input)
     {
-        input_stack.push_front (a_input);
-        set_input (a_input);
+        input_stack.push_front (Input ());
+        Input &top = input_stack.front ();
+        top.owned_input = a_input;
+        top.buf = top.owned_input.raw ().data ();
+        top.len = top.owned_input.bytes ();
+        set_input (top);
+    }
+
+    void push_input (const char *a_input, UString::size_type a_len)
+    {
+        input_stack.push_front (Input ());
+        Input &top = input_stack.front ();
+        top.buf = a_input;
+        top.len = a_len;
+        top.is_borrowed = true;
+        set_input (top);
     }
 
     void pop_input ()
@@ -606,6 +1040,12 @@ GDBMIParser::push_input (const UString &a_input)
     m_priv->push_input (a_input);
 }
 
+void
+GDBMIParser::push_input (const char *a_input, UString::size_type a_len)
+{
+    m_priv->push_input (a_input, a_len);
+}
+
 void
 GDBMIParser::pop_input ()
 {
@@ -615,7 +1055,13 @@ GDBMIParser::pop_input ()
 const UString&
 GDBMIParser::get_input () const
 {
-    return m_priv->input;
+    return m_priv->input ();
+}
+
+GDBMIStringSlice
+GDBMIParser::get_input_slice () const
+{
+    return m_priv->input_slice ();
 }
 
 void
@@ -634,6 +1080,18 @@ bool
 GDBMIParser::parse_string (UString::size_type a_from,
                            UString::size_type &a_to,
                            UString &a_string)
+{
+    GDBMIStringSlice str;
+    if (!parse_string (a_from, a_to, str))
+        return false;
+    a_string = str.to_ustring ();
+    return true;
+}
+
+bool
+GDBMIParser::parse_string (UString::size_type a_from,
+                           UString::size_type &a_to,
+                           GDBMIStringSlice &a_string)
 {
     LOG_FUNCTION_SCOPE_NORMAL_D (GDBMI_PARSING_DOMAIN);
     UString::size_type cur=a_from;
@@ -664,9 +1122,7 @@ GDBMIParser::parse_string (UString::size_type a_from,
         str_end = cur - 1;
         break;
     }
-    Glib::ustring str (RAW_INPUT.c_str () + str_start,
-                       str_end - str_start + 1);
-    a_string = str;
+    a_string = RAW_INPUT.substr (str_start, str_end - str_start + 1);
     a_to = cur;
     return true;
 }
@@ -830,11 +1286,19 @@ GDBMIParser::parse_c_string (UString::size_type a_from,
         LOG_PARSING_ERROR (cur);
         return false;
     }
+
+    // Most of the strings sent by GDB don't contain any escape
+    // sequence.  Those can be copied out of the input in one go.
+    GDBMIStringSlice verbatim;
+    if (parse_verbatim_c_string (cur, a_to, verbatim)) {
+        a_c_string = verbatim.to_ustring ();
+        return true;
+    }
+
     ++cur;
     CHECK_END (cur);
 
-    UString str;
-    if (!parse_c_string_body (cur, cur, str)) {
+    if (!parse_c_string_body (cur, cur, a_c_string)) {
         LOG_PARSING_ERROR (cur);
         return false;
     }
@@ -845,11 +1309,38 @@ GDBMIParser::parse_c_string (UString::size_type a_from,
     }
 
     ++cur;
-    a_c_string = str;
     a_to = cur;
     return true;
 }
 
+bool
+GDBMIParser::parse_verbatim_c_string (UString::size_type a_from,
+                                      UString::size_type &a_to,
+                                      GDBMIStringSlice &a_c_string)
+{
+    UString::size_type cur=a_from;
+    if (m_priv->index_passed_end (cur) || RAW_CHAR_AT (cur) != '"')
+        return false;
+    ++cur;
+
+    UString::size_type body_start = cur;
+    for (; !m_priv->index_passed_end (cur); ++cur) {
+        char ch = m_priv->buf[cur];
+        if (ch == '"')
+            break;
+        if (ch == '\\')
+            // There is an escape sequence; the caller has to unescape
+            // the string into a copy.
+            return false;
+    }
+    if (m_priv->index_passed_end (cur))
+        return false;
+
+    a_c_string = RAW_INPUT.substr (body_start, cur - body_start);
+    a_to = cur + 1;
+    return true;
+}
+
 bool
 GDBMIParser::parse_embedded_c_string_body (UString::size_type a_from,
                                            UString::size_type &a_to,
@@ -995,7 +1486,8 @@ GDBMIParser::parse_gdbmi_result (UString::size_type a_from,
     THROW_IF_FAIL (value);
 
 end:
-    GDBMIResultSafePtr result (new GDBMIResult (variable, value, is_singular));
+    GDBMIResultSafePtr result =
+        m_priv->new_node<GDBMIResult> (variable, value, is_singular);
     THROW_IF_FAIL (result);
     a_to = cur;
     a_value = result;
@@ -1015,7 +1507,7 @@ GDBMIParser::parse_gdbmi_value (UString::size_type a_from,
     if (RAW_CHAR_AT (cur) == '"') {
         UString const_string;
         if (parse_c_string (cur, cur, const_string)) {
-            value = GDBMIValueSafePtr (new GDBMIValue (const_string));
+            value = m_priv->new_node<GDBMIValue> (const_string);
             LOG_D ("got str gdbmi value: '"
                     << const_string
                     << "'",
@@ -1025,16 +1517,16 @@ GDBMIParser::parse_gdbmi_value (UString::size_type a_from,
         GDBMITupleSafePtr tuple;
         if (parse_gdbmi_tuple (cur, cur, tuple)) {
             if (!tuple) {
-                value = GDBMIValueSafePtr (new GDBMIValue ());
+                value = m_priv->new_node<GDBMIValue> ();
             } else {
-                value = GDBMIValueSafePtr (new GDBMIValue (tuple));
+                value = m_priv->new_node<GDBMIValue> (tuple);
             }
         }
     } else if (RAW_CHAR_AT (cur) == '[') {
         GDBMIListSafePtr list;
         if (parse_gdbmi_list (cur, cur, list)) {
             THROW_IF_FAIL (list);
-            value = GDBMIValueSafePtr (new GDBMIValue (list));
+            value = m_priv->new_node<GDBMIValue> (list);
         }
     } else {
         LOG_PARSING_ERROR (cur);
@@ -1080,7 +1572,7 @@ GDBMIParser::parse_gdbmi_tuple (UString::size_type a_from,
             SKIP_BLANK (cur);
             CHECK_END (cur);
             if (!tuple) {
-                tuple = GDBMITupleSafePtr (new GDBMITuple);
+                tuple = m_priv->new_node<GDBMITuple> ();
                 THROW_IF_FAIL (tuple);
             }
             tuple->append (result);
@@ -1101,9 +1593,7 @@ GDBMIParser::parse_gdbmi_tuple (UString::size_type a_from,
                << (char)RAW_CHAR_AT (cur)
                << "', at offset '"
                << (int)cur
-               << "' for text >>>"
-               << m_priv->input
-               << "<<<",
+               << "'",
                GDBMI_PARSING_DOMAIN);
         break;
     }
@@ -1130,7 +1620,7 @@ GDBMIParser::parse_gdbmi_list (UString::size_type a_from,
     }
     CHECK_END (cur + 1);
     if (RAW_CHAR_AT (cur + 1) == ']') {
-        a_list = GDBMIListSafePtr (new GDBMIList);
+        a_list = m_priv->new_node<GDBMIList> ();
         cur += 2;
         a_to = cur;
         return true;
@@ -1146,7 +1636,7 @@ GDBMIParser::parse_gdbmi_list (UString::size_type a_from,
          && parse_gdbmi_result (cur, cur, result)) {
         CHECK_END (cur);
         THROW_IF_FAIL (result);
-        return_list = GDBMIListSafePtr (new GDBMIList (result));
+        return_list = m_priv->new_node<GDBMIList> (result);
         for (;;) {
             if (RAW_CHAR_AT (cur) == ',') {
                 ++cur;
@@ -1164,7 +1654,7 @@ GDBMIParser::parse_gdbmi_list (UString::size_type a_from,
     } else if (parse_gdbmi_value (cur, cur, value)) {
         CHECK_END (cur);
         THROW_IF_FAIL (value);
-        return_list = GDBMIListSafePtr (new GDBMIList (value));
+        return_list = m_priv->new_node<GDBMIList> (value);
         for (;;) {
             if (RAW_CHAR_AT (cur) == ',') {
                 ++cur;
@@ -1548,7 +2038,7 @@ GDBMIParser::parse_frame (UString::size_type a_from,
     UString::size_type cur = a_from;
     CHECK_END (cur);
 
-    if (m_priv->input.compare (a_from, strlen (PREFIX_FRAME), PREFIX_FRAME)) {
+    if (RAW_INPUT.compare (a_from, strlen (PREFIX_FRAME), PREFIX_FRAME)) {
         LOG_PARSING_ERROR (cur);
         return false;
     }
@@ -1619,6 +2109,11 @@ GDBMIParser::parse_output_record (UString::size_type a_from,
 {
     LOG_FUNCTION_SCOPE_NORMAL_D (GDBMI_PARSING_DOMAIN);
 
+    // The GDB/MI trees built while parsing the record don't outlive
+    // this function, so allocate them from the arena.  This must
+    // come before any local variable that can hold a GDB/MI node.
+    Priv::ArenaScope arena_scope (*m_priv);
+
     UString::size_type cur = a_from;
 
     if (m_priv->index_passed_end (cur)) {
@@ -1627,13 +2122,19 @@ GDBMIParser::parse_output_record (UString::size_type a_from,
     }
 
     Output output;
-
-    while (RAW_CHAR_AT (cur) == '*'
-           || RAW_CHAR_AT (cur) == '~'
-           || RAW_CHAR_AT (cur) == '@'
-           || RAW_CHAR_AT (cur) == '&'
-           || RAW_CHAR_AT (cur) == '+'
-           || RAW_CHAR_AT (cur) == '=') {
+    UString::size_type after_token = cur;
+    unsigned token = 0;
+
+    // Async records can be prefixed with the token of the command
+    // that triggered them; we don't make any use of it.
+    while (parse_token (cur, after_token, token)
+           && (RAW_CHAR_AT (after_token) == '*'
+               || RAW_CHAR_AT (after_token) == '~'
+               || RAW_CHAR_AT (after_token) == '@'
+               || RAW_CHAR_AT (after_token) == '&'
+               || RAW_CHAR_AT (after_token) == '+'
+               || RAW_CHAR_AT (after_token) == '=')) {
+        cur = after_token;
         Output::OutOfBandRecord oo_record;
         if (!parse_out_of_band_record (cur, cur, oo_record)) {
             LOG_PARSING_ERROR (cur);
@@ -1648,9 +2149,11 @@ GDBMIParser::parse_output_record (UString::size_type a_from,
         return false;
     }
 
-    if (RAW_CHAR_AT (cur) == '^') {
+    if (RAW_CHAR_AT (after_token) == '^') {
+        cur = after_token;
         Output::ResultRecord result_record;
         if (parse_result_record (cur, cur, result_record)) {
+            result_record.token (token);
             output.has_result_record (true);
             output.result_record (result_record);
         }
@@ -1678,6 +2181,31 @@ GDBMIParser::parse_output_record (UString::size_type a_from,
     return true;
 }
 
+bool
+GDBMIParser::parse_token (UString::size_type a_from,
+                          UString::size_type &a_to,
+                          unsigned &a_token)
+{
+    UString::size_type cur = a_from;
+    unsigned token = 0;
+
+    while (!m_priv->index_passed_end (cur)
+           && isdigit (RAW_CHAR_AT (cur))) {
+        unsigned digit = RAW_CHAR_AT (cur) - '0';
+        if (token > (UINT_MAX - digit) / 10) {
+            LOG_PARSING_ERROR (cur);
+            a_token = 0;
+            a_to = a_from;
+            return false;
+        }
+        token = token * 10 + digit;
+        ++cur;
+    }
+    a_token = token;
+    a_to = cur;
+    return true;
+}
+
 /// Skip everything from the current output report until the next
 /// "(gdb)" marker, meaning the start of the next output record.
 /// \param a_from the index where to start skipping from
@@ -1878,14 +2406,14 @@ fetch_gdbmi_result:
                     result_record.breakpoints ()[breakpoint.id ()] =
                     breakpoint;
                 }
-            } else if (!m_priv->input.compare (cur,
+            } else if (!RAW_INPUT.compare (cur,
                                                strlen (PREFIX_BREAKPOINT_TABLE),
                                                PREFIX_BREAKPOINT_TABLE)) {
                 map<string, IDebugger::Breakpoint> breaks;
                 if (parse_breakpoint_table (cur, cur, breaks)) {
                     result_record.breakpoints () = breaks;
                 }
-            } else if (!m_priv->input.compare (cur, strlen (PREFIX_THREAD_IDS),
+            } else if (!RAW_INPUT.compare (cur, strlen (PREFIX_THREAD_IDS),
                         PREFIX_THREAD_IDS)) {
                 std::list<int> thread_ids;
                 if (parse_threads_list (cur, cur, thread_ids)) {
@@ -1900,7 +2428,7 @@ fetch_gdbmi_result:
                     //finish this !
                     result_record.thread_id_selected_info (thread_id, frame);
                 }
-            } else if (!m_priv->input.compare (cur, strlen (PREFIX_FILES),
+            } else if (!RAW_INPUT.compare (cur, strlen (PREFIX_FILES),
                         PREFIX_FILES)) {
                 vector<UString> files;
                 if (!parse_file_list (cur, cur, files)) {
@@ -2007,7 +2535,7 @@ fetch_gdbmi_result:
                     LOG_D ("parsed register values", GDBMI_PARSING_DOMAIN);
                     result_record.register_values (values);
                 }
-            } else if (!m_priv->input.compare (cur,
+            } else if (!RAW_INPUT.compare (cur,
                                                strlen (PREFIX_MEMORY_VALUES),
                                                PREFIX_MEMORY_VALUES)) {
                 size_t addr;
@@ -2018,6 +2546,17 @@ fetch_gdbmi_result:
                     LOG_D ("parsed memory values", GDBMI_PARSING_DOMAIN);
                     result_record.memory_values (addr, values);
                 }
+            } else if (!RAW_INPUT.compare (cur,
+                                           strlen (PREFIX_MEMORY_BYTES),
+                                           PREFIX_MEMORY_BYTES)) {
+                size_t addr = 0;
+                std::vector<uint8_t> values;
+                if (!parse_memory_bytes (cur, cur, addr, values)) {
+                    LOG_PARSING_ERROR (cur);
+                } else {
+                    LOG_D ("parsed memory bytes", GDBMI_PARSING_DOMAIN);
+                    result_record.memory_values (addr, values);
+                }
             } else if (!RAW_INPUT.compare (cur,
                                            strlen (PREFIX_ASM_INSTRUCTIONS),
                                            PREFIX_ASM_INSTRUCTIONS)) {
@@ -2081,6 +2620,28 @@ fetch_gdbmi_result:
                 } else {
                     LOG_PARSING_ERROR (cur);
                 }
+            } else if (!RAW_INPUT.compare (cur,
+                                           strlen (PREFIX_STACK_DEPTH),
+                                           PREFIX_STACK_DEPTH)) {
+                int depth = 0;
+                if (parse_stack_depth (cur, cur, depth)) {
+                    result_record.stack_depth (depth);
+                } else {
+                    LOG_PARSING_ERROR (cur);
+                }
+            } else if (!RAW_INPUT.compare (cur,
+                                           strlen (PREFIX_HAS_MORE),
+                                           PREFIX_HAS_MORE)) {
+                // This follows the children returned by
+                // -var-list-children when they are a window of the
+                // children of the variable.
+                UString name, value;
+                if (parse_gdbmi_string_result (cur, cur, name, value)) {
+                    result_record.has_more_variable_children
+                                                        (value != "0");
+                } else {
+                    LOG_PARSING_ERROR (cur);
+                }
             } else if (!RAW_INPUT.compare (cur,
                                            strlen (PREFIX_VARIABLE_FORMAT),
                                            PREFIX_VARIABLE_FORMAT)) {
@@ -3257,7 +3818,8 @@ GDBMIParser::parse_member_variable (const UString::size_type a_from,
             }
             //we should be at the end of A (as in A = B)
             name_end = cur - 1;
-            name.assign (RAW_INPUT, name_start, name_end - name_start + 1);
+            name = RAW_INPUT.substr (name_start,
+                                    name_end - name_start + 1).to_ustring ();
             LOG_D ("got name '" << name << "'", GDBMI_PARSING_DOMAIN);
         }
 
@@ -3351,8 +3913,9 @@ GDBMIParser::parse_member_variable (const UString::size_type a_from,
             }
             if (cur != value_start) {
                 value_end = cur - 1;
-                value.assign (RAW_INPUT, value_start,
-                              value_end - value_start + 1);
+                value = RAW_INPUT.substr (value_start,
+                                          value_end - value_start + 1)
+                            .to_ustring ();
                 LOG_D ("got value: '"
                        << value << "'",
                        GDBMI_PARSING_DOMAIN);
@@ -3504,6 +4067,32 @@ GDBMIParser::parse_variables_deleted (UString::size_type a_from,
     return true;
 }
 
+/// Parse the result of -stack-info-depth, which looks like:
+/// 'depth="12"'
+bool
+GDBMIParser::parse_stack_depth (UString::size_type a_from,
+                                UString::size_type &a_to,
+                                int &a_depth)
+{
+    LOG_FUNCTION_SCOPE_NORMAL_D (GDBMI_PARSING_DOMAIN);
+    UString::size_type cur = a_from;
+    CHECK_END (cur);
+
+    UString name, value;
+    if (!parse_gdbmi_string_result (cur, cur, name, value)) {
+        LOG_PARSING_ERROR (cur);
+        return false;
+    }
+    if (name != STACK_DEPTH) {
+        LOG_ERROR ("expected gdbmi variable " << STACK_DEPTH << ", got: "
+                   << name << "\'");
+        return false;
+    }
+    a_depth = atoi (value.c_str ());
+    a_to = cur;
+    return true;
+}
+
 // We want to parse something like:
 // 'numchild=N,children=[{name=NAME,numchild=N,type=TYPE}]'
 // It's actually two RESULTs, separated by a comma. The second
@@ -4283,6 +4872,88 @@ GDBMIParser::parse_memory_values (UString::size_type a_from,
     return true;
 }
 
+bool
+GDBMIParser::parse_memory_bytes (UString::size_type a_from,
+                                 UString::size_type &a_to,
+                                 size_t &a_start_addr,
+                                 std::vector<uint8_t> &a_values)
+{
+    LOG_FUNCTION_SCOPE_NORMAL_D (GDBMI_PARSING_DOMAIN);
+    UString::size_type cur = a_from;
+
+    if (RAW_INPUT.compare (cur, strlen (PREFIX_MEMORY_BYTES),
+                           PREFIX_MEMORY_BYTES)) {
+        LOG_PARSING_ERROR (cur);
+        return false;
+    }
+    // Point to the '['.
+    cur += strlen (PREFIX_MEMORY_BYTES) - 1;
+
+    GDBMIListSafePtr blocks;
+    if (!parse_gdbmi_list (cur, cur, blocks)) {
+        LOG_PARSING_ERROR (cur);
+        return false;
+    }
+    std::list<GDBMIValueSafePtr> block_list;
+    if (!blocks->empty ()) {
+        if (blocks->content_type () != GDBMIList::VALUE_TYPE) {
+            LOG_PARSING_ERROR (cur);
+            return false;
+        }
+        blocks->get_value_content (block_list);
+    }
+
+    size_t start_addr = 0;
+    std::vector<uint8_t> values;
+    std::list<GDBMIValueSafePtr>::const_iterator block;
+    for (block = block_list.begin (); block != block_list.end (); ++block) {
+        if ((*block)->content_type () != GDBMIValue::TUPLE_TYPE) {
+            LOG_PARSING_ERROR (cur);
+            return false;
+        }
+        UString begin, contents;
+        const GDBMITupleSafePtr tuple = (*block)->get_tuple_content ();
+        std::list<GDBMIResultSafePtr>::const_iterator it;
+        for (it = tuple->content ().begin ();
+             it != tuple->content ().end ();
+             ++it) {
+            if ((*it)->value ()->content_type () != GDBMIValue::STRING_TYPE)
+                continue;
+            if ((*it)->variable () == "begin")
+                begin = (*it)->value ()->get_string_content ();
+            else if ((*it)->variable () == "contents")
+                contents = (*it)->value ()->get_string_content ();
+        }
+        if (begin.empty () || contents.bytes () % 2) {
+            LOG_PARSING_ERROR (cur);
+            return false;
+        }
+
+        size_t addr = strtoull (begin.c_str (), 0, 16);
+        if (block == block_list.begin ())
+            start_addr = addr;
+        else if (addr != start_addr + values.size ())
+            break;
+
+        const std::string &hex = contents.raw ();
+        values.reserve (values.size () + hex.size () / 2);
+        for (std::string::size_type i = 0; i < hex.size (); i += 2) {
+            int high = g_ascii_xdigit_value (hex[i]);
+            int low = g_ascii_xdigit_value (hex[i + 1]);
+            if (high < 0 || low < 0) {
+                LOG_PARSING_ERROR (cur);
+                return false;
+            }
+            values.push_back (static_cast<uint8_t> (high << 4 | low));
+        }
+    }
+
+    a_start_addr = start_addr;
+    a_values.swap (values);
+    a_to = cur;
+    return true;
+}
+
 bool
 GDBMIParser::parse_asm_instruction_list
                                 (UString::size_type a_from,
@@ -4711,7 +5382,7 @@ GDBMIParser::parse_overloads_choice_prompt
                 LOG_PARSING_ERROR (cur);
                 return false;
             }
-            function_name.assign (RAW_INPUT, b, e-b);
+            function_name = RAW_INPUT.substr (b, e-b).to_ustring ();
 
             cur += 4;
             SKIP_WS (cur);
@@ -4729,7 +5400,7 @@ GDBMIParser::parse_overloads_choice_prompt
                 LOG_PARSING_ERROR (cur);
                 return false;
             }
-            file_name.assign (RAW_INPUT, b, e-b);
+            file_name = RAW_INPUT.substr (b, e-b).to_ustring ();
             ++cur;
             SKIP_WS (cur);
             c = RAW_CHAR_AT (cur);
@@ -243,6 +243,12 @@ public:
 
     bool empty () const {return m_empty;}
 
+    void clear ()
+    {
+        m_content.clear ();
+        m_empty = true;
+    }
+
     void append (const GDBMIResultSafePtr &a_result)
     {
         THROW_IF_FAIL (a_result);
@@ -314,6 +320,108 @@ bool gdbmi_value_to_string (GDBMIValueSafePtr a_value, UString &a_string);
 
 bool gdbmi_tuple_to_string (GDBMITupleSafePtr a_result, UString &a_string);
 
+/// A non owning view on a range of bytes of the input of a
+/// GDBMIParser.
+///
+/// Parsing entry points that return slices don't copy anything; the
+/// slice is only valid as long as the parser input it points into is
+/// alive.  Use to_ustring () to get an owned string out of it, if it
+/// needs to be kept around.
+class GDBMIStringSlice {
+    const char *m_data;
+    UString::size_type m_size;
+
+public:
+
+    GDBMIStringSlice () :
+        m_data (0),
+        m_size (0)
+    {}
+
+    GDBMIStringSlice (const char *a_data, UString::size_type a_size) :
+        m_data (a_data),
+        m_size (a_size)
+    {}
+
+    const char* data () const {return m_data;}
+
+    UString::size_type size () const {return m_size;}
+
+    bool empty () const {return !m_size;}
+
+    char operator[] (UString::size_type a_index) const
+    {
+        return m_data[a_index];
+    }
+
+    /// Compare the sub-slice [a_pos, a_pos + a_len) with a_str.  This
+    /// has the semantic of std::string::compare, except that an out
+    /// of range a_pos is just reported as a mismatch.
+    /// \return 0 if the two strings are equal.
+    int compare (UString::size_type a_pos,
+                 UString::size_type a_len,
+                 const char *a_str) const;
+
+    /// \return the offset of the first occurrence of a_str found at
+    /// or after a_pos, or UString::npos if there is none.
+    UString::size_type find (const char *a_str,
+                             UString::size_type a_pos = 0) const;
+
+    GDBMIStringSlice substr (UString::size_type a_pos,
+                             UString::size_type a_len = UString::npos) const;
+
+    /// Copy the bytes of the slice into a new UString.
+    UString to_ustring () const;
+
+    bool operator== (const char *a_str) const;
+};//end class GDBMIStringSlice
+
+/// Splits the byte stream coming from GDB into output records, that
+/// is, into chunks ending with a "(gdb)" prompt.
+///
+/// Bytes are appended as they are read from GDB, in chunks of any
+/// size.  The scanning for the end of a record resumes where the
+/// previous one stopped, so every byte of the stream is looked at a
+/// bounded number of times, and consumed records are not erased
+/// from the front of the buffer one by one: the consumed prefix is
+/// dropped by append, only once it is at least as big as what is
+/// still pending.
+class GDBMIRecordReader {
+    // non copyable
+    GDBMIRecordReader (const GDBMIRecordReader &);
+    GDBMIRecordReader& operator= (const GDBMIRecordReader &);
+
+    std::string m_buffer;
+    // Offset of the first byte that has not been consumed yet.
+    std::string::size_type m_begin;
+    // Offset where the scanning for the "\n(gdb)" prompt resumes.
+    std::string::size_type m_scan;
+
+public:
+
+    GDBMIRecordReader ();
+
+    /// Append a chunk of bytes read from GDB.  This invalidates the
+    /// slices previously returned by next_record and pending.
+    void append (const char *a_data, std::string::size_type a_len);
+
+    /// Extract the next complete output record, if any.
+    /// \param a_record output parameter.  Set to the record, stripped
+    /// from its leading and trailing white spaces, so that it ends
+    /// with the "(gdb)" prompt.  It points into the reader's buffer
+    /// and stays valid until the next call to append or clear.
+    /// \return true if a complete record was extracted, false if
+    /// more bytes are needed.
+    bool next_record (GDBMIStringSlice &a_record);
+
+    /// \return the bytes that have been appended but don't make a
+    /// complete record yet.
+    GDBMIStringSlice pending () const;
+
+    /// Forget about all the bytes that have been appended so far.
+    void clear ();
+};//end class GDBMIRecordReader
+
 //**************************
 //GDBMI parsing functions
 //**************************
@@ -348,9 +456,19 @@ public:
     virtual ~GDBMIParser ();
 
     void push_input (const UString &a_input);
+
+    /// Push a borrowed input on the input stack.  The bytes are not
+    /// copied: the caller must keep [a_input, a_input + a_len) alive
+    /// and unchanged until the matching pop_input ().
+    void push_input (const char *a_input, UString::size_type a_len);
+
     void pop_input ();
     const UString& get_input () const;
 
+    /// \return a view on the whole current input.  This never copies,
+    /// even when the input was borrowed.
+    GDBMIStringSlice get_input_slice () const;
+
     void set_mode (Mode);
     Mode get_mode () const;
 
@@ -364,6 +482,12 @@ public:
                        UString::size_type &a_to,
                        UString &a_string);
 
+    /// Like the overload above, but returns a slice of the input
+    /// instead of copying the string.
+    bool parse_string (UString::size_type a_from,
+                       UString::size_type &a_to,
+                       GDBMIStringSlice &a_string);
+
     bool parse_octal_escape (UString::size_type a_from,
                              UString::size_type &a_to,
                              unsigned char &a_byte_value);
@@ -382,6 +506,17 @@ public:
                          UString::size_type &a_to,
                          UString &a_c_string);
 
+    /// parses a string that has the form:
+    /// \"blah\"
+    /// where blah contains no escape sequence.  The result is a slice
+    /// of the input, so nothing is copied.
+    /// \return false if the string is not a c string or if it
+    /// contains an escape sequence.  In that later case, the caller
+    /// must use parse_c_string instead.
+    bool parse_verbatim_c_string (UString::size_type a_from,
+                                  UString::size_type &a_to,
+                                  GDBMIStringSlice &a_c_string);
+
     bool parse_embedded_c_string_body (UString::size_type a_from,
                                        UString::size_type &a_to,
                                        UString &a_string);
@@ -625,6 +760,15 @@ public:
                               size_t& a_start_addr,
                               std::vector<uint8_t> &a_values);
 
+    /// Parse the output of the -data-read-memory-bytes command.
+    /// GDB reports one block of memory per readable region of the
+    /// requested range; only the first block and the blocks that
+    /// are contiguous to it are returned.
+    bool parse_memory_bytes (UString::size_type a_from,
+                             UString::size_type &a_to,
+                             size_t &a_start_addr,
+                             std::vector<uint8_t> &a_values);
+
     /// parse an asm instruction description as returned
     /// by GDB/MI
     bool parse_asm_instruction_list (UString::size_type a_from,
@@ -639,6 +783,10 @@ public:
                                   UString::size_type &a_to,
                                   unsigned int &a_nb_vars_deleted);
 
+    bool parse_stack_depth (UString::size_type a_from,
+                            UString::size_type &a_to,
+                            int &a_depth);
+
     bool parse_var_list_children (UString::size_type a_from,
                                   UString::size_type &a_to,
                                   vector<IDebugger::VariableSafePtr> &a_vars);
@@ -656,6 +804,18 @@ public:
                                 IDebugger::Variable::Format &a_format,
                                 UString &a_value);
 
+    /// Parse the optional numeric token that can prefix an output
+    /// record.
+    /// \param a_to output parameter.  Set to the index right after
+    /// the token, or to a_from if there is no token.
+    /// \param a_token output parameter.  Set to the token, or to 0 if
+    /// there is no token.
+    /// \return false if the token doesn't fit in an unsigned int, in
+    /// which case it is handled as if there was no token.
+    bool parse_token (UString::size_type a_from,
+                      UString::size_type &a_to,
+                      unsigned &a_token);
+
     bool parse_result_record (UString::size_type a_from,
                               UString::size_type &a_to,
                               Output::ResultRecord &a_record);
@@ -36,6 +36,7 @@
 #include "common/nmv-dynamic-module.h"
 #include "common/nmv-safe-ptr-utils.h"
 #include "common/nmv-address.h"
+#include "common/nmv-interned-string.h"
 #include "common/nmv-asm-instr.h"
 #include "common/nmv-loc.h"
 #include "common/nmv-str-utils.h"
@@ -50,6 +51,7 @@ using nemiver::common::ObjectUnref;
 using nemiver::common::UString;
 using nemiver::common::Object;
 using nemiver::common::Address;
+using nemiver::common::InternedString;
 using nemiver::common::AsmInstr;
 using nemiver::common::MixedAsmInstr;
 using nemiver::common::Asm;
@@ -103,8 +105,8 @@ public:
         Address m_address;
         string m_function;
         string m_expression;
-        UString m_file_name;
-        UString m_file_full_name;
+        InternedString m_file_name;
+        InternedString m_file_full_name;
         string m_condition;
         Type m_type;
         int m_line;
@@ -209,10 +211,13 @@ public:
         const string& expression () const {return m_expression;}
         void expression (const string &a_expr) {m_expression = a_expr;}
 
-        const UString& file_name () const {return m_file_name;}
+        const UString& file_name () const {return m_file_name.str ();}
         void file_name (const UString &a_in) {m_file_name = a_in;}
 
-        const UString& file_full_name () const {return m_file_full_name;}
+        const UString& file_full_name () const
+        {
+            return m_file_full_name.str ();
+        }
         void file_full_name (const UString &a_in) {m_file_full_name = a_in;}
 
         int line () const {return m_line;}
@@ -371,16 +376,18 @@ public:
     /// \brief a function frame as seen by the debugger.
     class Frame {
         Address m_address;
-        string m_function_name;
+        // The names are interned: the same few are held by the frames
+        // of all the call stacks.
+        InternedString m_function_name;
         map<string, string> m_args;
         int m_level;
         //present if the target has debugging info
-        UString m_file_name;
+        InternedString m_file_name;
         //present if the target has sufficient debugging info
-        UString m_file_full_name;
+        InternedString m_file_full_name;
         int m_line;
         //present if the target doesn't have debugging info
-        string m_library;
+        InternedString m_library;
     public:
 
         Frame () :
@@ -395,9 +402,9 @@ public:
         bool operator== (const Frame &a) const
         {
             return (level () == a.level ()
-                    && function_name () == a.function_name ()
-                    && file_name () == a.file_name ()
-                    && library () == a.library ());
+                    && m_function_name == a.m_function_name
+                    && m_file_name == a.m_file_name
+                    && m_library == a.m_library);
         }
 
         bool operator!= (const Frame &a) const {return !(operator== (a));}
@@ -411,10 +418,10 @@ public:
         void address (const Address &a_in) {m_address = a_in;}
         bool has_empty_address () const
         {
-            return m_address.to_string ().empty ();
+            return m_address.empty ();
         }
 
-        const string& function_name () const {return m_function_name;}
+        const string& function_name () const {return m_function_name.raw ();}
         void function_name (const string &a_in) {m_function_name = a_in;}
 
         const map<string, string>& args () const {return m_args;}
@@ -423,16 +430,19 @@ public:
         int level () const {return m_level;}
         void level (int a_level) {m_level = a_level;}
 
-        const UString& file_name () const {return m_file_name;}
+        const UString& file_name () const {return m_file_name.str ();}
         void file_name (const UString &a_in) {m_file_name = a_in;}
 
-        const UString& file_full_name () const {return m_file_full_name;}
+        const UString& file_full_name () const
+        {
+            return m_file_full_name.str ();
+        }
         void file_full_name (const UString &a_in) {m_file_full_name = a_in;}
 
         int line () const {return m_line;}
         void line (int a_in) {m_line = a_in;}
 
-        const string& library () const {return m_library;}
+        const string& library () const {return m_library.raw ();}
         void library (const string &a_library) {m_library = a_library;}
 
         /// @}
@@ -441,11 +451,11 @@ public:
         void clear ()
         {
             m_address = "";
-            m_function_name = "";
+            m_function_name.clear ();
             m_args.clear ();
             m_level = 0;
-            m_file_name = "";
-            m_file_full_name = "";
+            m_file_name.clear ();
+            m_file_full_name.clear ();
             m_line = 0;
             m_library.clear ();
             m_args.clear ();
@@ -460,6 +470,11 @@ public:
 
     typedef sigc::slot<void, const VariableSafePtr> ConstVariableSlot;
     typedef sigc::slot<void, const VariableList&> ConstVariableListSlot;
+    typedef sigc::slot<void,
+                       int,
+                       int,
+                       const VariableList&,
+                       const VariableList&> PooledFrameVariablesSlot;
     typedef sigc::slot<void, const UString&> ConstUStringSlot;
 
     class Variable : public Object {
@@ -494,7 +509,9 @@ public:
         UString m_name;
         UString m_name_caption;
         UString m_value;
-        UString m_type;
+        // The type, the visualizer and the display hint are interned:
+        // a few of them are shared by all the variables.
+        InternedString m_type;
         // When using GDB pretty-printers, this is a string naming the
         // pretty printer used to visualize this variable. As
         // disabling pretty printing is not possible globally in GDB
@@ -504,8 +521,8 @@ public:
         // using  the default pretty printer; if pretty printing is
         // disabled the variable would be displayed using no pretty
         // printer.
-        UString m_visualizer;
-        UString m_display_hint;
+        InternedString m_visualizer;
+        InternedString m_display_hint;
         Variable *m_parent;
         //if this variable is a pointer,
         //it can be dereferenced. The variable
@@ -740,14 +757,17 @@ public:
         const UString& value () const {return m_value;}
         void value (const UString &a_value) {m_value = a_value;}
 
-        const UString& type () const {return m_type;}
+        const UString& type () const {return m_type.str ();}
         void type (const UString &a_type) {m_type = a_type;}
         void type (const string &a_type) {m_type = a_type;}
 
-        const UString& visualizer () const {return m_visualizer;}
+        const UString& visualizer () const {return m_visualizer.str ();}
         void visualizer (const UString &a) {m_visualizer = a;}
 
-        const UString& display_hint () const {return m_display_hint;};
+        const UString& display_hint () const
+        {
+            return m_display_hint.str ();
+        }
         void display_hint (const UString &a) {m_display_hint = a;}
 
         /// Return true if this instance of Variable has a parent variable,
@@ -974,6 +994,18 @@ public:
             return (expects_children () && members ().empty ());
         }
 
+        /// \return true if the current variable was unfolded by
+        /// windows of children, and some of its children remain to
+        /// be unfolded.
+        bool needs_more_unfolding () const
+        {
+            if (members ().empty ())
+                return false;
+            if (is_dynamic ())
+                return has_more_children ();
+            return members ().size () < num_expected_children ();
+        }
+
         /// Return the descendant of the current instance of Variable.
         /// \param a_internal_path the internal fully qualified path of the
         ///        descendant variable.
@@ -1088,6 +1120,100 @@ public:
         return false;
     }
 
+    /// The latencies of the commands of a given name, in
+    /// microseconds.  The life of a command is split in phases, and
+    /// the durations of each phase are gathered in a histogram.
+    class CommandLatency {
+    public:
+        enum Phase {
+            // From the queuing of the command to its issuing.
+            QUEUED_PHASE=0,
+            // From the issuing of the command to the reception of
+            // the first byte of its result.
+            DEBUGGER_PHASE,
+            // From the first byte of the result to the last one.
+            RECEIVE_PHASE,
+            // The parsing of the result.
+            PARSE_PHASE,
+            // The output handlers of the result.
+            HANDLERS_PHASE,
+            // From the queuing of the command to the end of the
+            // output handlers.
+            TOTAL_PHASE,
+            NB_PHASES
+        };//end enum Phase
+
+        /// The bucket 0 of a histogram counts the durations of less
+        /// than 1us, the bucket i > 0 counts the durations d such
+        /// that 2^(i-1)us <= d < 2^i us, and the last bucket counts
+        /// all the longer ones.
+        enum {NB_BUCKETS = 26};
+
+        class Histogram {
+        public:
+            unsigned long nb_samples;
+            int64_t total;
+            int64_t max;
+            unsigned long buckets[NB_BUCKETS];
+
+            Histogram () :
+                nb_samples (0),
+                total (0),
+                max (0)
+            {
+                for (int i = 0; i < NB_BUCKETS; ++i)
+                    buckets[i] = 0;
+            }
+
+            static int bucket_of (int64_t a_duration)
+            {
+                int i = 0;
+                while (a_duration > 0 && i < NB_BUCKETS - 1) {
+                    a_duration >>= 1;
+                    ++i;
+                }
+                return i;
+            }
+
+            void add (int64_t a_duration)
+            {
+                if (a_duration < 0)
+                    a_duration = 0;
+                ++nb_samples;
+                total += a_duration;
+                if (a_duration > max)
+                    max = a_duration;
+                ++buckets[bucket_of (a_duration)];
+            }
+        };//end class Histogram
+
+        Histogram phases[NB_PHASES];
+
+        static const char* phase_to_string (Phase a_phase)
+        {
+            switch (a_phase) {
+            case QUEUED_PHASE:
+                return "queued";
+            case DEBUGGER_PHASE:
+                return "debugger";
+            case RECEIVE_PHASE:
+                return "receive";
+            case PARSE_PHASE:
+                return "parse";
+            case HANDLERS_PHASE:
+                return "handlers";
+            case TOTAL_PHASE:
+                return "total";
+            default:
+                break;
+            }
+            return "unknown";
+        }
+    };//end class CommandLatency
+
+    /// The latencies of the commands, by command name.
+    typedef std::map<std::string, CommandLatency> CommandLatencyMap;
+
     typedef sigc::slot<void,
                        const std::map<string, IDebugger::Breakpoint>&>
         BreakpointsSlot;
@@ -1424,6 +1550,12 @@ public:
 
     virtual void step_in_asm (const UString &a_cookie="") = 0;
 
+    /// \return true if step commands are waiting in the command
+    /// queue of the engine, or waiting for their results.  When the
+    /// inferior stops while that is the case, it is about to be
+    /// stepped again.
+    virtual bool has_pending_steps () const = 0;
+
     virtual void continue_to_position (const UString &a_path,
                                        gint a_line_num,
                                        const UString &a_cookie="") = 0;
@@ -1594,6 +1726,22 @@ public:
             const std::vector<uint8_t>& a_bytes,
             const UString& a_cookie="") = 0;
 
+    /// Get the statistics of the cache that read_memory goes through.
+    /// \param a_nb_hits output parameter.  The number of pages of
+    /// memory that were found in the cache.
+    /// \param a_nb_misses output parameter.  The number of pages of
+    /// memory that had to be read from the inferior.
+    virtual void get_memory_cache_stats (unsigned long &a_nb_hits,
+                                         unsigned long &a_nb_misses) const = 0;
+
+    /// Get the latencies of the commands sent to the debugger so
+    /// far, by command name.
+    virtual void get_command_latency_stats
+                                (CommandLatencyMap &a_stats) const = 0;
+
+    /// Forget about the latencies gathered so far.
+    virtual void clear_command_latency_stats () = 0;
+
     typedef sigc::slot<void,
                        const DisassembleInfo&,
                        const std::list<Asm>& > DisassSlot;
@@ -1702,6 +1850,21 @@ public:
                  const ConstVariableSlot&,
                  const UString &a_cookie = "") = 0;
 
+    /// Unfold the window [a_from, a_to[ of the children of a_var
+    /// only, and append them to its members.  Unfolding the next
+    /// window of a big container is then done with a_from set to
+    /// the number of members of a_var.  The children past the window
+    /// are told by Variable::needs_more_unfolding.  If the children
+    /// can't be listed, the slot is invoked all the same, with a_var
+    /// unchanged, so that the caller can offer to unfold the window
+    /// again.
+    virtual void unfold_variable
+                (VariableSafePtr a_var,
+                 int a_from,
+                 int a_to,
+                 const ConstVariableSlot&,
+                 const UString &a_cookie = "") = 0;
+
     virtual void assign_variable (const VariableSafePtr a_var,
                                   const UString &a_expression,
                                   const UString &a_cookie = "") = 0;
@@ -1746,6 +1909,64 @@ public:
              const ConstVariableListSlot &a_slot,
              const UString &a_cookie="") = 0;
 
+    /// Like list_changed_variables, but cheaper when many roots are
+    /// to be updated: the roots passed to this function during the
+    /// same iteration of the event loop are all updated by a single
+    /// request to the backend, that updates all the variables.
+    ///
+    /// \param a_root the variable to consider.
+    ///
+    /// \param a_slot the slot to be invoked with the sub-variables of
+    /// a_root (including a_root) that changed.
+    ///
+    /// \param a_cookie the cookie to be passed to
+    /// IDebugger::changed_variables_signal.
+    virtual void list_changed_variables_of_all
+            (VariableSafePtr a_root,
+             const ConstVariableListSlot &a_slot,
+             const UString &a_cookie = "") = 0;
+
+    /// Put the local variables and the arguments of a frame in the
+    /// pool of variable objects of the engine, so that they can be
+    /// reused if the frame is displayed again.  The pool only keeps
+    /// the variables of the frames that were recently put.
+    ///
+    /// \param a_thread_id the thread of the frame.
+    ///
+    /// \param a_frame the frame.
+    ///
+    /// \param a_frame_depth the depth of the frame, as passed to the
+    /// slot of get_pooled_frame_variables.
+    ///
+    /// \param a_local_variables the local variables of the frame.
+    ///
+    /// \param a_function_arguments the arguments of the frame.
+    virtual void pool_frame_variables
+            (int a_thread_id,
+             const Frame &a_frame,
+             int a_frame_depth,
+             const VariableList &a_local_variables,
+             const VariableList &a_function_arguments) = 0;
+
+    /// Take the variables of a frame of the current thread out of
+    /// the pool of variable objects of the engine.
+    ///
+    /// \param a_frame the frame.
+    ///
+    /// \param a_slot the slot to invoke with the thread that was
+    /// current when the variables were requested, the depth of the
+    /// frame -- the number of frames between it and the outermost
+    /// frame -- and the local variables and arguments the pool had
+    /// for the frame.  The lists are empty if the pool had nothing for the
+    /// frame.  Otherwise the values of the variables are those they
+    /// had when they were put in the pool.
+    ///
+    /// \param a_cookie a string passed to the slot.
+    virtual void get_pooled_frame_variables
+            (const Frame &a_frame,
+             const PooledFrameVariablesSlot &a_slot,
+             const UString &a_cookie = "") = 0;
+
     virtual void query_variable_path_expr (const VariableSafePtr a_var,
                                            const UString &a_cookie = "") = 0;
 
@@ -92,6 +92,12 @@ public:
     /// this can prevent inifite recursions.
     virtual void set_maximum_member_depth (unsigned a_max_depth) = 0;
     virtual unsigned get_maximum_member_depth () const = 0;
+
+    /// accessor of the maximum number of children of a variable to
+    /// unfold.  Only the first ones of the children of big
+    /// containers are then queried.  Zero means no limit.
+    virtual void set_maximum_number_of_children (unsigned a_max) = 0;
+    virtual unsigned get_maximum_number_of_children () const = 0;
 }; // end IVarWalker
 
 NEMIVER_END_NAMESPACE (nemiver)
@@ -119,6 +119,10 @@ public:
     void set_maximum_member_depth (unsigned a_max_depth);
 
     unsigned get_maximum_member_depth () const;
+
+    void set_maximum_number_of_children (unsigned a_max);
+
+    unsigned get_maximum_number_of_children () const;
 };//end class VarWalker
 
 void
@@ -340,6 +344,17 @@ VarWalker::get_maximum_member_depth () const
     return 0;
 }
 
+void
+VarWalker::set_maximum_number_of_children (unsigned)
+{
+}
+
+unsigned
+VarWalker::get_maximum_number_of_children () const
+{
+    return 0;
+}
+
 //the dynmod used to instanciate the VarWalker service object
 //and return an interface on it.
 struct VarWalkerDynMod : public  DynamicModule {
@@ -60,6 +60,9 @@ class VarobjWalker : public IVarWalker, public sigc::trackable
     int m_variable_unfolds;
 
     unsigned m_max_depth;
+    // The maximum number of children of a variable to unfold, or
+    // zero to unfold all of them.
+    unsigned m_max_children;
 
     VarobjWalker (); // Don't call this constructor.
 
@@ -70,7 +73,8 @@ public:
         m_debugger (0),
         m_do_walk (false),
         m_variable_unfolds (0),
-        m_max_depth (MAX_DEPTH)
+        m_max_depth (MAX_DEPTH),
+        m_max_children (0)
     {
     }
 
@@ -97,6 +101,10 @@ public:
 
     unsigned get_maximum_member_depth () const;
 
+    void set_maximum_number_of_children (unsigned a_max);
+
+    unsigned get_maximum_number_of_children () const;
+
     void do_walk_variable_real (const IDebugger::VariableSafePtr,
                                 unsigned a_max_depth);
 
@@ -202,6 +210,22 @@ VarobjWalker::get_maximum_member_depth () const
     return m_max_depth;
 }
 
+void
+VarobjWalker::set_maximum_number_of_children (unsigned a_max)
+{
+    LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+    m_max_children = a_max;
+}
+
+unsigned
+VarobjWalker::get_maximum_number_of_children () const
+{
+    LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+    return m_max_children;
+}
+
 void
 VarobjWalker::do_walk_variable_real (const IDebugger::VariableSafePtr a_var,
                                      unsigned a_max_depth)
@@ -220,11 +244,14 @@ VarobjWalker::do_walk_variable_real (const IDebugger::VariableSafePtr a_var,
         && m_debugger->get_language_trait ().is_variable_compound (a_var)) {
         LOG_DD ("needs unfolding");
         m_variable_unfolds++;
-        m_debugger->unfold_variable
-            (a_var,
-             sigc::bind (sigc::mem_fun (*this,
+        IDebugger::ConstVariableSlot slot =
+            sigc::bind (sigc::mem_fun (*this,
                                    &VarobjWalker::on_variable_unfolded_signal),
-                         a_max_depth - 1));
+                        a_max_depth - 1);
+        if (m_max_children)
+            m_debugger->unfold_variable (a_var, 0, m_max_children, slot);
+        else
+            m_debugger->unfold_variable (a_var, slot);
     } else if (!a_var->members ().empty ()) {
         LOG_DD ("children need visiting");
         visited_variable_node_signal ().emit (a_var);
@@ -30,6 +30,7 @@
 #include <gtkmm/treerowreference.h>
 #include "common/nmv-exception.h"
 #include "nmv-breakpoints-view.h"
+#include "nmv-refresh-scheduler.h"
 #include "nmv-ui-utils.h"
 #include "nmv-i-workbench.h"
 #include "nmv-i-perspective.h"
@@ -105,19 +106,24 @@ public:
     IWorkbench& workbench;
     IPerspective& perspective;
     IDebuggerSafePtr& debugger;
-    bool is_up2date;
+    RefreshScheduler &refresh_scheduler;
 
     Priv (IWorkbench& a_workbench,
           IPerspective& a_perspective,
-          IDebuggerSafePtr& a_debugger) :
+          IDebuggerSafePtr& a_debugger,
+          RefreshScheduler &a_refresh_scheduler) :
         breakpoints_menu(0),
         workbench(a_workbench),
         perspective(a_perspective),
         debugger(a_debugger),
-        is_up2date (true)
+        refresh_scheduler (a_refresh_scheduler)
     {
         init_actions ();
         build_tree_view ();
+        refresh_scheduler.register_view
+            (*tree_view, RefreshScheduler::CHEAP_REFRESH,
+             sigc::mem_fun (*this,
+                            &Priv::finish_handling_debugger_stopped_event));
 
         // update breakpoint list when debugger indicates that the list of
         // breakpoints has changed.
@@ -133,6 +139,11 @@ public:
                 "/BreakpointsPopup");
     }
 
+    ~Priv ()
+    {
+        refresh_scheduler.unregister_view (*tree_view);
+    }
+
     void
     build_tree_view ()
     {
@@ -216,19 +227,6 @@ public:
         tree_view->signal_key_press_event ().connect
             (sigc::mem_fun
              (*this, &Priv::on_key_press_event));
-        tree_view->signal_draw ().connect_notify
-            (sigc::mem_fun
-             (*this, &Priv::on_draw_signal));
-    }
-
-    bool
-    should_process_now ()
-    {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-        THROW_IF_FAIL (tree_view);
-        bool is_visible = tree_view->get_is_drawable ();
-        LOG_DD ("is visible: " << is_visible);
-        return is_visible;
     }
 
     /// If a_bp is a breakpoint already present in the tree model,
@@ -530,11 +528,7 @@ public:
             || a_reason == IDebugger::WATCHPOINT_TRIGGER
             || a_reason == IDebugger::READ_WATCHPOINT_TRIGGER
             || a_reason == IDebugger::ACCESS_WATCHPOINT_TRIGGER) {
-            if (should_process_now ()) {
-                finish_handling_debugger_stopped_event ();
-            } else {
-                is_up2date = false;
-            }
+            refresh_scheduler.invalidate (*tree_view);
         } else if (a_reason == IDebugger::WATCHPOINT_SCOPE) {
             LOG_DD ("erase watchpoint num: " << a_bkpt_num);
             erase_breakpoint (a_bkpt_num);
@@ -691,18 +685,6 @@ public:
         }
     }
 
-    void
-    on_draw_signal (const Cairo::RefPtr<Cairo::Context> &)
-    {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-        NEMIVER_TRY
-        if (!is_up2date) {
-            finish_handling_debugger_stopped_event ();
-            is_up2date = true;
-        }
-        NEMIVER_CATCH
-    }
-
     bool 
     on_key_press_event (GdkEventKey* event)
     {
@@ -808,9 +790,11 @@ public:
 
 BreakpointsView::BreakpointsView (IWorkbench& a_workbench,
                                   IPerspective& a_perspective,
-                                  IDebuggerSafePtr& a_debugger)
+                                  IDebuggerSafePtr& a_debugger,
+                                  RefreshScheduler &a_refresh_scheduler)
 {
-    m_priv.reset (new Priv (a_workbench, a_perspective, a_debugger));
+    m_priv.reset (new Priv (a_workbench, a_perspective, a_debugger,
+                            a_refresh_scheduler));
 }
 
 BreakpointsView::~BreakpointsView ()
@@ -39,6 +39,7 @@ NEMIVER_BEGIN_NAMESPACE (nemiver)
 
 class IWorkbench;
 class IPerspective;
+class RefreshScheduler;
 
 class NEMIVER_API BreakpointsView : public nemiver::common::Object {
     //non copyable
@@ -52,7 +53,8 @@ public:
 
     BreakpointsView (IWorkbench& a_workbench,
                      IPerspective& a_perspective,
-                     IDebuggerSafePtr& a_debugger);
+                     IDebuggerSafePtr& a_debugger,
+                     RefreshScheduler &a_refresh_scheduler);
     virtual ~BreakpointsView ();
     Gtk::Widget& widget () const;
     void set_breakpoints
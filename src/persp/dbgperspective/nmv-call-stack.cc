@@ -30,6 +30,7 @@
 #include <glib/gi18n.h>
 #include "common/nmv-exception.h"
 #include "nmv-call-stack.h"
+#include "nmv-refresh-scheduler.h"
 #include "nmv-ui-utils.h"
 #include "nmv-i-workbench.h"
 #include "nmv-i-perspective.h"
@@ -126,11 +127,12 @@ struct CallStack::Priv {
     int frame_high;
     bool waiting_for_stack_args;
     bool in_set_cur_frame_trans;
-    bool is_up2date;
+    RefreshScheduler &refresh_scheduler;
 
     Priv (IDebuggerSafePtr a_dbg,
           IWorkbench& a_workbench,
-          IPerspective& a_perspective) :
+          IPerspective& a_perspective,
+          RefreshScheduler &a_refresh_scheduler) :
         debugger (a_dbg),
         conf_mgr (0),
         workbench (a_workbench),
@@ -142,13 +144,19 @@ struct CallStack::Priv {
         frame_high (nb_frames_expansion_chunk),
         waiting_for_stack_args (false),
         in_set_cur_frame_trans (false),
-        is_up2date (true)
+        refresh_scheduler (a_refresh_scheduler)
     {
         connect_debugger_signals ();
         init_actions ();
         init_conf ();
     }
 
+    ~Priv ()
+    {
+        if (widget)
+            refresh_scheduler.unregister_view (*widget);
+    }
+
     void
     init_conf ()
     {
@@ -202,16 +210,6 @@ struct CallStack::Priv {
                                                 (call_stack_action_group);
     }
 
-    bool
-    should_process_now ()
-    {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-        THROW_IF_FAIL (widget);
-        bool is_visible = widget->get_is_drawable ();
-        LOG_DD ("is visible: " << is_visible);
-        return is_visible;
-    }
-
     Gtk::Widget*
     get_call_stack_menu ()
     {
@@ -285,11 +283,8 @@ struct CallStack::Priv {
             frame_high = nb_frames_expansion_chunk;
         }
 
-        if (should_process_now ()) {
-            finish_update_handling ();
-        } else {
-            is_up2date = false;
-        }
+        THROW_IF_FAIL (widget);
+        refresh_scheduler.invalidate (*widget);
     }
 
     void 
@@ -456,19 +451,6 @@ struct CallStack::Priv {
         NEMIVER_CATCH
     }
 
-    void
-    on_draw_signal (const Cairo::RefPtr<Cairo::Context> &)
-    {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-
-        NEMIVER_TRY
-        if (!is_up2date) {
-            finish_update_handling ();
-            is_up2date = true;
-        }
-        NEMIVER_CATCH
-    }
-
     void
     on_config_value_changed_signal (const UString &a_key,
                                     const UString &a_namespace)
@@ -633,8 +615,9 @@ struct CallStack::Priv {
                          (sigc::mem_fun (*this,
                                          &CallStack::Priv::on_row_activated_signal))));
 
-        tree_view->signal_draw ().connect_notify
-            (sigc::mem_fun (this, &Priv::on_draw_signal));
+        refresh_scheduler.register_view
+            (*tree_view, RefreshScheduler::MODERATE_REFRESH,
+             sigc::mem_fun (*this, &Priv::finish_update_handling));
 
         tree_view->add_events (Gdk::EXPOSURE_MASK);
 
@@ -877,10 +860,12 @@ struct CallStack::Priv {
 
 CallStack::CallStack (IDebuggerSafePtr &a_debugger,
                       IWorkbench& a_workbench,
-                      IPerspective &a_perspective)
+                      IPerspective &a_perspective,
+                      RefreshScheduler &a_refresh_scheduler)
 {
     THROW_IF_FAIL (a_debugger);
-    m_priv.reset (new Priv (a_debugger, a_workbench, a_perspective));
+    m_priv.reset (new Priv (a_debugger, a_workbench, a_perspective,
+                            a_refresh_scheduler));
 }
 
 CallStack::~CallStack ()
@@ -41,6 +41,7 @@ NEMIVER_BEGIN_NAMESPACE (nemiver)
 
 class IWorkbench;
 class IPerspective;
+class RefreshScheduler;
 
 class NEMIVER_API CallStack : public Object {
     //non copyable
@@ -57,7 +58,8 @@ protected:
 public:
 
     CallStack (IDebuggerSafePtr &a_debugger, IWorkbench& a_workbench,
-            IPerspective& a_perspective);
+            IPerspective& a_perspective,
+            RefreshScheduler &a_refresh_scheduler);
     virtual ~CallStack ();
     bool is_empty ();
     const vector<IDebugger::Frame>& frames () const;
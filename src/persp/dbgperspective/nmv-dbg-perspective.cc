@@ -82,6 +82,7 @@
 #include "nmv-choose-overloads-dialog.h"
 #include "nmv-remote-target-dialog.h"
 #include "nmv-registers-view.h"
+#include "nmv-refresh-scheduler.h"
 #include "nmv-call-function-dialog.h"
 #include "nmv-conf-keys.h"
 #ifdef WITH_MEMORYVIEW
@@ -417,6 +418,7 @@ private:
     void on_popup_tip_hide ();
 
     bool on_file_content_changed (const UString &a_path);
+    void on_file_loaded_signal (bool a_ok, const UString &a_path);
     void on_notebook_tabs_reordered(Gtk::Widget* a_page, guint a_page_num);
 
     void on_layout_changed ();
@@ -869,6 +871,9 @@ struct DBGPerspective::Priv {
     list<UString> session_search_paths;
     list<UString> global_search_paths;
     map<UString, bool> paths_to_ignore;
+    // Must be declared before the views registered to it, so that it
+    // outlives them.
+    RefreshScheduler refresh_scheduler;
     SafePtr<CallStack> call_stack;
     SafePtr<Gtk::ScrolledWindow> call_stack_scrolled_win;
     SafePtr<Gtk::ScrolledWindow> thread_list_scrolled_win;
@@ -881,6 +886,7 @@ struct DBGPerspective::Priv {
     Glib::RefPtr<Gtk::ActionGroup> opened_file_action_group;
     Glib::RefPtr<Gtk::ActionGroup> debugger_ready_action_group;
     Glib::RefPtr<Gtk::ActionGroup> debugger_busy_action_group;
+    Glib::RefPtr<Gtk::ActionGroup> step_action_group;
     Glib::RefPtr<Gtk::UIManager> ui_manager;
     Glib::RefPtr<Gtk::IconFactory> icon_factory;
     Gtk::UIManager::ui_merge_id menubar_merge_id;
@@ -1093,14 +1099,16 @@ struct DBGPerspective::Priv {
 
     bool
     load_file (const UString &a_path,
-               Glib::RefPtr<Gsv::Buffer> &a_buffer)
+               Glib::RefPtr<Gsv::Buffer> &a_buffer,
+               const sigc::slot<void, bool> &a_loaded_slot =
+                                            sigc::slot<void, bool> ())
     {
         list<string> supported_encodings;
         get_supported_encodings (supported_encodings);
         return SourceEditor::load_file (workbench->get_root_window (),
                                         a_path, supported_encodings,
                                         enable_syntax_highlight,
-                                        a_buffer);
+                                        a_buffer, a_loaded_slot);
     }
 
     bool
@@ -2332,9 +2340,13 @@ DBGPerspective::on_debugger_detached_from_target_signal ()
     //***************************
     THROW_IF_FAIL (m_priv);
     m_priv->debugger_ready_action_group->set_sensitive (false);
+    m_priv->step_action_group->set_sensitive (false);
     m_priv->debugger_busy_action_group->set_sensitive (false);
     m_priv->inferior_loaded_action_group->set_sensitive (false);
 
+    // No stop will come to release the refreshes held while stepping.
+    m_priv->refresh_scheduler.release_refreshes ();
+
     NEMIVER_CATCH
 }
 
@@ -2472,13 +2484,26 @@ DBGPerspective::on_debugger_stopped_signal (IDebugger::StopReason a_reason,
 
     THROW_IF_FAIL (m_priv);
 
-    if (IDebugger::is_exited (a_reason))
+    if (IDebugger::is_exited (a_reason)) {
+        m_priv->refresh_scheduler.release_refreshes ();
         return;
+    }
 
     update_src_dependant_bp_actions_sensitiveness ();
     m_priv->current_frame = a_frame;
     m_priv->current_thread_id = a_thread_id;
 
+    // While the inferior is stepped repeatedly, e.g. because a step
+    // key is held down, only the where marker moves at each stop.
+    // The views are refreshed once, at the last stop.
+    if (debugger ()->has_pending_steps ()) {
+        m_priv->refresh_scheduler.hold_refreshes ();
+    } else if (m_priv->refresh_scheduler.refreshes_held ()) {
+        m_priv->refresh_scheduler.release_refreshes ();
+        LOG_DD ("view refreshes skipped while stepping so far: "
+                << m_priv->refresh_scheduler.nb_skipped_refreshes ());
+    }
+
     set_where (a_frame, /*do_scroll=*/true, /*try_hard=*/true);
 
     if (m_priv->debugger_has_just_run) {
@@ -2513,6 +2538,8 @@ DBGPerspective::on_program_finished_signal ()
     //call stack
     //**********************
     clear_status_notebook (true);
+
+    m_priv->refresh_scheduler.release_refreshes ();
     NEMIVER_CATCH
 }
 
@@ -2524,9 +2551,12 @@ DBGPerspective::on_engine_died_signal ()
     m_priv->debugger_engine_alive = false;
 
     m_priv->debugger_ready_action_group->set_sensitive (false);
+    m_priv->step_action_group->set_sensitive (false);
     m_priv->debugger_busy_action_group->set_sensitive (false);
     m_priv->inferior_loaded_action_group->set_sensitive (false);
 
+    m_priv->refresh_scheduler.release_refreshes ();
+
     ui_utils::display_info (workbench ().get_root_window (),
                             _("The underlying debugger engine process died."));
 
@@ -2665,6 +2695,14 @@ DBGPerspective::on_debugger_state_changed_signal (IDebugger::State a_state)
 
     update_action_group_sensitivity (a_state);
 
+    // The debugger gets ready without stopping when a step fails.
+    // Release the refreshes held while stepping, unless more steps
+    // are coming.
+    if (a_state == IDebugger::READY
+        && m_priv->refresh_scheduler.refreshes_held ()
+        && !debugger ()->has_pending_steps ())
+        m_priv->refresh_scheduler.release_refreshes ();
+
     NEMIVER_CATCH
 }
 
@@ -2796,6 +2834,20 @@ DBGPerspective::on_popup_tip_hide ()
     NEMIVER_CATCH
 }
 
+/// Close the editor of a file that could not be loaded.  Big files
+/// are loaded in the background, so that is only known after their
+/// editor is opened.
+void
+DBGPerspective::on_file_loaded_signal (bool a_ok, const UString &a_path)
+{
+    NEMIVER_TRY
+
+    if (!a_ok)
+        close_file (a_path);
+
+    NEMIVER_CATCH
+}
+
 bool
 DBGPerspective::on_file_content_changed (const UString &a_path)
 {
@@ -3008,6 +3060,7 @@ DBGPerspective::update_action_group_sensitivity (IDebugger::State a_state)
     THROW_IF_FAIL (m_priv);
     THROW_IF_FAIL (m_priv->debugger_ready_action_group);
     THROW_IF_FAIL (m_priv->debugger_busy_action_group);
+    THROW_IF_FAIL (m_priv->step_action_group);
     THROW_IF_FAIL (m_priv->throbber);
 
     if (a_state == IDebugger::NOT_STARTED) {
@@ -3019,6 +3072,7 @@ DBGPerspective::update_action_group_sensitivity (IDebugger::State a_state)
         m_priv->inferior_loaded_action_group->set_sensitive (false);
         m_priv->debugger_busy_action_group->set_sensitive (false);
         m_priv->debugger_ready_action_group->set_sensitive (false);
+        m_priv->step_action_group->set_sensitive (false);
         if (get_num_notebook_pages ()) {
             close_opened_files ();
         }
@@ -3029,6 +3083,7 @@ DBGPerspective::update_action_group_sensitivity (IDebugger::State a_state)
         m_priv->inferior_loaded_action_group->set_sensitive (true);
         m_priv->debugger_busy_action_group->set_sensitive (false);
         m_priv->debugger_ready_action_group->set_sensitive (false);
+        m_priv->step_action_group->set_sensitive (false);
         m_priv->throbber->stop ();
     } else if (a_state == IDebugger::READY) {
         m_priv->throbber->stop ();
@@ -3037,11 +3092,14 @@ DBGPerspective::update_action_group_sensitivity (IDebugger::State a_state)
         m_priv->detach_action_group->set_sensitive (true);
         m_priv->inferior_loaded_action_group->set_sensitive (true);
         m_priv->debugger_ready_action_group->set_sensitive (true);
+        m_priv->step_action_group->set_sensitive (true);
         m_priv->debugger_busy_action_group->set_sensitive (false);
     } else if (a_state == IDebugger::RUNNING){
         m_priv->detach_action_group->set_sensitive (true);
         m_priv->inferior_loaded_action_group->set_sensitive (false);
         m_priv->debugger_ready_action_group->set_sensitive (false);
+        m_priv->step_action_group->set_sensitive
+            (debugger ()->has_pending_steps ());
         m_priv->debugger_busy_action_group->set_sensitive (true);
     } else if (a_state == IDebugger::PROGRAM_EXITED) {
         m_priv->throbber->stop ();
@@ -3049,6 +3107,7 @@ DBGPerspective::update_action_group_sensitivity (IDebugger::State a_state)
         workbench ().get_root_window ().get_window ()->set_cursor ();
         m_priv->inferior_loaded_action_group->set_sensitive (true);
         m_priv->debugger_ready_action_group->set_sensitive (false);
+        m_priv->step_action_group->set_sensitive (false);
         m_priv->debugger_busy_action_group->set_sensitive (false);
     }
 }
@@ -3302,7 +3361,10 @@ DBGPerspective::init_actions ()
     };
 
 
-    static ui_utils::ActionEntry s_debugger_ready_action_entries [] = {
+    // The step actions stay sensitive while the inferior is being
+    // stepped, so that the steps requested in the meantime, e.g. by
+    // holding a step key down, are queued.
+    static ui_utils::ActionEntry s_step_action_entries [] = {
         {
             "NextMenuItemAction",
             nemiver::STOCK_STEP_OVER,
@@ -3352,7 +3414,10 @@ DBGPerspective::init_actions ()
             ActionEntry::DEFAULT,
             "<control>N",
             false
-        },
+        }
+    };
+
+    static ui_utils::ActionEntry s_debugger_ready_action_entries [] = {
         {
             "ContinueMenuItemAction",
             Gtk::Stock::EXECUTE,
@@ -3729,6 +3794,10 @@ DBGPerspective::init_actions ()
                 Gtk::ActionGroup::create ("debugger-busy-action-group");
     m_priv->debugger_busy_action_group->set_sensitive (false);
 
+    m_priv->step_action_group =
+                Gtk::ActionGroup::create ("step-action-group");
+    m_priv->step_action_group->set_sensitive (false);
+
     m_priv->default_action_group =
                 Gtk::ActionGroup::create ("debugger-default-action-group");
     m_priv->default_action_group->set_sensitive (true);
@@ -3759,6 +3828,11 @@ DBGPerspective::init_actions ()
                          G_N_ELEMENTS (s_debugger_busy_action_entries),
                          m_priv->debugger_busy_action_group);
 
+    ui_utils::add_action_entries_to_action_group
+                        (s_step_action_entries,
+                         G_N_ELEMENTS (s_step_action_entries),
+                         m_priv->step_action_group);
+
     ui_utils::add_action_entries_to_action_group
                         (s_default_action_entries,
                          G_N_ELEMENTS (s_default_action_entries),
@@ -3777,6 +3851,8 @@ DBGPerspective::init_actions ()
                                     (m_priv->debugger_busy_action_group);
     workbench ().get_ui_manager ()->insert_action_group
                                     (m_priv->debugger_ready_action_group);
+    workbench ().get_ui_manager ()->insert_action_group
+                                    (m_priv->step_action_group);
     workbench ().get_ui_manager ()->insert_action_group
                                     (m_priv->default_action_group);
     workbench ().get_ui_manager ()->insert_action_group
@@ -4756,7 +4832,8 @@ DBGPerspective::get_thread_list ()
     THROW_IF_FAIL (m_priv);
     THROW_IF_FAIL (debugger ());
     if (!m_priv->thread_list) {
-        m_priv->thread_list.reset  (new ThreadList (debugger ()));
+        m_priv->thread_list.reset  (new ThreadList (debugger (),
+                                                    m_priv->refresh_scheduler));
     }
     THROW_IF_FAIL (m_priv->thread_list);
     return *m_priv->thread_list;
@@ -5491,7 +5568,11 @@ DBGPerspective::open_file_real (const UString &a_path,
     NEMIVER_TRY
 
     Glib::RefPtr<Gsv::Buffer> source_buffer;
-    if (!m_priv->load_file (a_path, source_buffer))
+    if (!m_priv->load_file (a_path, source_buffer,
+                            sigc::bind
+                            (sigc::mem_fun
+                             (*this, &DBGPerspective::on_file_loaded_signal),
+                             a_path)))
         return 0;
 
     source_editor = create_source_editor (source_buffer,
@@ -5850,7 +5931,11 @@ DBGPerspective::reload_file (const UString &a_path)
     int current_line = editor->current_line ();
     int current_column = editor->current_column ();
 
-    if (!m_priv->load_file (a_path, buffer))
+    if (!m_priv->load_file (a_path, buffer,
+                            sigc::bind
+                            (sigc::mem_fun
+                             (*this, &DBGPerspective::on_file_loaded_signal),
+                             a_path)))
         return false;
     editor->register_non_assembly_source_buffer (buffer);
     editor->current_line (current_line);
@@ -8279,7 +8364,8 @@ DBGPerspective::get_call_stack ()
     THROW_IF_FAIL (m_priv);
     if (!m_priv->call_stack) {
         m_priv->call_stack.reset (new CallStack (debugger (),
-                                                 workbench (), *this));
+                                                 workbench (), *this,
+                                                 m_priv->refresh_scheduler));
         THROW_IF_FAIL (m_priv);
     }
     return *m_priv->call_stack;
@@ -8344,7 +8430,8 @@ DBGPerspective::get_local_vars_inspector ()
         m_priv->variables_editor.reset
             (new LocalVarsInspector (debugger (),
                                      *m_priv->workbench,
-                                     *this));
+                                     *this,
+                                     m_priv->refresh_scheduler));
     }
     THROW_IF_FAIL (m_priv->variables_editor);
     return *m_priv->variables_editor;
@@ -8438,7 +8525,8 @@ DBGPerspective::get_breakpoints_view ()
     THROW_IF_FAIL (m_priv);
     if (!m_priv->breakpoints_view) {
         m_priv->breakpoints_view.reset (new BreakpointsView (
-                    workbench (), *this, debugger ()));
+                    workbench (), *this, debugger (),
+                    m_priv->refresh_scheduler));
     }
     THROW_IF_FAIL (m_priv->breakpoints_view);
     return *m_priv->breakpoints_view;
@@ -8477,7 +8565,9 @@ DBGPerspective::get_registers_view ()
 {
     THROW_IF_FAIL (m_priv);
     if (!m_priv->registers_view) {
-        m_priv->registers_view.reset (new RegistersView (debugger ()));
+        m_priv->registers_view.reset (new RegistersView
+                                            (debugger (),
+                                             m_priv->refresh_scheduler));
     }
     THROW_IF_FAIL (m_priv->registers_view);
     return *m_priv->registers_view;
@@ -8489,7 +8579,9 @@ DBGPerspective::get_memory_view ()
 {
     THROW_IF_FAIL (m_priv);
     if (!m_priv->memory_view) {
-        m_priv->memory_view.reset (new MemoryView (debugger ()));
+        m_priv->memory_view.reset (new MemoryView
+                                            (debugger (),
+                                             m_priv->refresh_scheduler));
     }
     THROW_IF_FAIL (m_priv->memory_view);
     return *m_priv->memory_view;
@@ -8504,7 +8596,8 @@ DBGPerspective::get_expr_monitor_view ()
 
     if (!m_priv->expr_monitor)
         m_priv->expr_monitor.reset (new ExprMonitor (*debugger (),
-                                                     *this));
+                                                     *this,
+                                                     m_priv->refresh_scheduler));
     THROW_IF_FAIL (m_priv->expr_monitor);
     return *m_priv->expr_monitor;
 }
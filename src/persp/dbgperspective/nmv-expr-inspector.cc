@@ -106,6 +106,11 @@ class ExprInspector::Priv : public sigc::trackable {
         tree_view->signal_row_expanded ().connect
             (sigc::mem_fun (*this, &Priv::on_tree_view_row_expanded_signal));
 
+        tree_view->more_children_requested_signal ().connect
+            (sigc::bind (sigc::mem_fun (*tree_view,
+                                        &VarsTreeView::unfold_more_children),
+                         sigc::ref (debugger)));
+
         tree_view->signal_button_press_event ().connect_notify
             (sigc::mem_fun (this, &Priv::on_button_press_signal));
 
@@ -364,6 +369,9 @@ class ExprInspector::Priv : public sigc::trackable {
                                             ("varobjwalker", "IVarWalker");
         result->visited_variable_signal ().connect
             (sigc::mem_fun (*this, &Priv::on_visited_expression_signal));
+        // Children past the first page are not fetched; the copied
+        // text marks them with "..." (see dutil::dump_variable_value).
+        result->set_maximum_number_of_children (vutil::CHILDREN_PAGE_SIZE);
         return result;
     }
 
@@ -481,9 +489,10 @@ class ExprInspector::Priv : public sigc::trackable {
         IDebugger::VariableSafePtr var =
             (*a_row_it)[vutil::get_variable_columns ().variable];
         debugger.unfold_variable
-        (var, sigc::bind (sigc::mem_fun (*this,
-                                         &Priv::on_expression_unfolded_signal),
-                          a_row_path));
+        (var, 0, vutil::CHILDREN_PAGE_SIZE,
+         sigc::bind (sigc::mem_fun (*this,
+                                    &Priv::on_expression_unfolded_signal),
+                     a_row_path));
         LOG_DD ("variable unfolding triggered");
 
         NEMIVER_CATCH
@@ -32,6 +32,7 @@
 #include "nmv-debugger-utils.h"
 #include "nmv-i-workbench.h"
 #include "nmv-expr-inspector-dialog.h"
+#include "nmv-refresh-scheduler.h"
 
 using namespace nemiver::common;
 namespace vutils = nemiver::variables_utils2;
@@ -46,6 +47,7 @@ struct ExprMonitor::Priv
     Glib::RefPtr<Gtk::UIManager> ui_manager;
     IDebugger &debugger;
     IPerspective &perspective;
+    RefreshScheduler &refresh_scheduler;
     SafePtr<VarsTreeView> tree_view;
     Glib::RefPtr<Gtk::TreeStore> tree_store;
     SafePtr<Gtk::TreeRowReference> in_scope_exprs_row_ref;
@@ -67,18 +69,18 @@ struct ExprMonitor::Priv
     bool saved_has_frame;
     bool initialized;
     bool is_new_frame;
-    bool is_up2date;
 
     Priv (IDebugger &a_debugger,
-          IPerspective &a_perspective)
+          IPerspective &a_perspective,
+          RefreshScheduler &a_refresh_scheduler)
         : debugger (a_debugger),
           perspective (a_perspective),
+          refresh_scheduler (a_refresh_scheduler),
           contextual_menu (0),
           saved_reason (IDebugger::UNDEFINED_REASON),
           saved_has_frame (false),
           initialized (false),
-          is_new_frame (true),
-          is_up2date (true)
+          is_new_frame (true)
     {
         // The widget is built lazily when somone requests it from
         // the outside.
@@ -142,10 +144,19 @@ struct ExprMonitor::Priv
         connect_to_debugger_signal ();
         init_graphical_signals ();
         init_actions ();
+        refresh_scheduler.register_view
+            (*tree_view, RefreshScheduler::EXPENSIVE_REFRESH,
+             sigc::mem_fun (*this, &Priv::refresh_saved_frame));
 
         initialized = true;
     }
 
+    ~Priv ()
+    {
+        if (initialized)
+            refresh_scheduler.unregister_view (*tree_view);
+    }
+
     /// Re-initialize the widget.
     void
     re_init_widget (bool a_remember_variables)
@@ -208,8 +219,10 @@ struct ExprMonitor::Priv
         tree_view->signal_row_expanded ().connect
             (sigc::mem_fun (*this, &Priv::on_tree_view_row_expanded_signal));
 
-        tree_view->signal_draw ().connect_notify
-            (sigc::mem_fun (this, &Priv::on_draw_signal));
+        tree_view->more_children_requested_signal ().connect
+            (sigc::bind (sigc::mem_fun (*tree_view,
+                                        &VarsTreeView::unfold_more_children),
+                         sigc::ref (debugger)));
 
         // Schedule the button press signal handler to be run before
         // the default handler.
@@ -723,20 +736,6 @@ struct ExprMonitor::Priv
         clear_exprs_changed_at_prev_step ();
     }
 
-    /// Return true iff we need to graphically update the current
-    /// view.  Basically, the widget is not visible, this function
-    /// returns false.
-    bool
-    should_process_now () const
-    {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-
-        THROW_IF_FAIL (tree_view);
-        bool is_visible = tree_view->get_is_drawable ();
-        LOG_DD ("is visible: " << is_visible);
-        return is_visible;
-    }
-
     /// This does what needs to do whenever the widget becomes visible
     /// and we need to update its rendering after the inferior has
     /// stopped.
@@ -747,6 +746,16 @@ struct ExprMonitor::Priv
     /// handy.
     ///
     /// \param a_frame the frame we have, if a_has_frame is non-null.
+    /// Update the rendering of the widget with the state saved at
+    /// the last stop.  This is the slot the refresh scheduler calls.
+    void
+    refresh_saved_frame ()
+    {
+        finish_handling_debugger_stopped_event (saved_reason,
+                                                saved_has_frame,
+                                                saved_frame);
+    }
+
     void
     finish_handling_debugger_stopped_event (IDebugger::StopReason a_reason,
                                             bool a_has_frame,
@@ -780,11 +789,10 @@ struct ExprMonitor::Priv
         for (it = monitored_expressions.begin ();
              it != monitored_expressions.end ();
              ++it) {
-            debugger.list_changed_variables (*it,
-                                             sigc::bind
-                                             (sigc::mem_fun
-                                              (*this, &Priv::on_vars_changed),
-                                              *it));
+            debugger.list_changed_variables_of_all
+                (*it,
+                 sigc::bind (sigc::mem_fun (*this, &Priv::on_vars_changed),
+                             *it));
         }
 
         // Walk the killed expressions and try to re-monitor them.
@@ -916,13 +924,8 @@ struct ExprMonitor::Priv
         saved_reason = a_reason;
         saved_has_frame = a_has_frame;
 
-        if (should_process_now ()) {
-            finish_handling_debugger_stopped_event (a_reason,
-                                                    a_has_frame,
-                                                    a_frame);
-        } else {
-            is_up2date = false;
-        }
+        THROW_IF_FAIL (tree_view);
+        refresh_scheduler.invalidate (*tree_view);
         NEMIVER_CATCH;
     }
 
@@ -1049,7 +1052,7 @@ struct ExprMonitor::Priv
         IDebugger::VariableSafePtr var =
             (*a_it)[vutils::get_variable_columns ().variable];
         debugger.unfold_variable
-            (var,
+            (var, 0, vutils::CHILDREN_PAGE_SIZE,
              sigc::bind  (sigc::mem_fun (*this,
                                          &Priv::on_variable_unfolded_signal),
                           a_path));
@@ -1082,22 +1085,6 @@ struct ExprMonitor::Priv
         NEMIVER_CATCH;
     }
 
-    /// Invoked whenever the current view (widget) is drawn on
-    /// screen.  That is, when it becomes visible.
-    void
-    on_draw_signal (const Cairo::RefPtr<Cairo::Context> &)
-    {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-        NEMIVER_TRY;
-        if (!is_up2date) {
-            finish_handling_debugger_stopped_event (saved_reason,
-                                                    saved_has_frame,
-                                                    saved_frame);
-            is_up2date = true;
-        }
-        NEMIVER_CATCH;
-    }
-
     /// Callback function called whenever the user presses button from
     /// either the keyboard or the mousse.
     void
@@ -1236,9 +1223,10 @@ struct ExprMonitor::Priv
 }; // end struct ExprMonitor
 
 ExprMonitor::ExprMonitor (IDebugger &a_dbg,
-                          IPerspective &a_perspective)
+                          IPerspective &a_perspective,
+                          RefreshScheduler &a_refresh_scheduler)
 {
-    m_priv.reset (new Priv (a_dbg, a_perspective));
+    m_priv.reset (new Priv (a_dbg, a_perspective, a_refresh_scheduler));
 }
 
 ExprMonitor::~ExprMonitor ()
@@ -32,6 +32,8 @@
 
 NEMIVER_BEGIN_NAMESPACE (nemiver)
 
+class RefreshScheduler;
+
 /// \brief A widget that can monitor the state of a given set of
 /// variables.
 ///
@@ -52,7 +54,8 @@ class NEMIVER_API ExprMonitor : public nemiver::common::Object {
 
  public:
     ExprMonitor (IDebugger &a_dbg,
-                 IPerspective &a_perspective);
+                 IPerspective &a_perspective,
+                 RefreshScheduler &a_refresh_scheduler);
     virtual ~ExprMonitor ();
     Gtk::Widget& widget ();
     void add_expression (const IDebugger::VariableSafePtr a_expr);
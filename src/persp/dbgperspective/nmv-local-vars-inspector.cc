@@ -31,6 +31,7 @@
 #include <gtkmm/treerowreference.h>
 #include "common/nmv-exception.h"
 #include "nmv-local-vars-inspector.h"
+#include "nmv-refresh-scheduler.h"
 #include "nmv-variables-utils.h"
 #include "nmv-ui-utils.h"
 #include "nmv-i-workbench.h"
@@ -62,11 +63,20 @@ public:
     IDebugger::VariableList function_arguments;
     UString previous_function_name;
     Glib::RefPtr<Gtk::ActionGroup> local_vars_inspector_action_group;
+    RefreshScheduler &refresh_scheduler;
     bool is_new_frame;
-    bool is_up2date;
     IDebugger::StopReason saved_reason;
     bool saved_has_frame;
     IDebugger::Frame saved_frame;
+    // The frame whose variables are displayed, its thread and its
+    // depth, as reported by IDebugger::get_pooled_frame_variables.
+    // The depth is -1 until the variables of the frame are listed.
+    IDebugger::Frame displayed_frame;
+    int displayed_thread_id;
+    int displayed_frame_depth;
+    // Identifies the last request of pooled variables, so that the
+    // answers to the previous ones can be ignored.
+    unsigned pooled_variables_request;
     // The list of variables that changed at the previous stop
     // Those were probably highlighted in red.
     // We need to keep track of them
@@ -81,14 +91,18 @@ public:
 
     Priv (IDebuggerSafePtr &a_debugger,
           IWorkbench &a_workbench,
-          IPerspective& a_perspective) :
+          IPerspective& a_perspective,
+          RefreshScheduler &a_refresh_scheduler) :
         workbench (a_workbench),
         perspective (a_perspective),
         tree_view (Gtk::manage (VarsTreeView::create ())),
+        refresh_scheduler (a_refresh_scheduler),
         is_new_frame (false),
-        is_up2date (true),
         saved_reason (IDebugger::UNDEFINED_REASON),
         saved_has_frame (false),
+        displayed_thread_id (0),
+        displayed_frame_depth (-1),
+        pooled_variables_request (0),
         local_vars_inspector_menu (0),
         varobj_walker (0),
         module_manager (0)
@@ -103,6 +117,14 @@ public:
         connect_to_debugger_signals ();
         init_graphical_signals ();
         init_actions ();
+        refresh_scheduler.register_view
+            (*tree_view, RefreshScheduler::EXPENSIVE_REFRESH,
+             sigc::mem_fun (*this, &Priv::refresh_saved_frame));
+    }
+
+    ~Priv ()
+    {
+        refresh_scheduler.unregister_view (*tree_view);
     }
 
     void
@@ -116,6 +138,7 @@ public:
         tree_store->clear ();
         previous_function_name = "";
         is_new_frame = true;
+        displayed_frame_depth = -1;
 
         //****************************************************
         //add two rows: local variables and function arguments,
@@ -151,16 +174,6 @@ public:
         return true;
     }
 
-    bool
-    should_process_now ()
-    {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-        THROW_IF_FAIL (tree_view);
-        bool is_visible = tree_view->get_is_drawable ();
-        LOG_DD ("is visible: " << is_visible);
-        return is_visible;
-    }
-
     bool
     is_function_arguments_subtree_empty () const
     {
@@ -230,12 +243,14 @@ public:
         tree_view->signal_row_activated ().connect
             (sigc::mem_fun (*this,
                             &Priv::on_tree_view_row_activated_signal));
+        tree_view->more_children_requested_signal ().connect
+            (sigc::bind (sigc::mem_fun (*tree_view,
+                                        &VarsTreeView::unfold_more_children),
+                         sigc::ref (*debugger)));
         // Schedule the button press signal handler to be run before
         // the default handler.
         tree_view->signal_button_press_event ().connect_notify
             (sigc::mem_fun (this, &Priv::on_button_press_signal));
-        tree_view->signal_draw ().connect_notify
-            (sigc::mem_fun (this, &Priv::on_draw_signal));
 
         Gtk::CellRenderer *r = tree_view->get_column_cell_renderer
             (VarsTreeView::VARIABLE_VALUE_COLUMN_INDEX);
@@ -345,7 +360,7 @@ public:
         if (get_local_variables_row_iterator (row_it)) {
             Gtk::TreeModel::Children rows = row_it->children ();
             for (row_it = rows.begin (); row_it != rows.end ();) {
-                row_it = tree_store->erase (row_it);
+                row_it = vutil::erase_variable_row (tree_store, row_it);
             }
         }
         local_vars.clear ();
@@ -362,7 +377,7 @@ public:
         if (get_function_arguments_row_iterator (row_it)) {
             Gtk::TreeModel::Children rows = row_it->children ();
             for (row_it = rows.begin (); row_it != rows.end ();) {
-                row_it = tree_store->erase (*row_it);
+                row_it = vutil::erase_variable_row (tree_store, row_it);
             }
         }
         function_arguments.clear ();
@@ -557,18 +572,7 @@ public:
         saved_frame = a_frame;
 
         if (is_new_frame || inspector_is_empty ()) {
-            LOG_DD ("init tree view");
-            re_init_tree_view ();
-            LOG_DD ("list local variables");
-            debugger->list_local_variables
-                (sigc::mem_fun
-                 (*this, &Priv::add_new_local_vars_and_update_olders));
-            LOG_DD ("list frames arguments");
-            debugger->list_frames_arguments (a_frame.level (),
-                                             a_frame.level (),
-                                             sigc::mem_fun
-                                             (*this, &Priv::on_function_args_listed),
-                                             "");
+            show_variables_of_saved_frame ();
         } else {
             LOG_DD ("update local variables and function arguments");
             maybe_update_list_of_local_vars_and_then_update_older_ones ();
@@ -579,6 +583,83 @@ public:
         NEMIVER_CATCH
     }
 
+    /// Give the variables of the frame that is displayed to the
+    /// debugger engine, which keeps them for a while in case the
+    /// frame is displayed again.
+    void
+    pool_variables_of_displayed_frame ()
+    {
+        LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+        if (displayed_frame_depth < 0)
+            return;
+        debugger->pool_frame_variables (displayed_thread_id,
+                                        displayed_frame,
+                                        displayed_frame_depth,
+                                        local_vars,
+                                        function_arguments);
+        displayed_frame_depth = -1;
+    }
+
+    /// Refresh the inspector with the state saved at the last stop.
+    /// This is the slot the refresh scheduler calls.
+    void
+    refresh_saved_frame ()
+    {
+        finish_handling_debugger_stopped_event (saved_reason,
+                                                saved_has_frame,
+                                                saved_frame);
+    }
+
+    /// Display the variables of saved_frame, reusing the variables
+    /// the debugger engine pooled for that frame, if any.
+    void
+    show_variables_of_saved_frame ()
+    {
+        LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+        pool_variables_of_displayed_frame ();
+        LOG_DD ("init tree view");
+        re_init_tree_view ();
+        debugger->get_pooled_frame_variables
+            (saved_frame,
+             sigc::bind (sigc::mem_fun (*this,
+                                        &Priv::on_pooled_frame_variables),
+                         saved_frame,
+                         ++pooled_variables_request));
+    }
+
+    /// Create the variables of saved_frame from scratch.
+    void
+    list_variables_of_saved_frame ()
+    {
+        LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+        LOG_DD ("list local variables");
+        debugger->list_local_variables
+            (sigc::mem_fun
+             (*this, &Priv::add_new_local_vars_and_update_olders));
+        LOG_DD ("list frames arguments");
+        debugger->list_frames_arguments (saved_frame.level (),
+                                         saved_frame.level (),
+                                         sigc::mem_fun
+                                         (*this, &Priv::on_function_args_listed),
+                                         "");
+    }
+
+    /// Some variables of the displayed frame went out of scope.  That
+    /// happens when they were taken from the pool, but belong to an
+    /// older call of the function that had the same depth.  Create
+    /// the variables of the frame again.
+    void
+    on_displayed_variables_out_of_scope ()
+    {
+        LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+        re_init_tree_view ();
+        list_variables_of_saved_frame ();
+    }
+
     void
     show_variable_type_in_dialog ()
     {
@@ -742,7 +823,7 @@ public:
         for (IDebugger::VariableList::const_iterator it = local_vars.begin ();
              it != local_vars.end ();
              ++it) {
-            debugger->list_changed_variables
+            debugger->list_changed_variables_of_all
                     (*it,
                      sigc::mem_fun (*this,
                                     &Priv::on_local_variable_updated_signal));
@@ -771,7 +852,7 @@ public:
                                             function_arguments.begin ();
              it != function_arguments.end ();
              ++it) {
-            debugger->list_changed_variables
+            debugger->list_changed_variables_of_all
                     (*it,
                      sigc::mem_fun (*this,
                                     &Priv::on_function_args_updated_signal));
@@ -858,6 +939,9 @@ public:
                                             ("varobjwalker", "IVarWalker");
         result->visited_variable_signal ().connect
             (sigc::mem_fun (*this, &Priv::on_visited_variable_signal));
+        // Children past the first page are not fetched; the copied
+        // text marks them with "..." (see dutil::dump_variable_value).
+        result->set_maximum_number_of_children (vutil::CHILDREN_PAGE_SIZE);
         return result;
     }
 
@@ -900,14 +984,56 @@ public:
         saved_reason = a_reason;
         saved_has_frame = a_has_frame;
 
-        if (should_process_now ()) {
-            finish_handling_debugger_stopped_event (a_reason,
-                                                    a_has_frame,
-                                                    a_frame);
-        } else {
-            is_up2date = false;
+        refresh_scheduler.invalidate (*tree_view);
+
+        NEMIVER_CATCH
+    }
+
+    void
+    on_pooled_frame_variables (int a_thread_id,
+                               int a_frame_depth,
+                               const IDebugger::VariableList &a_local_vars,
+                               const IDebugger::VariableList &a_function_args,
+                               IDebugger::Frame a_frame,
+                               unsigned a_request)
+    {
+        LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+        NEMIVER_TRY
+
+        if (a_request != pooled_variables_request) {
+            // Another frame got displayed in the mean time, maybe
+            // in another thread.
+            LOG_DD ("dropping the answer to request " << (int) a_request);
+            debugger->pool_frame_variables (a_thread_id,
+                                            a_frame, a_frame_depth,
+                                            a_local_vars, a_function_args);
+            return;
+        }
+
+        displayed_frame = a_frame;
+        displayed_thread_id = a_thread_id;
+        displayed_frame_depth = a_frame_depth;
+
+        if (a_local_vars.empty () && a_function_args.empty ()) {
+            list_variables_of_saved_frame ();
+            return;
         }
 
+        LOG_DD ("reusing " << (int) a_local_vars.size ()
+                << " local variables and "
+                << (int) a_function_args.size () << " arguments");
+        IDebugger::VariableList::const_iterator it;
+        for (it = a_local_vars.begin (); it != a_local_vars.end (); ++it)
+            append_a_local_variable (*it);
+        for (it = a_function_args.begin (); it != a_function_args.end (); ++it)
+            append_a_function_argument (*it);
+
+        // The variables have the values they had when the frame was
+        // left; update them.
+        maybe_update_list_of_local_vars_and_then_update_older_ones ();
+        update_function_arguments ();
+
         NEMIVER_CATCH
     }
 
@@ -949,6 +1075,11 @@ public:
                     << " that has number of children "
                     << (int) (*it)->members ().size ());
 
+            if (!(*it)->in_scope () && !(*it)->has_parent ()) {
+                on_displayed_variables_out_of_scope ();
+                return;
+            }
+
             update_a_local_variable (*it,
                                      false /* Do not update members */);
             local_vars_changed_at_prev_stop.push_back (*it);
@@ -1025,6 +1156,10 @@ public:
         for (IDebugger::VariableList::const_iterator it = a_vars.begin ();
              it != a_vars.end ();
              ++it) {
+            if (!(*it)->in_scope () && !(*it)->has_parent ()) {
+                on_displayed_variables_out_of_scope ();
+                return;
+            }
             update_a_function_argument (*it);
             func_args_changed_at_prev_stop.push_back (*it);
         }
@@ -1178,7 +1313,7 @@ public:
         IDebugger::VariableSafePtr var =
             (*a_it)[vutil::get_variable_columns ().variable];
         debugger->unfold_variable
-            (var,
+            (var, 0, vutil::CHILDREN_PAGE_SIZE,
              sigc::bind  (sigc::mem_fun (*this,
                                          &Priv::on_variable_unfolded_signal),
                           a_path));
@@ -1222,20 +1357,6 @@ public:
         NEMIVER_CATCH
     }
 
-    void
-    on_draw_signal (const Cairo::RefPtr<Cairo::Context> &)
-    {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-        NEMIVER_TRY
-        if (!is_up2date) {
-            finish_handling_debugger_stopped_event (saved_reason,
-                                                    saved_has_frame,
-                                                    saved_frame);
-            is_up2date = true;
-        }
-        NEMIVER_CATCH
-    }
-
     void
     on_cell_edited_signal (const Glib::ustring &a_path,
                            const Glib::ustring &a_text)
@@ -1342,9 +1463,11 @@ public:
 
 LocalVarsInspector::LocalVarsInspector (IDebuggerSafePtr &a_debugger,
                                           IWorkbench &a_workbench,
-                                          IPerspective &a_perspective)
+                                          IPerspective &a_perspective,
+                                          RefreshScheduler &a_refresh_scheduler)
 {
-    m_priv.reset (new Priv (a_debugger, a_workbench, a_perspective));
+    m_priv.reset (new Priv (a_debugger, a_workbench, a_perspective,
+                            a_refresh_scheduler));
 }
 
 LocalVarsInspector::~LocalVarsInspector ()
@@ -1373,17 +1496,7 @@ LocalVarsInspector::show_local_variables_of_current_function
     THROW_IF_FAIL (m_priv->debugger);
 
     m_priv->saved_frame = a_frame;
-
-    re_init_widget ();
-    m_priv->debugger->list_local_variables
-        (sigc::mem_fun (*m_priv, &Priv::add_new_local_vars_and_update_olders));
-
-    int frame_level = m_priv->debugger->get_current_frame_level ();
-    LOG_DD ("current frame level: " <<  (int)frame_level);
-    m_priv->debugger->list_frames_arguments (frame_level, frame_level,
-                                             sigc::mem_fun
-                                             (*m_priv, &Priv::on_function_args_listed),
-                                             "");
+    m_priv->show_variables_of_saved_frame ();
 }
 
 /// Re-visualize the local variables of the current function, possibly
@@ -38,6 +38,7 @@ namespace Gtk {
 NEMIVER_BEGIN_NAMESPACE (nemiver)
 
 class IWorkbench;
+class RefreshScheduler;
 
 class NEMIVER_API LocalVarsInspector : public nemiver::common::Object {
     //non copyable
@@ -54,7 +55,8 @@ public:
 
     LocalVarsInspector (IDebuggerSafePtr &a_dbg,
                          IWorkbench &a_wb,
-                         IPerspective &a_perspective);
+                         IPerspective &a_perspective,
+                         RefreshScheduler &a_refresh_scheduler);
     virtual ~LocalVarsInspector ();
     Gtk::Widget& widget () const;
     void set_local_variables
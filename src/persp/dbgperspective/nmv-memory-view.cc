@@ -26,18 +26,25 @@
 #include <sstream>
 #include <bitset>
 #include <iomanip>
+#include <limits>
+#include <algorithm>
 #include <gtkmm/entry.h>
 #include <gtkmm/label.h>
 #include <gtkmm/box.h>
+#include <gtkmm/scrollbar.h>
 #include <glib/gi18n.h>
 #include <gtkmm/scrolledwindow.h>
 #include "nmv-ui-utils.h"
 #include "nmv-memory-view.h"
+#include "nmv-refresh-scheduler.h"
 #include "nmv-i-debugger.h"
 #include "uicommon/nmv-hex-editor.h"
 
 namespace nemiver {
 
+static const char* MEMORY_VIEW_COOKIE = "memory-view";
+static const char* MEMORY_VIEW_READ_AHEAD_COOKIE = "memory-view-read-ahead";
+
 class GroupingComboBox : public Gtk::ComboBox
 {
     public:
@@ -79,32 +86,86 @@ class GroupingComboBox : public Gtk::ComboBox
 
 };
 
+/// The memory view shows a screen of the memory of the inferior at
+/// a time, but it can be scrolled over VIRTUAL_RANGE_SIZE bytes
+/// around the address typed by the user.  Only the visible bytes are
+/// read from the debugger.  While scrolling, the next screens in the
+/// scrolling direction are read ahead, and shown from there once they
+/// become visible.
 struct MemoryView::Priv {
 public:
+    enum {
+        VIRTUAL_RANGE_SIZE = 64 * 1024 * 1024,
+        NB_READ_AHEAD_SCREENS = 8,
+        MAX_READ_AHEAD_SIZE = 64 * 1024
+    };
+
     SafePtr<Gtk::Label> m_address_label;
     SafePtr<Gtk::Entry> m_address_entry;
     SafePtr<Gtk::Button> m_jump_button;
     SafePtr<Gtk::Box> m_hbox;
     SafePtr<Gtk::Box> m_vbox;
+    SafePtr<Gtk::Box> m_editor_box;
     SafePtr<Gtk::Label> m_group_label;
     GroupingComboBox m_grouping_combo;
     SafePtr<Gtk::ScrolledWindow> m_container;
+    Glib::RefPtr<Gtk::Adjustment> m_adjustment;
+    SafePtr<Gtk::Scrollbar> m_scrollbar;
     Hex::DocumentSafePtr m_document;
     Hex::EditorSafePtr m_editor;
     IDebuggerSafePtr m_debugger;
+    RefreshScheduler &m_refresh_scheduler;
     sigc::connection signal_document_changed_connection;
-
-    Priv (IDebuggerSafePtr& a_debugger) :
+    sigc::connection adjustment_value_changed_connection;
+    // The address of the first line of the scrollable range.
+    size_t m_base_addr;
+    // The address of the first byte that should be visible.
+    size_t m_view_addr;
+    // The address of the first byte of the document.
+    size_t m_data_addr;
+    // The memory read ahead, starting at m_read_ahead_addr.
+    size_t m_read_ahead_addr;
+    std::vector<uint8_t> m_read_ahead_data;
+    // Whether a read ahead is pending.  There is at most one.
+    bool m_read_ahead_in_flight;
+    // Whether the memory might have changed since the pending read
+    // ahead was issued, in which case its response is dropped.
+    bool m_read_ahead_stale;
+    // -1 when scrolling up, 1 when scrolling down, 0 otherwise.
+    int m_scroll_direction;
+    // Whether a read of the visible memory is pending.  Scrolling
+    // while it is pending doesn't issue more reads; the visible
+    // memory is read again once it completes, if need be.
+    bool m_read_in_flight;
+    // The address the pending read of the visible memory started at.
+    size_t m_read_addr;
+
+    Priv (IDebuggerSafePtr& a_debugger,
+          RefreshScheduler &a_refresh_scheduler) :
         m_address_label (new Gtk::Label (_("Address:"))),
         m_address_entry (new Gtk::Entry ()),
         m_jump_button (new Gtk::Button (_("Show"))),
         m_hbox (new Gtk::Box (Gtk::ORIENTATION_HORIZONTAL)),
         m_vbox (new Gtk::Box (Gtk::ORIENTATION_VERTICAL)),
+        m_editor_box (new Gtk::Box (Gtk::ORIENTATION_HORIZONTAL)),
         m_group_label (new Gtk::Label (_("Group By:"))),
         m_container (new Gtk::ScrolledWindow ()),
+        m_adjustment (Gtk::Adjustment::create (0, 0, 0)),
+        m_scrollbar (new Gtk::Scrollbar (m_adjustment,
+                                         Gtk::ORIENTATION_VERTICAL)),
         m_document (Hex::Document::create ()),
         m_editor (Hex::Editor::create (m_document)),
-        m_debugger (a_debugger)
+        m_debugger (a_debugger),
+        m_refresh_scheduler (a_refresh_scheduler),
+        m_base_addr (0),
+        m_view_addr (0),
+        m_data_addr (0),
+        m_read_ahead_addr (0),
+        m_read_ahead_in_flight (false),
+        m_read_ahead_stale (false),
+        m_scroll_direction (0),
+        m_read_in_flight (false),
+        m_read_addr (0)
     {
         // For a reason, the hex editor (instance of m_editor) won't
         // properly render itself if it's not put inside a scrolled
@@ -117,6 +178,11 @@ public:
         m_editor->show_offsets ();
         m_editor->get_widget ().set_border_width (0);
 
+        // The hex editor only holds the visible bytes, so it is
+        // scrolled through our own scrollbar.
+        m_editor_box->pack_start (*w);
+        m_editor_box->pack_end (*m_scrollbar, Gtk::PACK_SHRINK);
+
         m_hbox->set_spacing (6);
         m_hbox->set_border_width (3);
         m_hbox->pack_start (*m_address_label, Gtk::PACK_SHRINK);
@@ -125,7 +191,7 @@ public:
         m_hbox->pack_start (m_grouping_combo, Gtk::PACK_SHRINK);
         m_hbox->pack_start (*m_jump_button, Gtk::PACK_SHRINK);
         m_vbox->pack_start (*m_hbox, Gtk::PACK_SHRINK);
-        m_vbox->pack_start (*w);
+        m_vbox->pack_start (*m_editor_box);
 
         // So the whole memory view widget is going to live inside a
         // scrolled window container with automatic-policy scrollbars.
@@ -138,6 +204,14 @@ public:
         m_container->add (*m_vbox);
 
         connect_signals ();
+        m_refresh_scheduler.register_view
+            (*m_container, RefreshScheduler::MODERATE_REFRESH,
+             sigc::mem_fun (*this, &Priv::refresh_visible_memory));
+    }
+
+    ~Priv ()
+    {
+        m_refresh_scheduler.unregister_view (*m_container);
     }
 
     void connect_signals ()
@@ -161,6 +235,19 @@ public:
         signal_document_changed_connection =
             m_document->signal_document_changed ().connect
                         (sigc::mem_fun (this, &Priv::on_document_changed));
+        THROW_IF_FAIL (m_adjustment);
+        adjustment_value_changed_connection =
+            m_adjustment->signal_value_changed ().connect
+                (sigc::mem_fun (this, &Priv::on_adjustment_value_changed));
+        THROW_IF_FAIL (m_editor);
+        m_editor->get_widget ().add_events (Gdk::SCROLL_MASK
+                                            | Gdk::KEY_PRESS_MASK);
+        m_editor->get_widget ().signal_scroll_event ().connect
+            (sigc::mem_fun (this, &Priv::on_editor_scroll_event),
+             false /*connect before*/);
+        m_editor->get_widget ().signal_key_press_event ().connect
+            (sigc::mem_fun (this, &Priv::on_editor_key_press_event),
+             false /*connect before*/);
     }
 
     void on_debugger_state_changed (IDebugger::State a_state)
@@ -178,21 +265,201 @@ public:
         NEMIVER_CATCH
     }
 
-    void do_memory_read ()
+    size_t get_bytes_per_line () const
     {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-        NEMIVER_TRY
-        THROW_IF_FAIL (m_debugger);
         THROW_IF_FAIL (m_editor);
         int editor_cpl, editor_lines;
         m_editor->get_geometry (editor_cpl, editor_lines);
+        return editor_cpl;
+    }
+
+    size_t get_bytes_per_screen () const
+    {
+        THROW_IF_FAIL (m_editor);
+        int editor_cpl, editor_lines;
+        m_editor->get_geometry (editor_cpl, editor_lines);
+        return editor_cpl * editor_lines;
+    }
+
+    void do_memory_read ()
+    {
+        LOG_FUNCTION_SCOPE_NORMAL_DD;
+        NEMIVER_TRY
         size_t addr = get_address ();
         if (validate_address (addr)) {
-            LOG_DD ("Fetching " << editor_cpl * editor_lines << " bytes");
-            // read as much memory as will fill the hex editor widget
-            m_debugger->read_memory (addr, editor_cpl * editor_lines);
+            jump_to_address (addr);
+        }
+        NEMIVER_CATCH
+    }
+
+    /// Make the scrollable range span VIRTUAL_RANGE_SIZE bytes around
+    /// a_addr, and show the memory at a_addr.
+    void jump_to_address (size_t a_addr)
+    {
+        LOG_FUNCTION_SCOPE_NORMAL_DD;
+        THROW_IF_FAIL (m_adjustment);
+
+        size_t cpl = get_bytes_per_line ();
+        size_t lines_before =
+            std::min (a_addr, (size_t) VIRTUAL_RANGE_SIZE / 2) / cpl;
+        m_base_addr = a_addr - lines_before * cpl;
+        size_t nb_lines =
+            std::min ((size_t) VIRTUAL_RANGE_SIZE,
+                      std::numeric_limits<size_t>::max () - m_base_addr)
+            / cpl;
+        double page = get_bytes_per_screen () / cpl;
+
+        adjustment_value_changed_connection.block ();
+        m_adjustment->configure (lines_before /*value*/,
+                                 0 /*lower*/,
+                                 nb_lines /*upper*/,
+                                 1 /*step increment*/,
+                                 page /*page increment*/,
+                                 page /*page size*/);
+        adjustment_value_changed_connection.unblock ();
+
+        m_view_addr = a_addr;
+        m_scroll_direction = 0;
+        fetch_visible_memory ();
+    }
+
+    void on_adjustment_value_changed ()
+    {
+        LOG_FUNCTION_SCOPE_NORMAL_DD;
+        NEMIVER_TRY
+        THROW_IF_FAIL (m_adjustment);
+        size_t addr = m_base_addr
+            + static_cast<size_t> (m_adjustment->get_value ())
+                * get_bytes_per_line ();
+        if (addr == m_view_addr)
+            return;
+        m_scroll_direction = addr > m_view_addr ? 1 : -1;
+        m_view_addr = addr;
+        fetch_visible_memory ();
+        NEMIVER_CATCH
+    }
+
+    bool on_editor_scroll_event (GdkEventScroll *a_event)
+    {
+        NEMIVER_TRY
+        THROW_IF_FAIL (m_adjustment);
+        if (!a_event || !m_view_addr)
+            return false;
+        double delta = 0;
+        switch (a_event->direction) {
+            case GDK_SCROLL_UP:
+                delta = -1;
+                break;
+            case GDK_SCROLL_DOWN:
+                delta = 1;
+                break;
+            case GDK_SCROLL_SMOOTH:
+                delta = a_event->delta_y;
+                break;
+            default:
+                return false;
         }
+        m_adjustment->set_value (m_adjustment->get_value ()
+                                 + 3 * delta
+                                   * m_adjustment->get_step_increment ());
+        return true;
         NEMIVER_CATCH
+        return false;
+    }
+
+    bool on_editor_key_press_event (GdkEventKey *a_event)
+    {
+        NEMIVER_TRY
+        THROW_IF_FAIL (m_adjustment);
+        if (!a_event || !m_view_addr)
+            return false;
+        if (a_event->keyval == GDK_KEY_Page_Down) {
+            m_adjustment->set_value (m_adjustment->get_value ()
+                                     + m_adjustment->get_page_increment ());
+            return true;
+        } else if (a_event->keyval == GDK_KEY_Page_Up) {
+            m_adjustment->set_value (m_adjustment->get_value ()
+                                     - m_adjustment->get_page_increment ());
+            return true;
+        }
+        NEMIVER_CATCH
+        return false;
+    }
+
+    /// \return true if the memory read ahead holds
+    /// [a_addr, a_addr + a_size).
+    bool is_read_ahead (size_t a_addr, size_t a_size) const
+    {
+        return a_addr >= m_read_ahead_addr
+            && a_addr + a_size
+                <= m_read_ahead_addr + m_read_ahead_data.size ();
+    }
+
+    void fetch_visible_memory ()
+    {
+        LOG_FUNCTION_SCOPE_NORMAL_DD;
+        THROW_IF_FAIL (m_debugger);
+        if (m_read_in_flight || !m_view_addr)
+            return;
+        size_t size = get_bytes_per_screen ();
+        if (is_read_ahead (m_view_addr, size)) {
+            LOG_DD ("Showing " << (int) size << " bytes read ahead");
+            std::vector<uint8_t>::const_iterator from =
+                m_read_ahead_data.begin () + (m_view_addr - m_read_ahead_addr);
+            show_memory (m_view_addr,
+                         std::vector<uint8_t> (from, from + size));
+            read_ahead ();
+            return;
+        }
+        LOG_DD ("Fetching " << (int) size << " bytes");
+        m_read_in_flight = true;
+        m_read_addr = m_view_addr;
+        // read as much memory as will fill the hex editor widget
+        m_debugger->read_memory (m_view_addr, size, MEMORY_VIEW_COOKIE);
+        read_ahead ();
+    }
+
+    /// Read the next screens in the scrolling direction, unless the
+    /// next one has already been read ahead, or a read ahead is
+    /// pending.  At most MAX_READ_AHEAD_SIZE bytes are read ahead,
+    /// and they replace the memory read ahead before.
+    void read_ahead ()
+    {
+        if (!m_scroll_direction || m_read_ahead_in_flight)
+            return;
+
+        size_t screen = get_bytes_per_screen ();
+        size_t next_begin;
+        if (m_scroll_direction > 0) {
+            next_begin = m_view_addr + screen;
+        } else {
+            next_begin = m_view_addr > screen ? m_view_addr - screen : 0;
+        }
+        if (is_read_ahead (next_begin, screen))
+            return;
+
+        size_t size = std::max (screen,
+                                std::min (NB_READ_AHEAD_SCREENS * screen,
+                                          (size_t) MAX_READ_AHEAD_SIZE));
+        size_t begin;
+        if (m_scroll_direction > 0) {
+            begin = next_begin;
+        } else {
+            begin = m_view_addr > size ? m_view_addr - size : 0;
+        }
+        m_read_ahead_in_flight = true;
+        m_read_ahead_stale = false;
+        m_debugger->read_memory (begin, size, MEMORY_VIEW_READ_AHEAD_COOKIE);
+    }
+
+    /// Forget about the memory read ahead, e.g, because the inferior
+    /// ran or the memory was written.
+    void forget_read_ahead ()
+    {
+        m_read_ahead_data.clear ();
+        m_read_ahead_addr = 0;
+        if (m_read_ahead_in_flight)
+            m_read_ahead_stale = true;
     }
 
     void on_group_changed ()
@@ -218,11 +485,25 @@ public:
             || a_reason == IDebugger::EXITED) {
             return;
         }
-        do_memory_read ();
+        // The memory that was read ahead is stale now.
+        forget_read_ahead ();
+        m_scroll_direction = 0;
+        THROW_IF_FAIL (m_container);
+        m_refresh_scheduler.invalidate (*m_container);
 
         NEMIVER_CATCH
     }
 
+    /// Read the memory shown by the view again.  This is the slot the
+    /// refresh scheduler calls.
+    void refresh_visible_memory ()
+    {
+        if (m_view_addr)
+            fetch_visible_memory ();
+        else
+            do_memory_read ();
+    }
+
     size_t get_address ()
     {
         THROW_IF_FAIL (m_address_entry);
@@ -245,24 +526,56 @@ public:
     void set_widgets_sensitive (bool a_enable = true)
     {
         LOG_FUNCTION_SCOPE_NORMAL_DD;
-        THROW_IF_FAIL (m_address_entry && m_jump_button);
+        THROW_IF_FAIL (m_address_entry && m_jump_button && m_scrollbar);
         m_address_entry->set_sensitive (a_enable);
         m_jump_button->set_sensitive (a_enable);
+        m_scrollbar->set_sensitive (a_enable);
         m_editor->get_widget ().set_sensitive (a_enable);
     }
 
     void on_memory_read_response (size_t a_addr,
                                   const std::vector<uint8_t> &a_values,
-                                  const UString& /*a_cookie*/)
+                                  const UString& a_cookie)
     {
         LOG_FUNCTION_SCOPE_NORMAL_DD;
         NEMIVER_TRY
+        if (a_cookie == MEMORY_VIEW_READ_AHEAD_COOKIE) {
+            m_read_ahead_in_flight = false;
+            if (m_read_ahead_stale) {
+                m_read_ahead_stale = false;
+                return;
+            }
+            m_read_ahead_addr = a_addr;
+            m_read_ahead_data = a_values;
+            // The view might have been scrolled past the memory it
+            // shows while the memory was being read ahead.
+            if (!m_read_in_flight && m_data_addr != m_view_addr)
+                fetch_visible_memory ();
+            return;
+        }
+        if (a_cookie != MEMORY_VIEW_COOKIE)
+            return;
+        // The engine answers every read, even if it failed, at the
+        // address that was asked for.
+        if (a_addr == m_read_addr)
+            m_read_in_flight = false;
+        show_memory (a_addr, a_values);
+        // The view was scrolled while the memory was being read.
+        // Compare with the address that was asked for, rather than
+        // with the address of the answer, so that the read is never
+        // re-issued forever.
+        if (m_read_addr != m_view_addr)
+            fetch_visible_memory ();
+        NEMIVER_CATCH
+    }
+
+    void show_memory (size_t a_addr, const std::vector<uint8_t> &a_values)
+    {
         THROW_IF_FAIL (m_address_entry);
         ostringstream addr;
         addr << std::showbase << std::hex << a_addr;
         m_address_entry->set_text (addr.str ());
         set_data (a_addr, a_values);
-        NEMIVER_CATCH
     }
 
     void set_data (size_t a_start_addr, const std::vector<uint8_t> &a_data)
@@ -273,6 +586,7 @@ public:
         signal_document_changed_connection.block ();
         m_document->clear ();
         m_editor->set_starting_offset (a_start_addr);
+        m_data_addr = a_start_addr;
         m_document->set_data (0 /*offset*/,
                               a_data.size (),
                               0 /*rep_len*/,
@@ -288,17 +602,19 @@ public:
                 m_document->get_data (a_change_data->start, length);
         if (new_data) {
             std::vector<uint8_t> data(new_data, new_data + length);
+            forget_read_ahead ();
             // set data in the debugger
             m_debugger->set_memory
-                (static_cast<size_t> (get_address () + a_change_data->start),
+                (static_cast<size_t> (m_data_addr + a_change_data->start),
                  data);
         }
     }
 
 };
 
-MemoryView::MemoryView (IDebuggerSafePtr& a_debugger) :
-    m_priv (new Priv(a_debugger))
+MemoryView::MemoryView (IDebuggerSafePtr& a_debugger,
+                        RefreshScheduler &a_refresh_scheduler) :
+    m_priv (new Priv(a_debugger, a_refresh_scheduler))
 {
 }
 
@@ -318,6 +634,11 @@ MemoryView::clear ()
     THROW_IF_FAIL (m_priv && m_priv->m_document && m_priv->m_address_entry);
     m_priv->m_document->set_data (0, 0, 0, 0, false);
     m_priv->m_address_entry->set_text ("");
+    m_priv->m_view_addr = m_priv->m_data_addr = 0;
+    m_priv->forget_read_ahead ();
+    m_priv->m_scroll_direction = 0;
+    // A pending read is answered by the previous session, if at all.
+    m_priv->m_read_in_flight = false;
 }
 
 void
@@ -0,0 +1,293 @@
+/*
+ *This file is part of the Nemiver project
+ *
+ *Nemiver is free software; you can redistribute
+ *it and/or modify it under the terms of
+ *the GNU General Public License as published by the
+ *Free Software Foundation; either version 2,
+ *or (at your option) any later version.
+ *
+ *Nemiver is distributed in the hope that it will
+ *be useful, but WITHOUT ANY WARRANTY;
+ *without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *See the GNU General Public License for more details.
+ *
+ *You should have received a copy of the
+ *GNU General Public License along with Nemiver;
+ *see the file COPYING.
+ *If not, write to the Free Software Foundation,
+ *Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *See COPYRIGHT file copyright information.
+ */
+#include "config.h"
+#include <list>
+#include <glibmm/main.h>
+#include "common/nmv-exception.h"
+#include "nmv-refresh-scheduler.h"
+
+using std::list;
+
+NEMIVER_BEGIN_NAMESPACE (nemiver)
+
+struct RefreshScheduler::Priv {
+    struct View {
+        // Null once the view is unregistered.
+        Gtk::Widget *widget;
+        Cost cost;
+        RefreshSlot refresh_slot;
+        sigc::connection draw_connection;
+        bool is_up2date;
+
+        View () :
+            widget (0),
+            cost (CHEAP_REFRESH),
+            is_up2date (true)
+        {
+        }
+    };
+
+    list<View> views;
+    sigc::connection batch_connection;
+    bool is_held;
+    // Set while the views are refreshed in a batch.  The views
+    // unregistered then are only removed after the batch.
+    bool is_refreshing;
+    // The number of invalidations received while the refreshes were
+    // held.
+    unsigned nb_skipped_refreshes;
+
+    Priv () :
+        is_held (false),
+        is_refreshing (false),
+        nb_skipped_refreshes (0)
+    {
+    }
+
+    ~Priv ()
+    {
+        batch_connection.disconnect ();
+        for (list<View>::iterator it = views.begin ();
+             it != views.end ();
+             ++it)
+            it->draw_connection.disconnect ();
+    }
+
+    View*
+    lookup_view (const Gtk::Widget &a_widget)
+    {
+        for (list<View>::iterator it = views.begin ();
+             it != views.end ();
+             ++it) {
+            if (it->widget == &a_widget)
+                return &*it;
+        }
+        return 0;
+    }
+
+    void
+    refresh_view (View &a_view)
+    {
+        a_view.is_up2date = true;
+        a_view.refresh_slot ();
+    }
+
+    /// Refresh the stale views that are visible, from an idle
+    /// callback that runs before the next redraw.  The draw signal
+    /// handlers of these views would otherwise refresh them one by
+    /// one.
+    void
+    schedule_batch ()
+    {
+        if (batch_connection.connected ())
+            return;
+        batch_connection = Glib::signal_idle ().connect
+            (sigc::mem_fun (*this, &Priv::on_batch),
+             Glib::PRIORITY_HIGH_IDLE);
+    }
+
+    bool
+    on_batch ()
+    {
+        LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+        if (is_held)
+            return false;
+
+        // A view that fails to refresh must not keep the others
+        // stale.
+        is_refreshing = true;
+        for (int cost = CHEAP_REFRESH; cost <= EXPENSIVE_REFRESH; ++cost) {
+            for (list<View>::iterator it = views.begin ();
+                 it != views.end ();
+                 ++it) {
+                NEMIVER_TRY
+
+                if (it->widget
+                    && it->cost == cost
+                    && !it->is_up2date
+                    && it->widget->get_is_drawable ()) {
+                    refresh_view (*it);
+                }
+
+                NEMIVER_CATCH
+            }
+        }
+        is_refreshing = false;
+        remove_unregistered_views ();
+
+        return false;
+    }
+
+    void
+    remove_unregistered_views ()
+    {
+        for (list<View>::iterator it = views.begin (); it != views.end ();) {
+            if (it->widget)
+                ++it;
+            else
+                it = views.erase (it);
+        }
+    }
+
+    void
+    on_draw_signal (const Cairo::RefPtr<Cairo::Context> &,
+                    Gtk::Widget *a_widget)
+    {
+        LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+        NEMIVER_TRY
+
+        THROW_IF_FAIL (a_widget);
+        View *view = lookup_view (*a_widget);
+        if (view && !view->is_up2date && !is_held)
+            refresh_view (*view);
+
+        NEMIVER_CATCH
+    }
+};//end struct RefreshScheduler::Priv
+
+RefreshScheduler::RefreshScheduler ()
+{
+    m_priv.reset (new Priv);
+}
+
+RefreshScheduler::~RefreshScheduler ()
+{
+}
+
+/// Register a view to the scheduler.
+///
+/// \param a_widget the widget showing the content of the view.
+///
+/// \param a_cost the cost of the queries sent to refresh the view.
+///
+/// \param a_refresh_slot the slot sending these queries.
+void
+RefreshScheduler::register_view (Gtk::Widget &a_widget,
+                                 Cost a_cost,
+                                 const RefreshSlot &a_refresh_slot)
+{
+    THROW_IF_FAIL (m_priv);
+    THROW_IF_FAIL (!m_priv->lookup_view (a_widget));
+
+    Priv::View view;
+    view.widget = &a_widget;
+    view.cost = a_cost;
+    view.refresh_slot = a_refresh_slot;
+    view.draw_connection = a_widget.signal_draw ().connect_notify
+        (sigc::bind (sigc::mem_fun (*m_priv, &Priv::on_draw_signal),
+                     &a_widget));
+    m_priv->views.push_back (view);
+}
+
+/// Unregister a view from the scheduler.  Its refresh slot is not
+/// called anymore.
+///
+/// \param a_widget the widget the view was registered with.
+void
+RefreshScheduler::unregister_view (Gtk::Widget &a_widget)
+{
+    THROW_IF_FAIL (m_priv);
+
+    Priv::View *view = m_priv->lookup_view (a_widget);
+    if (!view)
+        return;
+    view->draw_connection.disconnect ();
+    view->widget = 0;
+    if (!m_priv->is_refreshing)
+        m_priv->remove_unregistered_views ();
+}
+
+/// Tell the scheduler that the content of a view is stale.  The view
+/// is refreshed along with the other visible stale views, if it is
+/// visible.  Otherwise, it is refreshed when it gets drawn.
+void
+RefreshScheduler::invalidate (Gtk::Widget &a_widget)
+{
+    THROW_IF_FAIL (m_priv);
+
+    Priv::View *view = m_priv->lookup_view (a_widget);
+    THROW_IF_FAIL (view);
+    view->is_up2date = false;
+    if (m_priv->is_held)
+        ++m_priv->nb_skipped_refreshes;
+    else if (a_widget.get_is_drawable ())
+        m_priv->schedule_batch ();
+}
+
+/// \return true if the content of the view shown by a_widget was not
+/// invalidated since it was last refreshed.
+bool
+RefreshScheduler::is_up2date (Gtk::Widget &a_widget) const
+{
+    THROW_IF_FAIL (m_priv);
+
+    Priv::View *view = m_priv->lookup_view (a_widget);
+    THROW_IF_FAIL (view);
+    return view->is_up2date;
+}
+
+/// Hold the refreshes of the views until release_refreshes is
+/// called.  The views keep being invalidated, but they are not
+/// refreshed, even when they are drawn.
+void
+RefreshScheduler::hold_refreshes ()
+{
+    THROW_IF_FAIL (m_priv);
+    m_priv->is_held = true;
+}
+
+/// Release the refreshes held by hold_refreshes.  The stale visible
+/// views are refreshed in one batch.
+void
+RefreshScheduler::release_refreshes ()
+{
+    THROW_IF_FAIL (m_priv);
+
+    if (!m_priv->is_held)
+        return;
+    m_priv->is_held = false;
+    m_priv->schedule_batch ();
+}
+
+/// \return true if the refreshes are held.
+bool
+RefreshScheduler::refreshes_held () const
+{
+    THROW_IF_FAIL (m_priv);
+    return m_priv->is_held;
+}
+
+/// \return the number of times a view was invalidated while the
+/// refreshes were held, since the scheduler was created.  Each of
+/// these invalidations would otherwise have led to a refresh.
+unsigned
+RefreshScheduler::nb_skipped_refreshes () const
+{
+    THROW_IF_FAIL (m_priv);
+    return m_priv->nb_skipped_refreshes;
+}
+
+NEMIVER_END_NAMESPACE (nemiver)
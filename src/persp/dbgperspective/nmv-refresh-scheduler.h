@@ -0,0 +1,99 @@
+/*
+ *This file is part of the Nemiver project
+ *
+ *Nemiver is free software; you can redistribute
+ *it and/or modify it under the terms of
+ *the GNU General Public License as published by the
+ *Free Software Foundation; either version 2,
+ *or (at your option) any later version.
+ *
+ *Nemiver is distributed in the hope that it will
+ *be useful, but WITHOUT ANY WARRANTY;
+ *without even the implied warranty of
+ *MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *See the GNU General Public License for more details.
+ *
+ *You should have received a copy of the
+ *GNU General Public License along with Nemiver;
+ *see the file COPYING.
+ *If not, write to the Free Software Foundation,
+ *Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *See COPYRIGHT file copyright information.
+ */
+#ifndef __NMV_REFRESH_SCHEDULER_H__
+#define __NMV_REFRESH_SCHEDULER_H__
+
+#include <gtkmm/widget.h>
+#include "common/nmv-object.h"
+#include "common/nmv-safe-ptr-utils.h"
+
+using nemiver::common::Object;
+using nemiver::common::SafePtr;
+
+NEMIVER_BEGIN_NAMESPACE (nemiver)
+
+/// Schedules the refreshes of the views of the debugging perspective
+/// that show the state of the inferior.
+///
+/// Each view registers the widget showing its content, the cost of
+/// the queries it sends to the debugger to refresh, and a slot
+/// sending these queries.  When the inferior stops, the views
+/// invalidate their content.  The visible ones are then refreshed
+/// from one idle callback, cheapest first, so that their queries are
+/// queued in the debugger engine back to back.  The hidden ones are
+/// only refreshed when they get drawn.
+///
+/// The refreshes can be held, e.g. while the inferior is stepped
+/// repeatedly: the views invalidated in the meantime are refreshed
+/// once, when the refreshes are released.
+///
+/// The views must unregister from the scheduler before they go away.
+class NEMIVER_API RefreshScheduler : public Object {
+    //non copyable
+    RefreshScheduler (const RefreshScheduler &);
+    RefreshScheduler& operator= (const RefreshScheduler &);
+
+    struct Priv;
+    SafePtr<Priv> m_priv;
+
+public:
+
+    enum Cost {
+        // A query whose result is small, like the list of threads.
+        CHEAP_REFRESH = 0,
+        // A few queries, like the frames of the call stack and their
+        // arguments.
+        MODERATE_REFRESH,
+        // Queries whose results grow with the data of the inferior,
+        // like the variables of a frame.
+        EXPENSIVE_REFRESH
+    };
+
+    typedef sigc::slot<void> RefreshSlot;
+
+    RefreshScheduler ();
+    virtual ~RefreshScheduler ();
+
+    void register_view (Gtk::Widget &a_widget,
+                        Cost a_cost,
+                        const RefreshSlot &a_refresh_slot);
+
+    void unregister_view (Gtk::Widget &a_widget);
+
+    void invalidate (Gtk::Widget &a_widget);
+
+    bool is_up2date (Gtk::Widget &a_widget) const;
+
+    void hold_refreshes ();
+
+    void release_refreshes ();
+
+    bool refreshes_held () const;
+
+    unsigned nb_skipped_refreshes () const;
+};//end class RefreshScheduler
+
+NEMIVER_END_NAMESPACE (nemiver)
+
+#endif //__NMV_REFRESH_SCHEDULER_H__
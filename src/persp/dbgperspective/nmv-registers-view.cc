@@ -28,6 +28,7 @@
 #include <gtkmm/liststore.h>
 #include "common/nmv-exception.h"
 #include "nmv-registers-view.h"
+#include "nmv-refresh-scheduler.h"
 #include "nmv-ui-utils.h"
 #include "nmv-i-workbench.h"
 #include "nmv-i-perspective.h"
@@ -61,14 +62,19 @@ public:
     SafePtr<Gtk::TreeView> tree_view;
     Glib::RefPtr<Gtk::ListStore> list_store;
     IDebuggerSafePtr& debugger;
-    bool is_up2date;
+    RefreshScheduler &refresh_scheduler;
     bool first_run;
-    Priv (IDebuggerSafePtr& a_debugger) :
+    Priv (IDebuggerSafePtr& a_debugger,
+          RefreshScheduler &a_refresh_scheduler) :
         debugger(a_debugger),
-        is_up2date (true),
+        refresh_scheduler (a_refresh_scheduler),
         first_run (true)
     {
         build_tree_view ();
+        refresh_scheduler.register_view
+            (*tree_view, RefreshScheduler::CHEAP_REFRESH,
+             sigc::mem_fun (*this,
+                            &Priv::finish_handling_debugger_stopped_event));
 
         // update breakpoint list when debugger indicates that the list of
         // breakpoints has changed.
@@ -89,6 +95,11 @@ public:
                     (*this, &Priv::on_debugger_stopped));
     }
 
+    ~Priv ()
+    {
+        refresh_scheduler.unregister_view (*tree_view);
+    }
+
     void build_tree_view ()
     {
         if (tree_view) {return;}
@@ -110,17 +121,6 @@ public:
         THROW_IF_FAIL (renderer);
         renderer->signal_edited ().connect (sigc::mem_fun
                     (*this, &Priv::on_register_value_edited));
-        tree_view->signal_draw ().connect_notify (sigc::mem_fun
-                    (*this, &Priv::on_draw_signal));
-    }
-
-    bool should_process_now ()
-    {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-        THROW_IF_FAIL (tree_view);
-        bool is_visible = tree_view->get_is_drawable ();
-        LOG_DD ("is visible: " << is_visible);
-        return is_visible;
     }
 
     void finish_handling_debugger_stopped_event ()
@@ -147,12 +147,7 @@ public:
             || a_reason == IDebugger::EXITED) {
             return;
         }
-        if (should_process_now ()) {
-            finish_handling_debugger_stopped_event ();
-        } else {
-            is_up2date = false;
-        }
-
+        refresh_scheduler.invalidate (*tree_view);
     }
 
     void on_debugger_registers_listed
@@ -263,18 +258,6 @@ public:
         }
     }
 
-    void on_draw_signal (const Cairo::RefPtr<Cairo::Context> &)
-    {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-
-        NEMIVER_TRY
-        if (!is_up2date) {
-            finish_handling_debugger_stopped_event ();
-            is_up2date = true;
-        }
-        NEMIVER_CATCH
-    }
-
     // helper function which highlights a row in red or returns the text to
     // normal color to indicate whether it has changed since last update
     void set_changed (Gtk::TreeModel::iterator& iter, bool changed = true)
@@ -291,9 +274,10 @@ public:
 
 };//end class RegistersView::Priv
 
-RegistersView::RegistersView (IDebuggerSafePtr& a_debugger)
+RegistersView::RegistersView (IDebuggerSafePtr& a_debugger,
+                              RefreshScheduler &a_refresh_scheduler)
 {
-    m_priv.reset (new Priv (a_debugger));
+    m_priv.reset (new Priv (a_debugger, a_refresh_scheduler));
 }
 
 RegistersView::~RegistersView ()
@@ -35,6 +35,7 @@ NEMIVER_BEGIN_NAMESPACE (nemiver)
 
 class IWorkbench;
 class IPerspective;
+class RefreshScheduler;
 
 class NEMIVER_API RegistersView : public nemiver::common::Object {
     //non copyable
@@ -46,7 +47,8 @@ class NEMIVER_API RegistersView : public nemiver::common::Object {
 
 public:
 
-    RegistersView (IDebuggerSafePtr& a_debugger);
+    RegistersView (IDebuggerSafePtr& a_debugger,
+                   RefreshScheduler &a_refresh_scheduler);
     virtual ~RegistersView ();
     Gtk::Widget& widget () const;
     void clear ();
@@ -28,6 +28,7 @@
 #include <gtkmm/treestore.h>
 #include "common/nmv-exception.h"
 #include "nmv-thread-list.h"
+#include "nmv-refresh-scheduler.h"
 #include "nmv-i-debugger.h"
 #include "nmv-ui-utils.h"
 
@@ -58,32 +59,33 @@ struct ThreadList::Priv {
     sigc::signal<void, int> thread_selected_signal;
     int current_thread_id;
     sigc::connection tree_view_selection_changed_connection;
-    bool is_up2date;
+    RefreshScheduler &refresh_scheduler;
 
-    Priv (IDebuggerSafePtr &a_debugger) :
+    Priv (IDebuggerSafePtr &a_debugger,
+          RefreshScheduler &a_refresh_scheduler) :
         debugger (a_debugger),
         current_thread (0),
         current_thread_id (0),
-        is_up2date (true)
+        refresh_scheduler (a_refresh_scheduler)
     {
         build_widget ();
         connect_to_debugger_signals ();
         connect_to_widget_signals ();
+        refresh_scheduler.register_view
+            (*tree_view, RefreshScheduler::CHEAP_REFRESH,
+             sigc::mem_fun (*this,
+                            &Priv::finish_handling_debugger_stopped_event));
     }
 
-    void finish_handling_debugger_stopped_event ()
+    ~Priv ()
     {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-        debugger->list_threads ();
+        refresh_scheduler.unregister_view (*tree_view);
     }
 
-    bool should_process_now ()
+    void finish_handling_debugger_stopped_event ()
     {
         LOG_FUNCTION_SCOPE_NORMAL_DD;
-        THROW_IF_FAIL (tree_view);
-        bool is_visible = tree_view->get_is_drawable ();
-        LOG_DD ("is visible: " << is_visible);
-        return is_visible;
+        debugger->list_threads ();
     }
 
     void on_debugger_stopped_signal (IDebugger::StopReason a_reason,
@@ -101,11 +103,7 @@ struct ThreadList::Priv {
             return;
         }
         current_thread_id = a_thread_id;
-        if (should_process_now ()) {
-            finish_handling_debugger_stopped_event ();
-        } else {
-            is_up2date = false;
-        }
+        refresh_scheduler.invalidate (*tree_view);
         NEMIVER_CATCH
     }
 
@@ -140,18 +138,6 @@ struct ThreadList::Priv {
         NEMIVER_CATCH
     }
 
-    void on_draw_signal (const Cairo::RefPtr<Cairo::Context> &)
-    {
-        LOG_FUNCTION_SCOPE_NORMAL_DD;
-
-        NEMIVER_TRY
-        if (!is_up2date) {
-            finish_handling_debugger_stopped_event ();
-            is_up2date = true;
-        }
-        NEMIVER_CATCH
-    }
-
     void on_tree_view_selection_changed_signal ()
     {
         LOG_FUNCTION_SCOPE_NORMAL_DD;
@@ -211,8 +197,6 @@ struct ThreadList::Priv {
             tree_view->get_selection ()->signal_changed ().connect
                 (sigc::mem_fun
                     (*this, &Priv::on_tree_view_selection_changed_signal));
-        tree_view->signal_draw ().connect_notify
-                    (sigc::mem_fun (*this, &Priv::on_draw_signal));
     }
 
     void set_a_thread_id (int a_id)
@@ -259,9 +243,10 @@ struct ThreadList::Priv {
     }
 };//end ThreadList::Priv
 
-ThreadList::ThreadList (IDebuggerSafePtr &a_debugger)
+ThreadList::ThreadList (IDebuggerSafePtr &a_debugger,
+                        RefreshScheduler &a_refresh_scheduler)
 {
-    m_priv.reset (new ThreadList::Priv (a_debugger));
+    m_priv.reset (new ThreadList::Priv (a_debugger, a_refresh_scheduler));
 }
 
 ThreadList::~ThreadList ()
@@ -37,6 +37,8 @@ using nemiver::IDebuggerSafePtr;
 
 NEMIVER_BEGIN_NAMESPACE (nemiver)
 
+class RefreshScheduler;
+
 class NEMIVER_API ThreadList : public Object {
     //non copyable
     ThreadList (const ThreadList &);
@@ -50,7 +52,7 @@ protected:
 
 public:
 
-    ThreadList (IDebuggerSafePtr &);
+    ThreadList (IDebuggerSafePtr &, RefreshScheduler &);
     virtual ~ThreadList ();
     const std::list<int>& thread_ids () const;
     int current_thread_id () const;
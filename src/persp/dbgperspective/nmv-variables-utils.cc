@@ -25,6 +25,9 @@
 
 #include "config.h"
 
+#include <map>
+#include <string>
+#include <glib/gi18n.h>
 #include "nmv-variables-utils.h"
 #include "common/nmv-exception.h"
 #include "nmv-ui-utils.h"
@@ -62,6 +65,180 @@ get_variable_columns ()
     return s_cols;
 }
 
+/// The rows of a tree store that hold variable objects, indexed by
+/// the names of these variable objects.  This spares walking the tree
+/// to find the row of each variable that changed.
+///
+/// The iterators of a Gtk::TreeStore remain valid until their row is
+/// deleted.  The rows erased with erase_variable_row are dropped from
+/// the index before they are deleted.  The index can't tell which of
+/// its rows went away with a row deleted by other means, so it is
+/// emptied then.  It is filled again as rows are set or found.
+struct VariableRowIndex {
+    typedef std::map<std::string, Gtk::TreeModel::iterator> Rows;
+    Rows rows;
+    sigc::connection row_deleted_connection;
+    // Set while erase_variable_row deletes a row.
+    bool is_erasing_unindexed_row;
+
+    VariableRowIndex () :
+        is_erasing_unindexed_row (false)
+    {
+    }
+
+    /// Drop a row and its descendants from the index.
+    void
+    unindex_rows (const Gtk::TreeModel::iterator &a_row_it)
+    {
+        IDebugger::VariableSafePtr var =
+            a_row_it->get_value (get_variable_columns ().variable);
+        if (var && !var->internal_name ().empty ()) {
+            Rows::iterator it = rows.find (var->internal_name ().raw ());
+            if (it != rows.end () && it->second == a_row_it)
+                rows.erase (it);
+        }
+        Gtk::TreeModel::Children children = a_row_it->children ();
+        for (Gtk::TreeModel::iterator child_it = children.begin ();
+             child_it != children.end ();
+             ++child_it)
+            unindex_rows (child_it);
+    }
+
+    void
+    on_row_deleted (const Gtk::TreeModel::Path &)
+    {
+        if (!is_erasing_unindexed_row)
+            rows.clear ();
+    }
+};//end struct VariableRowIndex
+
+static const char *VARIABLE_ROW_INDEX_KEY = "nemiver-variable-row-index";
+
+static void
+delete_variable_row_index (gpointer a_index)
+{
+    VariableRowIndex *index = static_cast<VariableRowIndex*> (a_index);
+    index->row_deleted_connection.disconnect ();
+    delete index;
+}
+
+/// Get the variable row index of a tree store, creating it if need
+/// be.
+static VariableRowIndex&
+get_variable_row_index (const Glib::RefPtr<Gtk::TreeStore> &a_store)
+{
+    Glib::RefPtr<Gtk::TreeStore> tree_store = a_store;
+    THROW_IF_FAIL (tree_store);
+
+    Glib::Quark key (VARIABLE_ROW_INDEX_KEY);
+    VariableRowIndex *index =
+        static_cast<VariableRowIndex*> (tree_store->get_data (key));
+    if (!index) {
+        index = new VariableRowIndex;
+        index->row_deleted_connection =
+            tree_store->signal_row_deleted ().connect
+                (sigc::mem_fun (*index, &VariableRowIndex::on_row_deleted));
+        tree_store->set_data (key, index, &delete_variable_row_index);
+    }
+    return *index;
+}
+
+/// Get the variable row index of the tree store of a tree view,
+/// creating it if need be.
+static VariableRowIndex&
+get_variable_row_index (Gtk::TreeView &a_tree_view)
+{
+    return get_variable_row_index
+        (Glib::RefPtr<Gtk::TreeStore>::cast_dynamic (a_tree_view.get_model ()));
+}
+
+/// Record the row of a variable in the variable row index of a tree
+/// view.  Variables that are not backed by variable objects are not
+/// indexed.
+static void
+index_variable_row (const IDebugger::VariableSafePtr a_var,
+                    Gtk::TreeView &a_tree_view,
+                    const Gtk::TreeModel::iterator &a_row_it)
+{
+    if (!a_var || a_var->internal_name ().empty ())
+        return;
+    get_variable_row_index (a_tree_view).rows[a_var->internal_name ().raw ()]
+                                                                    = a_row_it;
+}
+
+/// Look the row of a variable up in the variable row index of a tree
+/// view.
+///
+/// \param a_var the variable to look for.
+///
+/// \param a_tree_view the tree view to consider.
+///
+/// \param a_ancestor_row_it the row the row of a_var must descend
+/// from.
+///
+/// \param a_out_row_it the row of a_var.  This is set if and only if
+/// the function returns true.
+///
+/// \return true if the row of a_var was found in the index.
+bool
+find_indexed_variable_row (const IDebugger::VariableSafePtr a_var,
+                           Gtk::TreeView &a_tree_view,
+                           const Gtk::TreeModel::iterator &a_ancestor_row_it,
+                           Gtk::TreeModel::iterator &a_out_row_it)
+{
+    if (!a_var || a_var->internal_name ().empty ())
+        return false;
+
+    VariableRowIndex &index = get_variable_row_index (a_tree_view);
+    VariableRowIndex::Rows::const_iterator it =
+        index.rows.find (a_var->internal_name ().raw ());
+    if (it == index.rows.end () || !variables_match (a_var, it->second))
+        return false;
+
+    for (Gtk::TreeModel::iterator row_it = it->second->parent ();
+         row_it;
+         row_it = row_it->parent ()) {
+        if (row_it == a_ancestor_row_it) {
+            a_out_row_it = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Erase a row of a tree store of variables, keeping the variable
+/// row index of the store up to date.
+///
+/// \param a_store the tree store to act upon.
+///
+/// \param a_row_it the row to erase, with its descendants.
+///
+/// \return the row that follows a_row_it, like Gtk::TreeStore::erase.
+Gtk::TreeModel::iterator
+erase_variable_row (const Glib::RefPtr<Gtk::TreeStore> &a_store,
+                    const Gtk::TreeModel::iterator &a_row_it)
+{
+    VariableRowIndex &index = get_variable_row_index (a_store);
+    index.unindex_rows (a_row_it);
+    index.is_erasing_unindexed_row = true;
+    Gtk::TreeModel::iterator next_row_it = a_store->erase (a_row_it);
+    index.is_erasing_unindexed_row = false;
+    return next_row_it;
+}
+
+/// Set the value of a column of a row, unless the row holds that
+/// value already.  Each value set emits the row-changed signal, which
+/// makes the tree view measure and draw the row again.
+template<class T>
+static void
+set_row_value (const Gtk::TreeModel::iterator &a_row_it,
+               const Gtk::TreeModelColumn<T> &a_column,
+               const typename Gtk::TreeModelColumn<T>::ElementType &a_value)
+{
+    if (a_row_it->get_value (a_column) != a_value)
+        a_row_it->set_value (a_column, a_value);
+}
+
 bool
 is_type_a_pointer (const UString &a_type)
 {
@@ -102,8 +279,7 @@ set_a_variable_node_type (Gtk::TreeModel::iterator &a_var_it,
                           bool a_truncate)
 {
     THROW_IF_FAIL (a_var_it);
-    a_var_it->set_value (get_variable_columns ().type,
-                         (Glib::ustring)a_type);
+    set_row_value (a_var_it, get_variable_columns ().type, a_type);
     int nb_lines = a_type.get_number_of_lines ();
     UString type_caption = a_type;
     if (nb_lines) {--nb_lines;}
@@ -121,8 +297,8 @@ set_a_variable_node_type (Gtk::TreeModel::iterator &a_var_it,
         type_caption += "...";
     }
 
-    a_var_it->set_value (get_variable_columns ().type_caption,
-                         (Glib::ustring)type_caption);
+    set_row_value (a_var_it, get_variable_columns ().type_caption,
+                   type_caption);
     IDebugger::VariableSafePtr variable =
         (IDebugger::VariableSafePtr) a_var_it->get_value
                                         (get_variable_columns ().variable);
@@ -162,7 +338,8 @@ update_a_variable_node (const IDebugger::VariableSafePtr a_var,
         return;
     }
 
-    (*a_iter)[get_variable_columns ().variable] = a_var;
+    set_row_value (a_iter, get_variable_columns ().variable, a_var);
+    index_variable_row (a_var, a_tree_view, a_iter);
     UString var_name = a_var->name_caption ();
     if (var_name.empty ()) {var_name = a_var->name ();}
     var_name.chomp ();
@@ -177,7 +354,6 @@ update_a_variable_node (const IDebugger::VariableSafePtr a_var,
     } else {
         LOG_DD ("Didn't update variable name");
     }
-    (*a_iter) [get_variable_columns ().is_highlighted] = false;
     bool do_highlight = false;
     if (a_handle_highlight && !a_is_new_frame) {
         UString prev_value =
@@ -187,20 +363,21 @@ update_a_variable_node (const IDebugger::VariableSafePtr a_var,
         }
     }
 
+    set_row_value (a_iter, get_variable_columns ().is_highlighted,
+                   do_highlight);
     if (do_highlight) {
         LOG_DD ("do highlight variable");
-        (*a_iter)[get_variable_columns ().is_highlighted]=true;
-        (*a_iter)[get_variable_columns ().fg_color] = Gdk::RGBA ("red");
+        set_row_value (a_iter, get_variable_columns ().fg_color,
+                       Gdk::RGBA ("red"));
     } else {
         LOG_DD ("remove highlight from variable");
-        (*a_iter)[get_variable_columns ().is_highlighted]=false;
         Gdk::RGBA rgba =
             a_tree_view.get_style_context ()->get_color
                                                   (Gtk::STATE_FLAG_NORMAL);
-        (*a_iter)[get_variable_columns ().fg_color] = rgba;
+        set_row_value (a_iter, get_variable_columns ().fg_color, rgba);
     }
 
-    (*a_iter)[get_variable_columns ().value] = a_var->value ();
+    set_row_value (a_iter, get_variable_columns ().value, a_var->value ());
     LOG_DD ("Updated variable value to " << a_var->value ());
     set_a_variable_node_type (a_iter,  a_var->type (), a_truncate_type);
     LOG_DD ("Updated variable type to " << a_var->type ());
@@ -216,6 +393,9 @@ update_a_variable_node (const IDebugger::VariableSafePtr a_var,
 /// a_var is bound to the graphical node pointed to by a_var_it.
 /// This function then updates a_var_it to make it show new graphical
 /// nodes representing the new children of a_variable.
+/// If a_var got unfolded by windows of children, only the members of
+/// the last window are added, followed by a row standing for the
+/// children that remain to be unfolded, if any.
 void
 update_unfolded_variable (const IDebugger::VariableSafePtr a_var,
                           Gtk::TreeView &a_tree_view,
@@ -224,18 +404,96 @@ update_unfolded_variable (const IDebugger::VariableSafePtr a_var,
 {
     LOG_FUNCTION_SCOPE_NORMAL_DD;
 
+    Glib::RefPtr<Gtk::TreeStore> tree_store =
+        Glib::RefPtr<Gtk::TreeStore>::cast_dynamic (a_tree_view.get_model ());
+    THROW_IF_FAIL (tree_store);
+
+    // Count the rows of the members shown already, and remove the
+    // rows that don't hold a variable: the dummy row shown before
+    // the first unfolding, and the row that stood for the children
+    // yet to be unfolded.
+    IDebugger::VariableList::size_type nb_shown = 0;
+    Gtk::TreeModel::iterator row_it;
+    for (row_it = a_var_it->children ().begin ();
+         row_it != a_var_it->children ().end ();) {
+        if (is_empty_row (row_it)) {
+            row_it = erase_variable_row (tree_store, row_it);
+            continue;
+        }
+        ++nb_shown;
+        ++row_it;
+    }
+    (*a_var_it)[get_variable_columns ().needs_unfolding] = false;
+
     Gtk::TreeModel::iterator result_var_row_it;
-    IDebugger::VariableList::const_iterator var_it;
     IDebugger::VariableList::const_iterator member_it;
     for (member_it = a_var->members ().begin ();
          member_it != a_var->members ().end ();
          ++member_it) {
+        if (nb_shown) {
+            --nb_shown;
+            continue;
+        }
         append_a_variable (*member_it,
                            a_tree_view,
                            a_var_it,
                            result_var_row_it,
                            a_truncate_type);
     }
+    append_more_children_row (a_var, a_tree_view, a_var_it);
+}
+
+/// Append a row standing for the children of a variable that remain
+/// to be unfolded, after the rows of its members.
+///
+/// Activating that row unfolds the next window of children of the
+/// variable, see VarsTreeView::more_children_requested_signal.
+///
+/// \param a_var the variable to consider.
+///
+/// \param a_tree_view the tree view in which a_var is represented.
+///
+/// \param a_var_it the graphical node of a_var.
+///
+/// \return true if the row was added, false if a_var doesn't have
+/// any children left to unfold.
+bool
+append_more_children_row (const IDebugger::VariableSafePtr a_var,
+                          Gtk::TreeView &a_tree_view,
+                          Gtk::TreeModel::iterator a_var_it)
+{
+    LOG_FUNCTION_SCOPE_NORMAL_DD;
+
+    if (!a_var || !a_var->needs_more_unfolding ())
+        return false;
+
+    Glib::RefPtr<Gtk::TreeStore> tree_store =
+        Glib::RefPtr<Gtk::TreeStore>::cast_dynamic (a_tree_view.get_model ());
+    THROW_IF_FAIL (tree_store);
+
+    UString caption;
+    if (a_var->members ().size () < a_var->num_expected_children ())
+        caption.printf (_("%d more..."),
+                        (int) (a_var->num_expected_children ()
+                               - a_var->members ().size ()));
+    else
+        caption = _("More...");
+
+    Gtk::TreeModel::iterator row_it =
+        tree_store->append (a_var_it->children ());
+    (*row_it)[get_variable_columns ().name] = caption;
+    (*row_it)[get_variable_columns ().is_more_children_row] = true;
+    return true;
+}
+
+/// \return true if a_row_it is the row standing for the children of
+/// a variable that remain to be unfolded.
+bool
+is_more_children_row (const Gtk::TreeModel::iterator &a_row_it)
+{
+    if (!a_row_it)
+        return false;
+    return (*a_row_it)[get_variable_columns ().is_more_children_row];
 }
 
 /// Finds a variable in the tree view of variables.
@@ -469,10 +727,19 @@ update_a_variable (const IDebugger::VariableSafePtr a_var,
     Gtk::TreeModel::iterator row_it;
     // First lets try to see if a_var is already graphically
     // represented as a descendent of the graphical node
-    // a_parent_row_it.
-    bool found_variable = find_a_variable_descendent (a_var,
-                                                      a_parent_row_it,
-                                                      row_it);
+    // a_parent_row_it.  Its row is usually indexed; walking the
+    // tree is the fallback.
+    bool found_variable = find_indexed_variable_row (a_var,
+                                                     a_tree_view,
+                                                     a_parent_row_it,
+                                                     row_it);
+    if (!found_variable) {
+        found_variable = find_a_variable_descendent (a_var,
+                                                     a_parent_row_it,
+                                                     row_it);
+        if (found_variable)
+            index_variable_row (a_var, a_tree_view, row_it);
+    }
 
     IDebugger::VariableSafePtr var = a_var;
     if (!found_variable) {
@@ -656,7 +923,7 @@ append_a_variable (const IDebugger::VariableSafePtr a_var,
             Gtk::TreeModel::Children::const_iterator it;
             for (it = a_parent_row_it->children ().begin ();
                  it != a_parent_row_it->children ().end ();) {
-                it = tree_store->erase (it);
+                it = erase_variable_row (tree_store, it);
             }
             (*a_parent_row_it)[get_variable_columns ().needs_unfolding]
                                                                         = false;
@@ -716,6 +983,7 @@ set_a_variable (const IDebugger::VariableSafePtr a_var,
              ++it) {
             append_a_variable (*it, a_tree_view, a_row_it, a_truncate_type);
         }
+        append_more_children_row (a_var, a_tree_view, a_row_it);
     }
     return true;
 }
@@ -743,7 +1011,7 @@ unlink_a_variable_row (const IDebugger::VariableSafePtr &a_var,
         return false;
     }
 
-    a_store->erase (var_to_unlink_it);
+    erase_variable_row (a_store, var_to_unlink_it);
     LOG_DD ("var " << a_var->id () << " was found and unlinked");
     return true;
 }
@@ -770,14 +1038,14 @@ unlink_member_variable_rows (const Gtk::TreeModel::iterator &a_row_it,
 	 it != a_row_it->children ().end ();
 	 ++it) {
 	var = it->get_value (get_variable_columns ().variable);
-	if (var)
+	if (var || is_more_children_row (it))
 	    paths.push_back (a_store->get_path (it));
     }
     for (int i = paths.size (); i > 0; --i) {
 	Gtk::TreeIter it = a_store->get_iter (paths[i - 1]);
         IDebugger::VariableSafePtr empty_var;
         (*it)->get_value(get_variable_columns ().variable).reset ();
-	a_store->erase (it);
+	erase_variable_row (a_store, it);
     }
     return true;
 }
@@ -46,7 +46,8 @@ struct VariableColumns : public Gtk::TreeModelColumnRecord {
         IS_HIGHLIGHTED_OFFSET,
         NEEDS_UNFOLDING,
         FG_COLOR_OFFSET,
-        VARIABLE_VALUE_EDITABLE_OFFSET
+        VARIABLE_VALUE_EDITABLE_OFFSET,
+        IS_MORE_CHILDREN_ROW_OFFSET
     };
 
     Gtk::TreeModelColumn<Glib::ustring> name;
@@ -58,6 +59,9 @@ struct VariableColumns : public Gtk::TreeModelColumnRecord {
     Gtk::TreeModelColumn<bool> needs_unfolding;
     Gtk::TreeModelColumn<Gdk::RGBA> fg_color;
     Gtk::TreeModelColumn<bool> variable_value_editable;
+    // Set on the row standing for the children of a variable that
+    // remain to be unfolded.
+    Gtk::TreeModelColumn<bool> is_more_children_row;
 
     VariableColumns ()
     {
@@ -70,9 +74,13 @@ struct VariableColumns : public Gtk::TreeModelColumnRecord {
         add (needs_unfolding);
         add (fg_color);
         add (variable_value_editable);
+        add (is_more_children_row);
     }
 };//end VariableColumns
 
+// The number of children of a variable unfolded at a time.
+const int CHILDREN_PAGE_SIZE = 100;
+
 VariableColumns& get_variable_columns ();
 
 bool is_type_a_pointer (const UString &a_type);
@@ -93,6 +101,21 @@ void update_unfolded_variable (const IDebugger::VariableSafePtr a_var,
                                Gtk::TreeModel::iterator a_var_it,
                                bool a_truncate_type);
 
+bool append_more_children_row (const IDebugger::VariableSafePtr a_var,
+                               Gtk::TreeView &a_tree_view,
+                               Gtk::TreeModel::iterator a_var_it);
+
+bool is_more_children_row (const Gtk::TreeModel::iterator &a_row_it);
+
+bool find_indexed_variable_row (const IDebugger::VariableSafePtr a_var,
+                                Gtk::TreeView &a_tree_view,
+                                const Gtk::TreeModel::iterator &a_ancestor_row_it,
+                                Gtk::TreeModel::iterator &a_out_row_it);
+
+Gtk::TreeModel::iterator
+erase_variable_row (const Glib::RefPtr<Gtk::TreeStore> &a_store,
+                    const Gtk::TreeModel::iterator &a_row_it);
+
 bool find_a_variable (const IDebugger::VariableSafePtr a_var,
                       const Gtk::TreeModel::iterator &a_parent_row_it,
                       Gtk::TreeModel::iterator &a_out_row_it);
@@ -24,6 +24,7 @@
  */
 #include "config.h"
 #include <glib/gi18n.h>
+#include "common/nmv-exception.h"
 #include "nmv-vars-treeview.h"
 #include "nmv-variables-utils.h"
 
@@ -80,5 +81,80 @@ VarsTreeView::get_tree_store ()
     return m_tree_store;
 }
 
+sigc::signal<void, const Gtk::TreeModel::Path&>&
+VarsTreeView::more_children_requested_signal ()
+{
+    return m_more_children_requested_signal;
+}
+
+/// Unfold the next children of a variable.  This is meant to be
+/// connected to more_children_requested_signal, with the debugger
+/// bound to the second argument.
+///
+/// \param a_path the path to the row of the variable.
+///
+/// \param a_debugger the debugger to unfold the variable with.
+void
+VarsTreeView::unfold_more_children (const Gtk::TreeModel::Path &a_path,
+                                    IDebugger &a_debugger)
+{
+    NEMIVER_TRY
+
+    Gtk::TreeModel::iterator it = m_tree_store->get_iter (a_path);
+    IDebugger::VariableSafePtr var =
+        (*it)[vutil::get_variable_columns ().variable];
+    THROW_IF_FAIL (var);
+
+    int nb_members = var->members ().size ();
+    a_debugger.unfold_variable
+        (var, nb_members, nb_members + vutil::CHILDREN_PAGE_SIZE,
+         sigc::bind (sigc::mem_fun
+                            (*this, &VarsTreeView::on_more_children_unfolded),
+                     a_path));
+
+    NEMIVER_CATCH
+}
+
+void
+VarsTreeView::on_more_children_unfolded
+                            (const IDebugger::VariableSafePtr a_var,
+                             const Gtk::TreeModel::Path a_path)
+{
+    NEMIVER_TRY
+
+    Gtk::TreeModel::iterator var_it = m_tree_store->get_iter (a_path);
+    vutil::update_unfolded_variable (a_var, *this, var_it,
+                                     false /* do not truncate type */);
+    expand_row (a_path, false);
+
+    NEMIVER_CATCH
+}
+
+void
+VarsTreeView::on_row_activated (const Gtk::TreeModel::Path &a_path,
+                                Gtk::TreeViewColumn *a_column)
+{
+    Gtk::TreeView::on_row_activated (a_path, a_column);
+
+    NEMIVER_TRY
+
+    Gtk::TreeModel::iterator it = m_tree_store->get_iter (a_path);
+    if (!vutil::is_more_children_row (it))
+        return;
+
+    // The row is removed once the next children are unfolded, or put
+    // back if they can't be.  Until then, make sure activating it
+    // again doesn't unfold them twice.
+    (*it)[vutil::get_variable_columns ().is_more_children_row] = false;
+    (*it)[vutil::get_variable_columns ().name] =
+                                            Glib::ustring (_("Loading..."));
+
+    Gtk::TreeModel::Path var_path = a_path;
+    var_path.up ();
+    m_more_children_requested_signal.emit (var_path);
+
+    NEMIVER_CATCH
+}
+
 NEMIVER_END_NAMESPACE (nemiver)
 
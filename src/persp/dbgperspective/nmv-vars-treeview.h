@@ -29,6 +29,7 @@
 #include <gtkmm/treestore.h>
 #include "common/nmv-safe-ptr.h"
 #include "nmv-ui-utils.h"
+#include "nmv-i-debugger.h"
 
 using nemiver::common::SafePtr;
 
@@ -50,12 +51,30 @@ class NEMIVER_API VarsTreeView : public Gtk::TreeView
         static VarsTreeView* create ();
         Glib::RefPtr<Gtk::TreeStore>& get_tree_store ();
 
+        /// Emitted when the row standing for the children of a
+        /// variable that remain to be unfolded is activated.  The
+        /// argument is the path to the row of the variable.
+        sigc::signal<void, const Gtk::TreeModel::Path&>&
+                                    more_children_requested_signal ();
+
+        void unfold_more_children (const Gtk::TreeModel::Path &a_path,
+                                   IDebugger &a_debugger);
+
     protected:
         VarsTreeView ();
         VarsTreeView (Glib::RefPtr<Gtk::TreeStore>& model);
 
+        void on_row_activated (const Gtk::TreeModel::Path &a_path,
+                               Gtk::TreeViewColumn *a_column);
+
+        void on_more_children_unfolded
+                            (const IDebugger::VariableSafePtr a_var,
+                             const Gtk::TreeModel::Path a_path);
+
     private:
         Glib::RefPtr<Gtk::TreeStore> m_tree_store;
+        sigc::signal<void, const Gtk::TreeModel::Path&>
+                                    m_more_children_requested_signal;
 };
 NEMIVER_END_NAMESPACE (nemiver)
 #endif // __NMV_VARS_TREEVIEW_H__
@@ -23,7 +23,10 @@
  *See COPYRIGHT file copyright information.
  */
 #include "config.h"
+#include <cstring>
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <glib/gi18n.h>
 #include <gtkmm/table.h>
 #include <gtkmm/label.h>
@@ -33,6 +36,9 @@
 #include <gtksourceviewmm.h>
 #include <giomm/file.h>
 #include <giomm/contenttype.h>
+#include <glibmm/dispatcher.h>
+#include <glibmm/thread.h>
+#include <glibmm/timer.h>
 #include "common/nmv-exception.h"
 #include "common/nmv-sequence.h"
 #include "common/nmv-str-utils.h"
@@ -61,6 +67,121 @@ on_line_mark_activated_signal (GtkSourceView *a_view,
                                GdkEvent *a_event,
                                gpointer a_pointer);
 
+/// The addresses of the instructions of an assembly buffer, with the
+/// lines they are at.
+///
+/// Looking up the line of an address is a binary search in this
+/// index, rather than a walk through the text of the buffer.  The
+/// index is attached to the buffer.  add_asm keeps it up to date
+/// incrementally when it appends instructions.  Any other change of
+/// the buffer invalidates it, and so does load_asm; it is then built
+/// again from the text of the buffer the next time it is used.
+struct AsmAddressIndex {
+    // (address, line) pairs, lines starting at 1, sorted by
+    // address then by line.
+    typedef std::pair<Address, size_t> AddrLine;
+    std::vector<AddrLine> entries;
+    bool up_to_date;
+
+    AsmAddressIndex () :
+        up_to_date (false)
+    {
+    }
+
+    bool
+    is_up_to_date () const
+    {
+        return up_to_date;
+    }
+
+    /// Called whenever the buffer changes.
+    void
+    invalidate ()
+    {
+        up_to_date = false;
+    }
+
+    /// Index the instructions found on the lines of a_buf starting at
+    /// a_first_line (starting at 0).  A line holds an instruction if
+    /// it starts with an address, that is, with a "0x" prefixed
+    /// hexadecimal number.  The other lines of the buffer are source
+    /// code lines of mixed source/asm buffers.
+    void
+    add_lines (const Glib::RefPtr<Buffer> &a_buf, int a_first_line)
+    {
+        std::string addr;
+        int nb_lines = a_buf->get_line_count ();
+        for (int line = a_first_line; line < nb_lines; ++line) {
+            addr.clear ();
+            for (Gtk::TextBuffer::iterator it = a_buf->get_iter_at_line (line);
+                 !it.ends_line () && !isspace (it.get_char ());
+                 ++it)
+                addr += (char) it.get_char ();
+            if (addr.size () <= 2
+                || addr.compare (0, 2, "0x")
+                || !str_utils::string_is_hexa_number (addr))
+                continue;
+
+            AddrLine entry (Address (addr), line + 1);
+            if (entries.empty () || !(entry < entries.back ()))
+                entries.push_back (entry);
+            else
+                entries.insert (std::upper_bound (entries.begin (),
+                                                  entries.end (),
+                                                  entry),
+                                entry);
+        }
+        up_to_date = true;
+    }
+
+    void
+    rebuild (const Glib::RefPtr<Buffer> &a_buf)
+    {
+        entries.clear ();
+        add_lines (a_buf, 0);
+    }
+};//end struct AsmAddressIndex
+
+static const char *ASM_ADDRESS_INDEX_KEY = "nemiver-asm-address-index";
+
+static void
+delete_asm_address_index (gpointer a_index)
+{
+    delete static_cast<AsmAddressIndex*> (a_index);
+}
+
+/// Get the address index of an assembly buffer, creating it if need
+/// be.  The index is not necessarily up to date.
+static AsmAddressIndex&
+get_asm_address_index (const Glib::RefPtr<Buffer> &a_buf)
+{
+    THROW_IF_FAIL (a_buf);
+    Glib::Quark key (ASM_ADDRESS_INDEX_KEY);
+    AsmAddressIndex *index =
+        static_cast<AsmAddressIndex*> (a_buf->get_data (key));
+    if (!index) {
+        index = new AsmAddressIndex;
+        a_buf->set_data (key, index, &delete_asm_address_index);
+        // The index lives as long as the buffer, so the connection
+        // never outlives it.
+        a_buf->signal_changed ().connect
+            (sigc::mem_fun (*index, &AsmAddressIndex::invalidate));
+    }
+    return *index;
+}
+
+/// Get the address index of an assembly buffer, up to date.
+static const AsmAddressIndex&
+get_up_to_date_asm_address_index (const Glib::RefPtr<Buffer> &a_buf)
+{
+    AsmAddressIndex &index = get_asm_address_index (a_buf);
+    if (!index.is_up_to_date ()) {
+        LOG_DD ("indexing the addresses of the assembly buffer");
+        index.rebuild (a_buf);
+    }
+    return index;
+}
+
 class SourceView : public Gsv::View
 {
 
@@ -309,7 +430,7 @@ struct SourceEditor::Priv {
         return 0;
     }
 
-    typedef std::pair<Address, size_t> AddrLine;
+    typedef AsmAddressIndex::AddrLine AddrLine;
     typedef std::pair<AddrLine, AddrLine> AddrLineRange;
 
     /// Return the smallest range of address/line pair enclosing the
@@ -334,81 +455,43 @@ struct SourceEditor::Priv {
     get_smallest_range_containing_address (Glib::RefPtr<Buffer> a_buf,
                                            const Address &an_addr,
                                            AddrLineRange &a_range) const
-                                    
     {
-        Gtk::TextBuffer::iterator it = a_buf->begin ();
-        size_t  i;
-        std::string addr;
-        AddrLine lower_bound, upper_bound;
-
-        THROW_IF_FAIL (it.starts_line ());
-
-        while (!it.is_end ()) {
-            // We must always be at the beginning of a line here.
-            THROW_IF_FAIL (it.starts_line ());
-            addr.clear ();
-            for (i = 0;
-                 !isspace (it.get_char ()) && it.ends_line () != true
-                     && i < an_addr.string_size ();
-                 ++it, ++i) {
-                addr += it.get_char ();
-            }
+        const std::vector<AddrLine> &entries =
+            get_up_to_date_asm_address_index (a_buf).entries;
 
-            int match = (addr.compare (an_addr.to_string ()));
+        if (entries.empty ())
+            return common::Range::VALUE_SEARCH_RESULT_NONE;
 
-            if (match < 0
-                && str_utils::string_is_hexa_number (addr)) {
-                lower_bound.first = addr;
-                lower_bound.second = it.get_line () + 1;
-            }
+        // The first entry which address is not lower than an_addr.
+        std::vector<AddrLine>::const_iterator it =
+            std::lower_bound (entries.begin (), entries.end (),
+                              AddrLine (an_addr, 0));
 
-            if (match > 0
-                && str_utils::string_is_hexa_number (addr)) {
-                if (lower_bound.first.empty ()) {
-                    // So we are seing an @ that is greater than
-                    // an_addr without having ever seen an @ that is
-                    // lower than an_addr.  That means all the @s of
-                    // the buffer are greater than an_addr.
-                    a_range.first.first = addr;
-                    a_range.first.second = it.get_line () + 1;
-                    a_range.second = a_range.first;
-                    return common::Range::VALUE_SEARCH_RESULT_BEFORE;
-                } else {
-                    // So the previous @ we saw was lower than
-                    // a_address and this one is greater. it means we
-                    // the buffer does not contain a_address, but
-                    // rather contains at a range of @s that surrounds
-                    // a_address. Return that range.
-                    upper_bound.first = addr;
-                    upper_bound.second = it.get_line () + 1;
-                    a_range.first = lower_bound;
-                    a_range.second = upper_bound;
-                    return common::Range::VALUE_SEARCH_RESULT_WITHIN;
-                }
-            }
+        if (it != entries.end () && it->first == an_addr) {
+            a_range.first = *it;
+            a_range.second = a_range.first;
+            return common::Range::VALUE_SEARCH_RESULT_EXACT;
+        }
 
-            if (match == 0) {
-                a_range.first.first = an_addr;
-                a_range.first.second = it.get_line () + 1;
-                a_range.second = a_range.first;
-                return common::Range::VALUE_SEARCH_RESULT_EXACT;
-            } else {
-                // Go to next line.
-                it.forward_line ();
-            }
+        if (it == entries.begin ()) {
+            // All the @s of the buffer are greater than an_addr.
+            a_range.first = *it;
+            a_range.second = a_range.first;
+            return common::Range::VALUE_SEARCH_RESULT_BEFORE;
         }
 
-        if (!lower_bound.first.empty ()) {
-            if (upper_bound.first.empty ()) {
-                a_range.first.first = lower_bound.first;
-                a_range.second = a_range.first;
-                return common::Range::VALUE_SEARCH_RESULT_AFTER;
-            } else {
-                THROW ("unreachable");
-            }
+        if (it == entries.end ()) {
+            // All the @s of the buffer are lower than an_addr.
+            a_range.first = entries.back ();
+            a_range.second = a_range.first;
+            return common::Range::VALUE_SEARCH_RESULT_AFTER;
         }
-         
-        return common::Range::VALUE_SEARCH_RESULT_NONE;
+
+        // The buffer does not contain an_addr, but rather contains a
+        // range of @s that surrounds it.  Return that range.
+        a_range.first = *(it - 1);
+        a_range.second = *it;
+        return common::Range::VALUE_SEARCH_RESULT_WITHIN;
     }
 
     /// Return the number of the line in a_buf that contains an asm
@@ -1431,12 +1514,309 @@ SourceEditor::create_source_buffer ()
     return result;
 }
 
+// Files bigger than this are loaded without blocking the user
+// interface, by a SourceBufferLoader.
+static const gsize STREAMED_LOADING_THRESHOLD = 512 * 1024;
+
+/// Loads a big file into a source buffer without blocking the user
+/// interface.
+///
+/// The buffer is first filled with as many empty lines as the file
+/// has, so that markers can be put on any line right away.  The
+/// content of the file is then converted to UTF-8 (or just validated)
+/// by a worker thread.  Finally the lines are inserted into their
+/// empty counterparts from an idle callback, a slice at a time.
+/// Source marks have a left gravity, so they stay at the beginning of
+/// their line while its text is inserted.
+///
+/// The loader is attached to the buffer it loads the file into.  It
+/// reports the outcome of the loading to the slot it is given, unless
+/// the loading is cancelled.
+class SourceBufferLoader {
+    // non copyable
+    SourceBufferLoader (const SourceBufferLoader&);
+    SourceBufferLoader& operator= (const SourceBufferLoader&);
+
+    // The maximum duration of a slice of insertions, in seconds.
+    static const double MAX_SLICE_DURATION;
+    // The number of lines inserted between two checks of the duration
+    // of the current slice.
+    enum {NB_LINES_BETWEEN_TIME_CHECKS = 256};
+
+    Gtk::Window &m_parent;
+    std::string m_path;
+    // Not a RefPtr: the loader must not keep alive the buffer it is
+    // attached to.
+    Buffer *m_buffer;
+    GMappedFile *m_mapped_file;
+    std::list<std::string> m_supported_encodings;
+    bool m_enable_syntax_highlight;
+    sigc::slot<void, bool> m_loaded_slot;
+    Glib::Thread *m_thread;
+    Glib::Dispatcher m_content_ready_signal;
+    sigc::connection m_idle_connection;
+    // The result of the worker thread.
+    bool m_content_ok;
+    UString m_content;
+    // The offset in m_content of the next line to insert, and the
+    // number of that line, starting at 0.
+    std::string::size_type m_offset;
+    int m_line;
+    bool m_loading;
+
+    /// Runs in the worker thread.
+    void
+    convert_content ()
+    {
+        const char *contents = g_mapped_file_get_contents (m_mapped_file);
+        std::string input;
+        if (contents)
+            input.assign (contents, g_mapped_file_get_length (m_mapped_file));
+        m_content_ok = str_utils::ensure_buffer_is_in_utf8
+                                        (input,
+                                         m_supported_encodings,
+                                         m_content);
+        m_content_ready_signal.emit ();
+    }
+
+    void
+    on_content_ready ()
+    {
+        NEMIVER_TRY
+
+        if (m_thread) {
+            m_thread->join ();
+            m_thread = 0;
+        }
+        g_mapped_file_unref (m_mapped_file);
+        m_mapped_file = 0;
+
+        if (!m_loading)
+            return;
+
+        if (!m_content_ok) {
+            finish ();
+            UString msg;
+            msg.printf (_("Could not load file %s because its encoding "
+                          "is not supported"),
+                        m_path.c_str ());
+            ui_utils::display_error (m_parent, msg);
+            // The slot might destroy this loader, which must not
+            // happen while m_content_ready_signal is being emitted.
+            m_idle_connection = Glib::signal_idle ().connect
+                (sigc::mem_fun (*this, &SourceBufferLoader::on_failure));
+            return;
+        }
+
+        m_idle_connection = Glib::signal_idle ().connect
+            (sigc::mem_fun (*this, &SourceBufferLoader::insert_next_lines));
+
+        NEMIVER_CATCH
+    }
+
+    bool
+    insert_next_lines ()
+    {
+        NEMIVER_TRY
+
+        const std::string &content = m_content.raw ();
+        Glib::Timer timer;
+        while (m_offset < content.size ()) {
+            const char *begin = content.data () + m_offset;
+            const char *end = static_cast<const char*>
+                (memchr (begin, '\n', content.size () - m_offset));
+            if (!end)
+                end = content.data () + content.size ();
+
+            // The file might have more lines once converted to UTF-8.
+            if (m_line >= m_buffer->get_line_count ())
+                m_buffer->insert (m_buffer->end (), "\n");
+            if (end != begin)
+                m_buffer->insert (m_buffer->get_iter_at_line (m_line),
+                                  begin, end);
+
+            m_offset = end - content.data () + 1;
+            ++m_line;
+            if (m_line % NB_LINES_BETWEEN_TIME_CHECKS == 0
+                && timer.elapsed () > MAX_SLICE_DURATION)
+                return true;
+        }
+        LOG_DD ("file " << m_path << " loaded");
+
+        NEMIVER_CATCH
+
+        finish ();
+        report_loaded (true);
+        return false;
+    }
+
+    bool
+    on_failure ()
+    {
+        report_loaded (false);
+        return false;
+    }
+
+    /// Call the slot given to the loader.  That slot might destroy
+    /// the buffer, and this loader with it, so nothing must be done
+    /// after calling this.
+    void
+    report_loaded (bool a_ok)
+    {
+        sigc::slot<void, bool> slot = m_loaded_slot;
+        slot (a_ok);
+    }
+
+    void
+    finish ()
+    {
+        if (!m_loading)
+            return;
+        m_loading = false;
+        m_idle_connection.disconnect ();
+        m_buffer->end_not_undoable_action ();
+        m_buffer->set_highlight_syntax (m_enable_syntax_highlight);
+        UString empty;
+        m_content.swap (empty);
+    }
+
+public:
+
+    SourceBufferLoader (Gtk::Window &a_parent,
+                        const std::string &a_path,
+                        Glib::RefPtr<Buffer> &a_buffer,
+                        GMappedFile *a_mapped_file,
+                        const std::list<std::string> &a_supported_encodings,
+                        bool a_enable_syntax_highlight,
+                        const sigc::slot<void, bool> &a_loaded_slot) :
+        m_parent (a_parent),
+        m_path (a_path),
+        m_buffer (a_buffer.operator-> ()),
+        m_mapped_file (g_mapped_file_ref (a_mapped_file)),
+        m_supported_encodings (a_supported_encodings),
+        m_enable_syntax_highlight (a_enable_syntax_highlight),
+        m_loaded_slot (a_loaded_slot),
+        m_thread (0),
+        m_content_ok (false),
+        m_offset (0),
+        m_line (0),
+        m_loading (false)
+    {
+    }
+
+    ~SourceBufferLoader ()
+    {
+        // The buffer might be being destroyed; don't touch it.
+        m_idle_connection.disconnect ();
+        if (m_thread)
+            m_thread->join ();
+        if (m_mapped_file)
+            g_mapped_file_unref (m_mapped_file);
+    }
+
+    void
+    start ()
+    {
+        const char *contents = g_mapped_file_get_contents (m_mapped_file);
+        gsize length = g_mapped_file_get_length (m_mapped_file);
+        std::string::size_type nb_newlines = 0;
+        for (const char *p = contents;
+             p && (p = static_cast<const char*>
+                        (memchr (p, '\n', contents + length - p)));
+             ++p)
+            ++nb_newlines;
+
+        m_loading = true;
+        m_buffer->begin_not_undoable_action ();
+        m_buffer->set_highlight_syntax (false);
+        m_buffer->set_text (std::string (nb_newlines, '\n'));
+
+        m_content_ready_signal.connect
+            (sigc::mem_fun (*this, &SourceBufferLoader::on_content_ready));
+        m_thread = Glib::Thread::create
+            (sigc::mem_fun (*this, &SourceBufferLoader::convert_content),
+             true /*joinable*/);
+    }
+
+    /// Stop loading the file.  The lines that are not inserted yet
+    /// are left empty.
+    void
+    cancel ()
+    {
+        if (m_thread) {
+            m_thread->join ();
+            m_thread = 0;
+        }
+        finish ();
+    }
+
+    static const char*
+    key ()
+    {
+        return "nemiver-source-buffer-loader";
+    }
+};//end class SourceBufferLoader
+
+const double SourceBufferLoader::MAX_SLICE_DURATION = 0.01;
+
+static void
+delete_source_buffer_loader (gpointer a_loader)
+{
+    delete static_cast<SourceBufferLoader*> (a_loader);
+}
+
+/// Stop the loading of a file into a_buffer, if any.
+static void
+cancel_source_buffer_loading (Glib::RefPtr<Buffer> &a_buffer)
+{
+    if (!a_buffer)
+        return;
+    Glib::Quark key (SourceBufferLoader::key ());
+    SourceBufferLoader *loader =
+        static_cast<SourceBufferLoader*> (a_buffer->get_data (key));
+    if (loader) {
+        loader->cancel ();
+        a_buffer->remove_data (key);
+    }
+}
+
+/// Load a file into a source buffer.
+///
+/// Big files are loaded without blocking the user interface: the
+/// buffer gets as many lines as the file right away, but the text of
+/// the lines is inserted later, from idle callbacks.  Use the
+/// overload that takes a slot to know whether such a loading
+/// succeeded.
 bool
 SourceEditor::load_file (Gtk::Window &a_parent,
                          const UString &a_path,
                          const std::list<std::string> &a_supported_encodings,
                          bool a_enable_syntax_highlight,
                          Glib::RefPtr<Buffer> &a_source_buffer)
+{
+    return load_file (a_parent, a_path, a_supported_encodings,
+                      a_enable_syntax_highlight, a_source_buffer,
+                      sigc::slot<void, bool> ());
+}
+
+/// Load a file into a source buffer.
+///
+/// \param a_loaded_slot if the function returns true, this slot is
+/// called once the whole text of the file is in a_source_buffer, with
+/// true, or once the loading failed, with false.  Small files are
+/// loaded before the function returns, so the slot is called right
+/// away.  The slot is not called if the loading of a big file is
+/// cancelled by another loading into the same buffer.
+///
+/// \return false if the file could not be loaded.  The slot is not
+/// called then.
+bool
+SourceEditor::load_file (Gtk::Window &a_parent,
+                         const UString &a_path,
+                         const std::list<std::string> &a_supported_encodings,
+                         bool a_enable_syntax_highlight,
+                         Glib::RefPtr<Buffer> &a_source_buffer,
+                         const sigc::slot<void, bool> &a_loaded_slot)
 {
     NEMIVER_TRY;
 
@@ -1458,29 +1838,47 @@ SourceEditor::load_file (Gtk::Window &a_parent,
         return false;
     }
 
+    cancel_source_buffer_loading (a_source_buffer);
+
     if (!setup_buffer_mime_and_lang (a_source_buffer, mime_type)) {
         LOG_ERROR ("Could not setup source buffer mime type or language");
         return false;
     }
     THROW_IF_FAIL (a_source_buffer);
 
-    gint buf_size = 10 * 1024;
-    CharSafePtr buf (new gchar [buf_size + 1]);
-    memset (buf.get (), 0, buf_size + 1);
+    GError *error = 0;
+    GMappedFile *mapped_file =
+        g_mapped_file_new (path.c_str (), FALSE, &error);
+    if (!mapped_file) {
+        LOG_ERROR ("Could not map file " << path << ": "
+                   << (error ? error->message : ""));
+        if (error)
+            g_error_free (error);
+        ui_utils::display_error (a_parent,
+                                 "Could not open file: "
+                                 + Glib::filename_to_utf8 (path));
+        return false;
+    }
+    gsize nb_bytes = g_mapped_file_get_length (mapped_file);
+
+    if (nb_bytes > STREAMED_LOADING_THRESHOLD) {
+        SourceBufferLoader *loader =
+            new SourceBufferLoader (a_parent, path, a_source_buffer,
+                                    mapped_file, a_supported_encodings,
+                                    a_enable_syntax_highlight,
+                                    a_loaded_slot);
+        g_mapped_file_unref (mapped_file);
+        a_source_buffer->set_data (Glib::Quark (SourceBufferLoader::key ()),
+                                   loader, &delete_source_buffer_loader);
+        loader->start ();
+        LOG_DD ("loading " << (int) nb_bytes << " bytes in the background");
+        return true;
+    }
 
-    unsigned nb_bytes=0;
     std::string content;
-
-    Glib::RefPtr<Gio::FileInputStream> gio_stream = gio_file->read ();
-    THROW_IF_FAIL (gio_stream);
-    gssize bytes_read = 0;
-    for (;;) {
-        bytes_read = gio_stream->read (buf.get (), buf_size);
-        content.append (buf.get (), bytes_read);
-        nb_bytes += bytes_read;
-        if (bytes_read != buf_size) {break;}
-    }
-    gio_stream->close ();
+    if (g_mapped_file_get_contents (mapped_file))
+        content.assign (g_mapped_file_get_contents (mapped_file), nb_bytes);
+    g_mapped_file_unref (mapped_file);
 
     UString utf8_content;
     std::string cur_charset;
@@ -1502,6 +1900,7 @@ SourceEditor::load_file (Gtk::Window &a_parent,
 
     NEMIVER_CATCH_AND_RETURN (false);
 
+    a_loaded_slot (true);
     return true;
 }
 
@@ -1577,6 +1976,14 @@ SourceEditor::add_asm (Gtk::Window &a_parent_window,
     bool first_written = write_asm_instr (*it, reader, first_os);
     endl_os << std::endl;
 
+    // Appended instructions are indexed incrementally: inserting them
+    // invalidates the index, which add_lines makes up to date again
+    // below.  Prepended ones shift the lines of the whole buffer, so
+    // the index is rather built again when it is next used.
+    AsmAddressIndex &index = get_asm_address_index (a_buf);
+    if (a_append && !index.is_up_to_date ())
+        index.rebuild (a_buf);
+
     // Figure out where to insert the asm instrs, depending on a_append
     // (either prepend or append it)
     // Also, if a_buf is not empty and we are going to append asm
@@ -1591,6 +1998,7 @@ SourceEditor::add_asm (Gtk::Window &a_parent_window,
     } else {
         insert_it = a_buf->begin ();
     }
+    int first_new_line = insert_it.get_line ();
     // Really insert the the first asm instrs.
     if (first_written)
         insert_it = a_buf->insert (insert_it, first_os.str ());
@@ -1608,6 +2016,9 @@ SourceEditor::add_asm (Gtk::Window &a_parent_window,
         prev_written = write_asm_instr (*it, reader, os);
         insert_it = a_buf->insert (insert_it, os.str ());
     }
+
+    if (a_append)
+        index.add_lines (a_buf, first_new_line);
     return true;
 }
 
@@ -1662,6 +2073,11 @@ SourceEditor::load_asm (Gtk::Window &a_parent_window,
     }
     THROW_IF_FAIL (a_buf);
 
+    // The buffer might have been loaded with other instructions
+    // since it was last indexed.
+    if (!a_append)
+        get_asm_address_index (a_buf).invalidate ();
+
     add_asm (a_parent_window,
              a_info, a_asm, a_append,
              a_src_search_dirs,
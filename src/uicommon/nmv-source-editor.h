@@ -134,6 +134,13 @@ public:
 			   bool a_enable_syntaxt_highlight,
 			   Glib::RefPtr<Buffer> &a_source_buffer);
 
+    static bool load_file (Gtk::Window &a_parent,
+			   const UString &a_path,
+			   const std::list<std::string> &a_supported_encodings,
+			   bool a_enable_syntaxt_highlight,
+			   Glib::RefPtr<Buffer> &a_source_buffer,
+			   const sigc::slot<void, bool> &a_loaded_slot);
+
     /// \name Assembly source buffer handling.
     /// @{
 
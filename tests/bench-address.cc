@@ -0,0 +1,124 @@
+#include "config.h"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <glibmm.h>
+#include "common/nmv-initializer.h"
+#include "common/nmv-exception.h"
+#include "common/nmv-address.h"
+#include "common/nmv-range.h"
+
+using nemiver::common::Address;
+using nemiver::common::Range;
+using nemiver::common::Initializer;
+
+// The number of instructions of a big disassembled function.
+static const int NB_ADDRESSES = 200000;
+
+// Build the addresses of NB_ADDRESSES instructions of varying sizes,
+// written the way GDB writes them in disassembly results.
+static void
+build_instruction_addresses (std::vector<std::string> &a_addresses)
+{
+    char buf[32];
+    unsigned long long addr = 0x400000;
+    for (int i = 0; i < NB_ADDRESSES; ++i) {
+        snprintf (buf, sizeof (buf), "0x%016llx", addr);
+        a_addresses.push_back (buf);
+        addr += 1 + i % 7;
+    }
+}
+
+BOOST_AUTO_TEST_SUITE (bench_address)
+
+// The disassembler sorts the addresses of the instructions it gets.
+BOOST_AUTO_TEST_CASE (bench_address_sort)
+{
+    std::vector<std::string> strings;
+    build_instruction_addresses (strings);
+    std::vector<Address> addresses;
+    addresses.reserve (strings.size ());
+    Glib::Timer timer;
+    for (size_t i = 0; i < strings.size (); ++i)
+        addresses.push_back (Address (strings[i]));
+    double parse_time = timer.elapsed ();
+
+    std::reverse (addresses.begin (), addresses.end ());
+    timer.start ();
+    std::sort (addresses.begin (), addresses.end ());
+    double sort_time = timer.elapsed ();
+
+    for (size_t i = 0; i < addresses.size (); ++i)
+        BOOST_REQUIRE (addresses[i] == strings[i]);
+
+    BOOST_TEST_MESSAGE ("parsed " << NB_ADDRESSES << " addresses in "
+                        << parse_time << "s, sorted them in "
+                        << sort_time << "s");
+}
+
+// The source editor looks the line of an address up in the
+// addresses of the disassembly buffer, and the breakpoints are
+// matched against the addresses of the frames.
+BOOST_AUTO_TEST_CASE (bench_address_lookup)
+{
+    std::vector<std::string> strings;
+    build_instruction_addresses (strings);
+    std::vector<Address> addresses;
+    std::map<Address, int> breakpoints;
+    for (size_t i = 0; i < strings.size (); ++i) {
+        addresses.push_back (Address (strings[i]));
+        if (i % 100 == 0)
+            breakpoints[addresses.back ()] = i;
+    }
+
+    Glib::Timer timer;
+    int nb_found = 0;
+    for (size_t i = 0; i < addresses.size (); ++i) {
+        std::vector<Address>::const_iterator it =
+            std::lower_bound (addresses.begin (), addresses.end (),
+                              addresses[i]);
+        if (it != addresses.end () && *it == addresses[i])
+            ++nb_found;
+    }
+    double lower_bound_time = timer.elapsed ();
+    BOOST_REQUIRE_EQUAL (nb_found, NB_ADDRESSES);
+
+    timer.start ();
+    int nb_breakpoints = 0;
+    for (size_t i = 0; i < addresses.size (); ++i)
+        if (breakpoints.find (addresses[i]) != breakpoints.end ())
+            ++nb_breakpoints;
+    double map_time = timer.elapsed ();
+    BOOST_REQUIRE_EQUAL (nb_breakpoints, (NB_ADDRESSES + 99) / 100);
+
+    timer.start ();
+    Range range (addresses[NB_ADDRESSES / 4], addresses[NB_ADDRESSES / 2]);
+    int nb_contained = 0;
+    for (size_t i = 0; i < addresses.size (); ++i)
+        if (range.contains (addresses[i]))
+            ++nb_contained;
+    double range_time = timer.elapsed ();
+    BOOST_REQUIRE_EQUAL (nb_contained, NB_ADDRESSES / 4 + 1);
+
+    BOOST_TEST_MESSAGE ("looked " << NB_ADDRESSES << " addresses up in "
+                        << lower_bound_time << "s by binary search, in "
+                        << map_time << "s in a map of breakpoints; "
+                        << "range checks took " << range_time << "s");
+}
+
+bool
+init_unit_test ()
+{
+    NEMIVER_TRY
+
+    Initializer::do_init ();
+
+    NEMIVER_CATCH_NOX
+
+    return 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,82 @@
+#include "config.h"
+#include <cstdio>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <glibmm.h>
+#include "common/nmv-initializer.h"
+#include "common/nmv-exception.h"
+#include "common/nmv-interned-string.h"
+#include "nmv-i-debugger.h"
+
+using nemiver::common::Initializer;
+using nemiver::common::InternedString;
+using nemiver::IDebugger;
+
+// The number of call stacks the benchmark keeps, and their depth.
+static const int NB_STACKS = 1000;
+static const int STACK_DEPTH = 200;
+
+// Build a call stack of a recursive program, as the perspective gets
+// it each time the inferior stops.
+static void
+build_stack (std::vector<IDebugger::Frame> &a_stack)
+{
+    char name[64];
+    for (int i = 0; i < STACK_DEPTH; ++i) {
+        IDebugger::Frame frame;
+        snprintf (name, sizeof (name), "walk_tree_level_%d", i % 10);
+        frame.function_name (name);
+        frame.file_name ("tree-walker.cc");
+        frame.file_full_name ("/home/user/src/project/lib/tree-walker.cc");
+        frame.level (i);
+        frame.line (100 + i % 10);
+        a_stack.push_back (frame);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE (bench_interned_string)
+
+// The frames of the call stacks share their names, and comparing
+// two frames compares the handles of the names.
+BOOST_AUTO_TEST_CASE (bench_frame_names)
+{
+    size_t table_size = InternedString::table_size ();
+
+    Glib::Timer timer;
+    std::vector<std::vector<IDebugger::Frame> > stacks (NB_STACKS);
+    for (int i = 0; i < NB_STACKS; ++i)
+        build_stack (stacks[i]);
+    double build_time = timer.elapsed ();
+
+    // Ten function names and two file names.
+    BOOST_REQUIRE_EQUAL (InternedString::table_size () - table_size, 12u);
+    BOOST_REQUIRE (&stacks[0][0].file_full_name ()
+                   == &stacks[NB_STACKS - 1][0].file_full_name ());
+
+    timer.start ();
+    int nb_equal_frames = 0;
+    for (int i = 1; i < NB_STACKS; ++i)
+        for (int j = 0; j < STACK_DEPTH; ++j)
+            if (stacks[i][j] == stacks[i - 1][j])
+                ++nb_equal_frames;
+    double compare_time = timer.elapsed ();
+    BOOST_REQUIRE_EQUAL (nb_equal_frames, (NB_STACKS - 1) * STACK_DEPTH);
+
+    BOOST_TEST_MESSAGE ("built " << NB_STACKS << " stacks of "
+                        << STACK_DEPTH << " frames in " << build_time
+                        << "s, compared them in " << compare_time << "s");
+}
+
+bool
+init_unit_test ()
+{
+    NEMIVER_TRY
+
+    Initializer::do_init ();
+
+    NEMIVER_CATCH_NOX
+
+    return 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,178 @@
+#include "config.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <glibmm.h>
+#include <glib/gstdio.h>
+#include "common/nmv-initializer.h"
+#include "common/nmv-exception.h"
+#include "common/nmv-log-stream-utils.h"
+
+using nemiver::common::Initializer;
+using nemiver::common::LogStream;
+using nemiver::common::ScopeLogger;
+
+static const char *BENCH_DOMAIN = "log-bench-domain";
+
+// The number of iterations of the instrumented hot loop.
+static const int NB_STEPS = 10000000;
+
+// The number of threads logging to the same stream, and the number of
+// lines each of them logs.
+static const int NB_LOGGING_THREADS = 4;
+static const int NB_LINES_PER_THREAD = 20000;
+
+static int s_nb_formatted = 0;
+static volatile int s_sink = 0;
+
+static int
+count_formatting ()
+{
+    return ++s_nb_formatted;
+}
+
+static void
+plain_step (int a_i)
+{
+    s_sink = s_sink + a_i;
+}
+
+static void
+logged_step (int a_i)
+{
+    LOG_SCOPE_NORMAL_D ("logged_step", BENCH_DOMAIN);
+    LOG_D ("step " << a_i << ", formatted " << count_formatting (),
+           BENCH_DOMAIN);
+    s_sink = s_sink + a_i;
+}
+
+// What the logging macros used to expand to: the scope logger and
+// the message were always built, and only the log stream tested the
+// domain.
+static void
+unconditionally_logged_step (int a_i)
+{
+    ScopeLogger scope_logger ("unconditionally_logged_step",
+                              LogStream::LOG_LEVEL_NORMAL,
+                              BENCH_DOMAIN);
+    LOG_STREAM.push_domain (BENCH_DOMAIN);
+    LOG ("step " << a_i);
+    LOG_STREAM.pop_domain ();
+    s_sink = s_sink + a_i;
+}
+
+static void
+log_lines (LogStream *a_stream, int a_thread)
+{
+    char line[64];
+    for (int i = 0; i < NB_LINES_PER_THREAD; ++i) {
+        snprintf (line, sizeof (line), "thread %d line %d\n", a_thread, i);
+        a_stream->write (line);
+    }
+}
+
+// Return the time NB_LOGGING_THREADS threads take to log
+// NB_LINES_PER_THREAD lines each into a new stream of type a_type.
+static double
+time_log_lines_to_file (LogStream::StreamType a_type,
+                        const std::string &a_path)
+{
+    LogStream::set_stream_type (a_type);
+    LogStream::set_stream_file_path (a_path.c_str ());
+    LogStream *stream = new LogStream;
+
+    Glib::Timer timer;
+    std::vector<Glib::Thread*> threads;
+    for (int i = 0; i < NB_LOGGING_THREADS; ++i)
+        threads.push_back (Glib::Thread::create
+                           (sigc::bind (sigc::ptr_fun (log_lines),
+                                        stream, i),
+                            true /*joinable*/));
+    for (size_t i = 0; i < threads.size (); ++i)
+        threads[i]->join ();
+    double log_time = timer.elapsed ();
+
+    delete stream;
+    LogStream::set_stream_type (LogStream::COUT_STREAM);
+    g_remove (a_path.c_str ());
+    return log_time;
+}
+
+BOOST_AUTO_TEST_SUITE (bench_log_stream)
+
+// The scope and message logging of the engine and of the perspective
+// sit in hot paths, with their domains disabled most of the time.
+BOOST_AUTO_TEST_CASE (bench_disabled_logging)
+{
+    LOG_STREAM.enable_domain ("all", false);
+    LOG_STREAM.enable_domain (BENCH_DOMAIN, false);
+    s_nb_formatted = 0;
+
+    Glib::Timer timer;
+    for (int i = 0; i < NB_STEPS; ++i)
+        plain_step (i);
+    double plain_time = timer.elapsed ();
+
+    timer.start ();
+    for (int i = 0; i < NB_STEPS; ++i)
+        logged_step (i);
+    double logged_time = timer.elapsed ();
+    BOOST_REQUIRE_EQUAL (s_nb_formatted, 0);
+
+    // The former expansion is way slower, so run it less often.
+    int nb_unconditional_steps = NB_STEPS / 100;
+    timer.start ();
+    for (int i = 0; i < nb_unconditional_steps; ++i)
+        unconditionally_logged_step (i);
+    double unconditional_time = timer.elapsed ();
+
+    BOOST_TEST_MESSAGE ("ran " << NB_STEPS << " steps in "
+                        << plain_time << "s without logging, in "
+                        << logged_time << "s with disabled logging; "
+                        << "unconditional logging costs "
+                        << unconditional_time * 1e9 / nb_unconditional_steps
+                        << "ns per step, disabled logging "
+                        << (logged_time - plain_time) * 1e9 / NB_STEPS
+                        << "ns per step");
+}
+
+// Logging through the queue of an asynchronous stream must cost the
+// threads less than writing to the file themselves.
+BOOST_AUTO_TEST_CASE (bench_async_stream)
+{
+    std::string path = Glib::build_filename (Glib::get_tmp_dir (),
+                                             "nemiver-bench-log-stream.txt");
+
+    double sync_time = time_log_lines_to_file (LogStream::FILE_STREAM, path);
+
+    g_setenv ("NMV_LOG_ASYNC", "block", true);
+    g_setenv ("NMV_LOG_ASYNC_CAPACITY", "64", true);
+    double async_time =
+        time_log_lines_to_file (LogStream::ASYNC_FILE_STREAM, path);
+    g_unsetenv ("NMV_LOG_ASYNC_CAPACITY");
+    double big_queue_async_time =
+        time_log_lines_to_file (LogStream::ASYNC_FILE_STREAM, path);
+    g_unsetenv ("NMV_LOG_ASYNC");
+
+    BOOST_TEST_MESSAGE (NB_LOGGING_THREADS << " threads logged "
+                        << NB_LINES_PER_THREAD << " lines each in "
+                        << sync_time << "s to a file, in "
+                        << async_time << "s through a queue of 64 "
+                        << "messages, in " << big_queue_async_time
+                        << "s through the default queue");
+}
+
+bool
+init_unit_test ()
+{
+    NEMIVER_TRY
+
+    Initializer::do_init ();
+
+    NEMIVER_CATCH_NOX
+
+    return 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
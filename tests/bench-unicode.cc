@@ -0,0 +1,67 @@
+#include "config.h"
+#include <list>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include <glibmm.h>
+#include "common/nmv-ustring.h"
+#include "common/nmv-initializer.h"
+#include "common/nmv-exception.h"
+#include "common/nmv-str-utils.h"
+
+using namespace nemiver;
+using nemiver::common::Initializer;
+using nemiver::common::UString;
+
+// Build a source file of about a_size bytes, whose comments contain
+// a_word.
+static void
+build_source (const std::string &a_word, size_t a_size, std::string &a_source)
+{
+    a_source.clear ();
+    while (a_source.size () < a_size) {
+        a_source += "    // Compute the " + a_word + " value.\n";
+        a_source += "    result += compute (i, " + a_word.substr (0, 1) + ");\n";
+    }
+}
+
+BOOST_AUTO_TEST_SUITE (bench_unicode)
+
+// Every source file goes through ensure_buffer_is_in_utf8 when it is
+// opened or reloaded.
+BOOST_AUTO_TEST_CASE (bench_ensure_buffer_is_in_utf8)
+{
+    static const size_t SOURCE_SIZE = 4 * 1024 * 1024;
+    static const char *words[] = {"plain", "caf\xc3\xa9", "caf\xe9"};
+    static const char *names[] = {"ASCII", "UTF-8", "Latin-1"};
+    std::list<std::string> encodings;
+    encodings.push_back ("UTF-8");
+    encodings.push_back ("ISO-8859-15");
+
+    for (unsigned i = 0; i < sizeof (words) / sizeof (words[0]); ++i) {
+        std::string source;
+        build_source (words[i], SOURCE_SIZE, source);
+        UString output;
+        Glib::Timer timer;
+        BOOST_REQUIRE (str_utils::ensure_buffer_is_in_utf8 (source,
+                                                            encodings,
+                                                            output));
+        double elapsed = timer.elapsed ();
+        BOOST_REQUIRE (output.bytes () >= source.size ());
+        BOOST_TEST_MESSAGE ("made " << source.size () << " bytes of "
+                            << names[i] << " source UTF-8 in "
+                            << elapsed << "s");
+    }
+}
+
+NEMIVER_API bool init_unit_test ()
+{
+    NEMIVER_TRY
+
+    Initializer::do_init ();
+
+    NEMIVER_CATCH_NOX
+
+    return 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
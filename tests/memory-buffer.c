@@ -0,0 +1,20 @@
+#include <string.h>
+
+#define BUFFER_SIZE 8192
+
+unsigned char buffer[BUFFER_SIZE];
+unsigned long buffer_addr;
+
+void
+buffer_ready (void)
+{
+}
+
+int
+main ()
+{
+  memset (buffer, 0, sizeof (buffer));
+  buffer_addr = (unsigned long) buffer;
+  buffer_ready ();
+  return buffer[0];
+}
@@ -0,0 +1,89 @@
+#include "config.h"
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include "common/nmv-initializer.h"
+#include "common/nmv-exception.h"
+#include "common/nmv-address.h"
+#include "common/nmv-range.h"
+
+using nemiver::common::Address;
+using nemiver::common::Range;
+using nemiver::common::Initializer;
+
+BOOST_AUTO_TEST_SUITE (test_address)
+
+BOOST_AUTO_TEST_CASE (test_address_format)
+{
+    Address a ("0x000013a0");
+    BOOST_REQUIRE_EQUAL ((size_t) a, 0x13a0u);
+    BOOST_REQUIRE_EQUAL (a.to_string (), "0x000013a0");
+    BOOST_REQUIRE_EQUAL (a.size (), 8u);
+    BOOST_REQUIRE_EQUAL (a.string_size (), 10u);
+    BOOST_REQUIRE (a == std::string ("0x000013a0"));
+    BOOST_REQUIRE_EQUAL (a[2], '0');
+    BOOST_REQUIRE_EQUAL (a[6], '1');
+
+    // Surrounding white spaces are ignored, and digits without
+    // prefix are hexadecimal digits.
+    a = " 1234\n";
+    BOOST_REQUIRE_EQUAL ((size_t) a, 0x1234u);
+    BOOST_REQUIRE_EQUAL (a.to_string (), "1234");
+
+    a = "0XdeadBEEF";
+    BOOST_REQUIRE_EQUAL ((size_t) a, 0xdeadbeefu);
+    BOOST_REQUIRE_EQUAL (a.to_string (), "0xdeadbeef");
+
+    BOOST_REQUIRE_EQUAL (Address (0x2aUL).to_string (), "0x2a");
+    BOOST_REQUIRE_EQUAL (Address (0UL).to_string (), "0x0");
+
+    a = "";
+    BOOST_REQUIRE (a.empty ());
+    BOOST_REQUIRE_EQUAL ((size_t) a, 0u);
+    BOOST_REQUIRE (a.to_string ().empty ());
+    a = "0x10";
+    a.clear ();
+    BOOST_REQUIRE (a.empty ());
+
+    bool thrown = false;
+    try {
+        a = "main";
+    } catch (...) {
+        thrown = true;
+    }
+    BOOST_REQUIRE (thrown);
+}
+
+BOOST_AUTO_TEST_CASE (test_address_compare)
+{
+    Address a ("0x0000000000400010"), b ("0x400020"), c ("400010");
+    BOOST_REQUIRE (a < b);
+    BOOST_REQUIRE (a <= b);
+    BOOST_REQUIRE (b > a);
+    BOOST_REQUIRE (b >= a);
+    BOOST_REQUIRE (a == c);
+    BOOST_REQUIRE (a == 0x400010UL);
+    // Addresses are compared with strings by value.
+    BOOST_REQUIRE (a == std::string ("0x400010"));
+    BOOST_REQUIRE (a == std::string ("0X0000000000400010"));
+    BOOST_REQUIRE (a == std::string (" 400010\n"));
+    BOOST_REQUIRE (!(a == std::string ("0x400011")));
+    BOOST_REQUIRE (!(a == std::string ("main")));
+    BOOST_REQUIRE (!(a == std::string ("")));
+    BOOST_REQUIRE (Address () == std::string (""));
+    BOOST_REQUIRE (!(Address () == std::string ("0x0")));
+    BOOST_REQUIRE (Range (a, b).contains (Address ("0x400018")));
+}
+
+bool
+init_unit_test ()
+{
+    NEMIVER_TRY
+
+    Initializer::do_init ();
+
+    NEMIVER_CATCH_NOX
+
+    return 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,8 +1,12 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <list>
 #include <map>
+#include <sstream>
 #include <boost/test/unit_test.hpp>
 #include "dbgengine/nmv-gdbmi-parser.h"
+#include "dbgengine/nmv-dbg-common.h"
 #include "common/nmv-exception.h"
 #include "common/nmv-initializer.h"
 #include "common/nmv-asm-utils.h"
@@ -65,6 +69,10 @@ static const char *gv_output_record8="^done,changelist=[]\n";
 
 static const char *gv_output_record9="^done,changelist=[{name=\"var1\",value=\"{...}\",in_scope=\"true\",type_changed=\"false\",new_num_children=\"2\",displayhint=\"array\",dynamic=\"1\",has_more=\"0\",new_children=[{name=\"var1.[1]\",exp=\"[1]\",numchild=\"0\",value=\" \\\"fila\\\"\",type=\"std::basic_string<char, std::char_traits<char>, std::allocator<char> >\",thread-id=\"1\",displayhint=\"string\",dynamic=\"1\"}]},{name=\"var1.[0]\",value=\"\\\"k\\303\\251l\\303\\251\\\"\",in_scope=\"true\",type_changed=\"false\",displayhint=\"array\",dynamic=\"1\",has_more=\"0\"}]\n";
 
+// The output of -var-list-children --all-values var1 0 2, on an
+// array of 1000 integers.
+static const char *gv_output_record10="^done,numchild=\"2\",children=[child={name=\"var1.0\",exp=\"0\",numchild=\"0\",value=\"3\",type=\"int\",thread-id=\"1\"},child={name=\"var1.1\",exp=\"1\",numchild=\"0\",value=\"5\",type=\"int\",thread-id=\"1\"}],has_more=\"1\"\n";
+
 static const char *gv_stack0 =
 "stack=[frame={level=\"0\",addr=\"0x000000330f832f05\",func=\"raise\",file=\"../nptl/sysdeps/unix/sysv/linux/raise.c\",fullname=\"/usr/src/debug/glibc-20081113T2206/nptl/sysdeps/unix/sysv/linux/raise.c\",line=\"64\"},frame={level=\"1\",addr=\"0x000000330f834a73\",func=\"abort\",file=\"abort.c\",fullname=\"/usr/src/debug/glibc-20081113T2206/stdlib/abort.c\",line=\"88\"},frame={level=\"2\",addr=\"0x0000000000400872\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"7\"},frame={level=\"3\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"4\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"5\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"6\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"7\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"8\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"9\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"10\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"11\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"12\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"13\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"14\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"15\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"16\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"17\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"18\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"19\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"20\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"21\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"22\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"23\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"24\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"},frame={level=\"25\",addr=\"0x000000000040087e\",func=\"overflow_after_n_recursions\",file=\"do-stack-overflow.cc\",fullname=\"/home/dodji/devel/git/nemiver.git/tests/do-stack-overflow.cc\",line=\"8\"}]";
 
@@ -133,6 +141,11 @@ static const char* gv_register_values =
 static const char* gv_memory_values =
 "addr=\"0x000013a0\",nr-bytes=\"32\",total-bytes=\"32\",next-row=\"0x000013c0\",prev-row=\"0x0000139c\",next-page=\"0x000013c0\",prev-page=\"0x00001380\",memory=[{addr=\"0x000013a0\",data=[\"0x10\",\"0x11\",\"0x12\",\"0x13\"],ascii=\"xxxx\"}]";
 
+static const char* gv_memory_bytes =
+"memory=[{begin=\"0x00001000\",offset=\"0x00000000\",end=\"0x00001004\",contents=\"0a1b2c3d\"},{begin=\"0x00001004\",offset=\"0x00000004\",end=\"0x00001006\",contents=\"ff00\"}]";
+
+static const char* gv_stack_depth = "depth=\"12\"";
+
 static const char* gv_gdbmi_result0 = "variable=[\"foo\", \"bar\"]";
 static const char* gv_gdbmi_result1 = "variable";
 static const char* gv_gdbmi_result2 = "\"variable\"";
@@ -356,6 +369,41 @@ BOOST_AUTO_TEST_CASE (test_var_list_children)
     BOOST_REQUIRE (vars.size () == 2);
 }
 
+BOOST_AUTO_TEST_CASE (test_var_list_children_window)
+{
+    bool is_ok=false;
+    UString::size_type to=0;
+    Output output;
+
+    GDBMIParser parser (gv_output_record10);
+    is_ok = parser.parse_output_record (0, to, output);
+    BOOST_REQUIRE (is_ok);
+    BOOST_REQUIRE (output.result_record ().has_variable_children ());
+    BOOST_REQUIRE_EQUAL
+        (output.result_record ().variable_children ().size (), 2u);
+    BOOST_REQUIRE (output.result_record ().has_more_variable_children ());
+
+    // Unfolding the first window of the children of the array leaves
+    // the other ones to unfold.
+    IDebugger::VariableSafePtr array
+        (new IDebugger::Variable ("var1", "a", "", "int [1000]"));
+    array->num_expected_children (1000);
+    BOOST_REQUIRE (array->needs_unfolding ());
+    BOOST_REQUIRE (!array->needs_more_unfolding ());
+    for (unsigned i = 0;
+         i < output.result_record ().variable_children ().size ();
+         ++i)
+        array->append (output.result_record ().variable_children ()[i]);
+    BOOST_REQUIRE (!array->needs_unfolding ());
+    BOOST_REQUIRE (array->needs_more_unfolding ());
+
+    // The previous results are dropped when parsing a new output.
+    parser.push_input (gv_output_record6);
+    is_ok = parser.parse_output_record (0, to, output);
+    BOOST_REQUIRE (is_ok);
+    BOOST_REQUIRE (!output.result_record ().has_more_variable_children ());
+}
+
 BOOST_AUTO_TEST_CASE (test_output_record)
 {
     bool is_ok=false;
@@ -459,6 +507,35 @@ BOOST_AUTO_TEST_CASE (test_output_record)
     }
 }
 
+BOOST_AUTO_TEST_CASE (test_output_record_token)
+{
+    UString::size_type to = 0;
+    Output output;
+    GDBMIParser parser;
+
+    // The token of the result record is kept, the ones of the async
+    // records are skipped.
+    parser.push_input ("42*running,thread-id=\"all\"\n"
+                       "=thread-group-started,id=\"i1\",pid=\"123\"\n"
+                       "1234^done,value=\"7\"\n(gdb)");
+    BOOST_REQUIRE (parser.parse_output_record (0, to, output));
+    BOOST_REQUIRE (output.has_out_of_band_record ());
+    BOOST_REQUIRE_EQUAL (output.out_of_band_records ().size (), 2u);
+    BOOST_REQUIRE (output.has_result_record ());
+    BOOST_REQUIRE_EQUAL (output.result_record ().token (), 1234u);
+    BOOST_REQUIRE (output.result_record ().kind ()
+                   == Output::ResultRecord::DONE);
+    parser.pop_input ();
+
+    parser.push_input ("^error,msg=\"No symbol table is loaded.\"\n(gdb)");
+    BOOST_REQUIRE (parser.parse_output_record (0, to, output));
+    BOOST_REQUIRE (output.has_result_record ());
+    BOOST_REQUIRE_EQUAL (output.result_record ().token (), 0u);
+    BOOST_REQUIRE (output.result_record ().kind ()
+                   == Output::ResultRecord::ERROR);
+    parser.pop_input ();
+}
+
 BOOST_AUTO_TEST_CASE (test_stack0)
 {
     UString::size_type to = 0;
@@ -817,6 +894,256 @@ BOOST_AUTO_TEST_CASE (test_memory_values)
     BOOST_REQUIRE_EQUAL (*mem_iter, 0x13u);
 }
 
+BOOST_AUTO_TEST_CASE (test_memory_bytes)
+{
+    std::vector<uint8_t> mem_values;
+    size_t start_addr = 0;
+    UString::size_type cur = 0;
+
+    GDBMIParser parser (gv_memory_bytes);
+    BOOST_REQUIRE (parser.parse_memory_bytes (cur, cur,
+                                              start_addr, mem_values));
+    BOOST_REQUIRE_EQUAL (start_addr, 0x1000u);
+    BOOST_REQUIRE_EQUAL (mem_values.size (), 6u);
+    BOOST_REQUIRE_EQUAL (mem_values[0], 0x0au);
+    BOOST_REQUIRE_EQUAL (mem_values[3], 0x3du);
+    BOOST_REQUIRE_EQUAL (mem_values[4], 0xffu);
+    BOOST_REQUIRE_EQUAL (mem_values[5], 0x00u);
+}
+
+BOOST_AUTO_TEST_CASE (test_memory_cache)
+{
+    const size_t page_size = MemoryCache::CACHE_PAGE_SIZE;
+    MemoryCache cache;
+    std::list<MemoryCache::Range> ranges;
+    std::vector<uint8_t> values;
+
+    // Nothing is cached: the request is widened to whole pages.
+    cache.get_missing_ranges (page_size + 10, page_size, ranges);
+    BOOST_REQUIRE_EQUAL (ranges.size (), 1u);
+    BOOST_REQUIRE_EQUAL (ranges.front ().first, page_size);
+    BOOST_REQUIRE_EQUAL (ranges.front ().second, 2 * page_size);
+    BOOST_REQUIRE_EQUAL (cache.nb_misses (), 2u);
+    BOOST_REQUIRE (!cache.read (page_size + 10, page_size, values));
+
+    std::vector<uint8_t> memory (2 * page_size);
+    for (size_t i = 0; i < memory.size (); ++i)
+        memory[i] = static_cast<uint8_t> (i);
+    unsigned long stamp = cache.clock ();
+    cache.store (page_size, memory, stamp);
+    BOOST_REQUIRE_EQUAL (cache.nb_pages (), 2u);
+
+    ranges.clear ();
+    cache.get_missing_ranges (page_size + 10, page_size, ranges);
+    BOOST_REQUIRE (ranges.empty ());
+    BOOST_REQUIRE_EQUAL (cache.nb_hits (), 2u);
+    BOOST_REQUIRE (cache.read (page_size + 10, page_size, values));
+    BOOST_REQUIRE_EQUAL (values.size (), page_size);
+    BOOST_REQUIRE_EQUAL (values[0], 10u);
+    BOOST_REQUIRE (std::equal (values.begin (), values.end (),
+                               memory.begin () + 10));
+
+    // Writing a byte forgets about its page only.
+    cache.invalidate (2 * page_size + 1, 1);
+    BOOST_REQUIRE_EQUAL (cache.nb_pages (), 1u);
+    ranges.clear ();
+    cache.get_missing_ranges (0, 3 * page_size, ranges);
+    BOOST_REQUIRE_EQUAL (ranges.size (), 2u);
+    BOOST_REQUIRE_EQUAL (ranges.front ().first, 0u);
+    BOOST_REQUIRE_EQUAL (ranges.back ().first, 2 * page_size);
+
+    // Memory requested before the write is stale for the written
+    // page only.
+    BOOST_REQUIRE (cache.invalidated_since (2 * page_size, 1, stamp));
+    BOOST_REQUIRE (!cache.invalidated_since (page_size, page_size, stamp));
+    cache.store (page_size, memory, stamp);
+    BOOST_REQUIRE_EQUAL (cache.nb_pages (), 1u);
+    BOOST_REQUIRE (!cache.read (2 * page_size, 1, values));
+    cache.store (page_size, memory, cache.clock ());
+    BOOST_REQUIRE_EQUAL (cache.nb_pages (), 2u);
+
+    // Memory requested before a full invalidation is stale
+    // everywhere.
+    stamp = cache.clock ();
+    cache.invalidate ();
+    BOOST_REQUIRE_EQUAL (cache.nb_pages (), 0u);
+    BOOST_REQUIRE (cache.invalidated_since (0, 1, stamp));
+    cache.store (page_size, memory, stamp);
+    BOOST_REQUIRE_EQUAL (cache.nb_pages (), 0u);
+}
+
+BOOST_AUTO_TEST_CASE (test_memory_cache_eviction)
+{
+    const size_t page_size = MemoryCache::CACHE_PAGE_SIZE;
+    MemoryCache cache (2);
+    std::list<MemoryCache::Range> ranges;
+    std::vector<uint8_t> page (page_size, 1), values;
+
+    cache.store (0, page, cache.clock ());
+    cache.store (page_size, page, cache.clock ());
+    BOOST_REQUIRE_EQUAL (cache.nb_pages (), 2u);
+
+    // Looking the first page up makes it the most recently used, so
+    // the second one is dropped to make room for a third one.
+    cache.get_missing_ranges (0, 1, ranges);
+    BOOST_REQUIRE (ranges.empty ());
+    cache.store (2 * page_size, page, cache.clock ());
+    BOOST_REQUIRE_EQUAL (cache.nb_pages (), 2u);
+    BOOST_REQUIRE (cache.read (0, page_size, values));
+    BOOST_REQUIRE (!cache.read (page_size, page_size, values));
+    BOOST_REQUIRE (cache.read (2 * page_size, page_size, values));
+}
+
+BOOST_AUTO_TEST_CASE (test_stack_depth)
+{
+    int depth = 0;
+    UString::size_type cur = 0;
+
+    GDBMIParser parser (gv_stack_depth);
+    BOOST_REQUIRE (parser.parse_stack_depth (cur, cur, depth));
+    BOOST_REQUIRE_EQUAL (depth, 12);
+}
+
+BOOST_AUTO_TEST_CASE (test_varobj_pool)
+{
+    VarObjPool pool (4, 3);
+    IDebugger::VariableList locals, args, taken_locals, taken_args, evicted;
+    IDebugger::VariableSafePtr i (new IDebugger::Variable ("i", "0", "int"));
+    IDebugger::VariableSafePtr j (new IDebugger::Variable ("j", "1", "int"));
+    IDebugger::VariableSafePtr n (new IDebugger::Variable ("n", "5", "int"));
+    locals.push_back (i);
+    locals.push_back (j);
+    args.push_back (n);
+
+    // Recursive calls of the same function are told apart by their
+    // depth.
+    pool.put (VarObjPool::FrameKey (1, "fact", 3), locals, args, evicted);
+    BOOST_REQUIRE_EQUAL (pool.nb_variables (), 3u);
+    BOOST_REQUIRE (evicted.empty ());
+    BOOST_REQUIRE (!pool.take (VarObjPool::FrameKey (1, "fact", 4),
+                               taken_locals, taken_args));
+    BOOST_REQUIRE (pool.take (VarObjPool::FrameKey (1, "fact", 3),
+                              taken_locals, taken_args));
+    BOOST_REQUIRE_EQUAL (taken_locals.size (), 2u);
+    BOOST_REQUIRE (taken_locals.front ().get () == i.get ());
+    BOOST_REQUIRE_EQUAL (taken_args.size (), 1u);
+    BOOST_REQUIRE (taken_args.front ().get () == n.get ());
+    BOOST_REQUIRE_EQUAL (pool.nb_frames (), 0u);
+    BOOST_REQUIRE_EQUAL (pool.nb_hits (), 1u);
+    BOOST_REQUIRE_EQUAL (pool.nb_misses (), 1u);
+
+    // Putting a frame beyond the capacity of the pool drops the least
+    // recently put frames.  Their variables are handed back, to have
+    // their variable objects deleted.
+    IDebugger::VariableSafePtr k (new IDebugger::Variable ("k", "2", "int"));
+    IDebugger::VariableList main_locals;
+    main_locals.push_back (k);
+    pool.put (VarObjPool::FrameKey (1, "main", 1), main_locals,
+              IDebugger::VariableList (), evicted);
+    pool.put (VarObjPool::FrameKey (1, "fact", 2), args,
+              IDebugger::VariableList (), evicted);
+    pool.put (VarObjPool::FrameKey (1, "fact", 3), locals,
+              IDebugger::VariableList (), evicted);
+    BOOST_REQUIRE_EQUAL (pool.nb_frames (), 2u);
+    BOOST_REQUIRE_EQUAL (pool.nb_variables (), 3u);
+    BOOST_REQUIRE_EQUAL (evicted.size (), 1u);
+    BOOST_REQUIRE (evicted.front ().get () == k.get ());
+    BOOST_REQUIRE (!pool.take (VarObjPool::FrameKey (1, "main", 1),
+                               taken_locals, taken_args));
+
+    // A frame put again with some of the same variables only evicts
+    // the others.
+    evicted.clear ();
+    IDebugger::VariableList some_locals;
+    some_locals.push_back (i);
+    pool.put (VarObjPool::FrameKey (1, "fact", 3), some_locals,
+              IDebugger::VariableList (), evicted);
+    BOOST_REQUIRE_EQUAL (evicted.size (), 1u);
+    BOOST_REQUIRE (evicted.front ().get () == j.get ());
+
+    // The pool holds at most 3 frames, whatever their sizes.
+    evicted.clear ();
+    pool.put (VarObjPool::FrameKey (2, "f", 1), main_locals,
+              IDebugger::VariableList (), evicted);
+    pool.put (VarObjPool::FrameKey (2, "g", 1), IDebugger::VariableList (),
+              some_locals, evicted);
+    BOOST_REQUIRE_EQUAL (pool.nb_frames (), 3u);
+    BOOST_REQUIRE_EQUAL (evicted.size (), 1u);
+    BOOST_REQUIRE (evicted.front ().get () == n.get ());
+
+    pool.clear ();
+    BOOST_REQUIRE_EQUAL (pool.nb_variables (), 0u);
+    BOOST_REQUIRE (!pool.take (VarObjPool::FrameKey (1, "fact", 2),
+                               taken_locals, taken_args));
+}
+
+BOOST_AUTO_TEST_CASE (test_command_latency_stats)
+{
+    typedef IDebugger::CommandLatency Latency;
+    CommandLatencyStats stats;
+
+    Command step ("step-over", "-exec-next");
+    step.queued_time (1000);
+    step.issued_time (1500);
+    CommandLatencyStats::ResultTimes times;
+    // The first byte was read along with the previous record, before
+    // the command was issued.
+    times.first_byte = 1400;
+    times.received = 1600;
+    times.parsing = 1700;
+    times.parsed = 1710;
+    times.handled = 1750;
+    stats.record (step, times);
+
+    // A command that was never issued is ignored, and one without a
+    // name is accounted under its GDB/MI command.
+    stats.record (Command ("-var-update *"), times);
+    Command update ("-var-update --all-values *");
+    update.issued_time (1500);
+    stats.record (update, times);
+
+    const IDebugger::CommandLatencyMap &map = stats.stats ();
+    BOOST_REQUIRE_EQUAL (map.size (), 2u);
+    BOOST_REQUIRE (map.count ("step-over"));
+    BOOST_REQUIRE (map.count ("-var-update"));
+
+    const Latency &latency = map.find ("step-over")->second;
+    const Latency::Histogram &queued =
+        latency.phases[Latency::QUEUED_PHASE];
+    BOOST_REQUIRE_EQUAL (queued.nb_samples, 1u);
+    BOOST_REQUIRE_EQUAL (queued.total, 500);
+    BOOST_REQUIRE_EQUAL (queued.max, 500);
+    // 256 <= 500 < 512.
+    BOOST_REQUIRE_EQUAL (queued.buckets[9], 1u);
+    BOOST_REQUIRE_EQUAL (latency.phases[Latency::DEBUGGER_PHASE].buckets[0],
+                         1u);
+    BOOST_REQUIRE_EQUAL (latency.phases[Latency::RECEIVE_PHASE].total, 100);
+    BOOST_REQUIRE_EQUAL (latency.phases[Latency::PARSE_PHASE].total, 10);
+    BOOST_REQUIRE_EQUAL (latency.phases[Latency::HANDLERS_PHASE].total, 40);
+    BOOST_REQUIRE_EQUAL (latency.phases[Latency::TOTAL_PHASE].total, 750);
+    BOOST_REQUIRE_EQUAL (map.find ("-var-update")->second
+                             .phases[Latency::QUEUED_PHASE].total,
+                         0);
+
+    BOOST_REQUIRE_EQUAL (Latency::Histogram::bucket_of (0), 0);
+    BOOST_REQUIRE_EQUAL (Latency::Histogram::bucket_of (1), 1);
+    BOOST_REQUIRE_EQUAL (Latency::Histogram::bucket_of (1LL << 40),
+                         Latency::NB_BUCKETS - 1);
+
+    std::ostringstream out;
+    stats.write (out);
+    std::string dump = out.str ();
+    BOOST_REQUIRE_EQUAL (std::count (dump.begin (), dump.end (), '\n'),
+                         2 * Latency::NB_PHASES);
+    BOOST_REQUIRE (dump.find ("{\"command\": \"step-over\", "
+                              "\"phase\": \"queued\", \"count\": 1, "
+                              "\"total_us\": 500, \"max_us\": 500, ")
+                   != std::string::npos);
+
+    stats.clear ();
+    BOOST_REQUIRE (stats.stats ().empty ());
+}
+
 BOOST_AUTO_TEST_CASE (test_gdbmi_result)
 {
     GDBMIResultSafePtr result;
@@ -844,6 +1171,83 @@ BOOST_AUTO_TEST_CASE (test_gdbmi_result)
                    && result->variable () == "variable");
 }
 
+/// Build the output record of a -var-list-children listing
+/// a_nb_children integers.
+static std::string
+make_big_var_list_children_record (unsigned a_nb_children)
+{
+    std::ostringstream os;
+    os << "^done,numchild=\"" << a_nb_children << "\",children=[";
+    for (unsigned i = 0; i < a_nb_children; ++i) {
+        if (i)
+            os << ",";
+        os << "child={name=\"var1." << i << "\",exp=\"" << i
+           << "\",numchild=\"0\",value=\"" << i * 2
+           << "\",type=\"int\",thread-id=\"1\"}";
+    }
+    os << "],has_more=\"0\"\n";
+    return os.str ();
+}
+
+static void
+check_big_var_list_children (const Output &a_output,
+                             unsigned a_nb_children)
+{
+    BOOST_REQUIRE (a_output.result_record ().has_variable_children ());
+    const vector<IDebugger::VariableSafePtr> &children =
+        a_output.result_record ().variable_children ();
+    BOOST_REQUIRE_EQUAL (children.size (), a_nb_children);
+    for (unsigned i = 0; i < a_nb_children; i += a_nb_children / 7 + 1) {
+        UString name, value;
+        name.printf ("var1.%u", i);
+        value.printf ("%u", i * 2);
+        BOOST_REQUIRE_EQUAL (children[i]->internal_name (), name);
+        BOOST_REQUIRE_EQUAL (children[i]->value (), value);
+    }
+}
+
+BOOST_AUTO_TEST_CASE (test_gdbmi_arena)
+{
+    UString::size_type to = 0;
+    Output output;
+    GDBMIParser parser;
+
+    // A GDB/MI node built outside of the parsing of an output record
+    // is a normal heap object, that the arena never reclaims.
+    GDBMIResultSafePtr result;
+    parser.push_input (gv_gdbmi_result0);
+    BOOST_REQUIRE (parser.parse_gdbmi_result (0, to, result));
+    parser.pop_input ();
+    BOOST_REQUIRE (result && result->variable () == "variable");
+
+    // The nodes of a record much bigger than an arena block span
+    // many blocks, some of which are released once the record is
+    // parsed.  Parsing records again, big or small, reuses the
+    // blocks that were kept.
+    std::string big = make_big_var_list_children_record (3000);
+    std::string small = make_big_var_list_children_record (3);
+    for (int i = 0; i < 3; ++i) {
+        parser.push_input (big);
+        BOOST_REQUIRE (parser.parse_output_record (0, to, output));
+        parser.pop_input ();
+        check_big_var_list_children (output, 3000);
+
+        parser.push_input (small);
+        BOOST_REQUIRE (parser.parse_output_record (0, to, output));
+        parser.pop_input ();
+        check_big_var_list_children (output, 3);
+    }
+
+    // The records parsed in the meantime left the node above alone.
+    BOOST_REQUIRE (result->variable () == "variable");
+    BOOST_REQUIRE (result->value ()
+                   && result->value ()->content_type ()
+                        == GDBMIValue::LIST_TYPE);
+    list<GDBMIValueSafePtr> values;
+    result->value ()->get_list_content ()->get_value_content (values);
+    BOOST_REQUIRE_EQUAL (values.size (), 2u);
+}
+
 BOOST_AUTO_TEST_CASE (test_breakpoint_table)
 {
     std::map<string, IDebugger::Breakpoint> breakpoints;
@@ -999,6 +1403,166 @@ BOOST_AUTO_TEST_CASE (test_file_list)
     BOOST_REQUIRE (num_files == 126);
 }
 
+BOOST_AUTO_TEST_CASE (test_borrowed_input)
+{
+    UString::size_type to = 0;
+    std::string stack (gv_stack0), files (gv_file_list1);
+
+    // Parsing a borrowed input must yield the same thing as parsing
+    // a copied input.
+    GDBMIParser parser;
+    vector<IDebugger::Frame> owned_stack, borrowed_stack;
+    parser.push_input (stack);
+    BOOST_REQUIRE (parser.parse_call_stack (0, to, owned_stack));
+    parser.pop_input ();
+    parser.push_input (stack.data (), stack.size ());
+    BOOST_REQUIRE (parser.parse_call_stack (0, to, borrowed_stack));
+    BOOST_REQUIRE (parser.get_input ().raw () == stack);
+    parser.pop_input ();
+    BOOST_REQUIRE (owned_stack.size () == borrowed_stack.size ());
+    for (unsigned i = 0; i < owned_stack.size (); ++i) {
+        BOOST_REQUIRE (owned_stack[i] == borrowed_stack[i]);
+        BOOST_REQUIRE (owned_stack[i].file_full_name ()
+                       == borrowed_stack[i].file_full_name ());
+    }
+
+    std::vector<UString> owned_files, borrowed_files;
+    parser.push_input (files);
+    BOOST_REQUIRE (parser.parse_file_list (0, to, owned_files));
+    parser.pop_input ();
+    parser.push_input (files.data (), files.size ());
+    BOOST_REQUIRE (parser.parse_file_list (0, to, borrowed_files));
+    parser.pop_input ();
+    BOOST_REQUIRE (owned_files == borrowed_files);
+
+    // The borrowed input must not be read past its end, even if
+    // what follows it looks like a continuation of the input.
+    std::string str ("\"abracadabra\"bogus");
+    UString res;
+    parser.push_input (str.data (), strlen (gv_str0) - 1);
+    BOOST_REQUIRE (!parser.parse_c_string (0, to, res));
+    parser.pop_input ();
+    parser.push_input (str.data (), strlen (gv_str0));
+    BOOST_REQUIRE (parser.parse_c_string (0, to, res));
+    BOOST_REQUIRE (res == "abracadabra");
+    parser.pop_input ();
+
+    // Compare the time it takes to parse the same transcripts in
+    // the two modes.
+    const int nb_iterations = 200;
+    double owned_time = 0, borrowed_time = 0;
+    Glib::Timer timer;
+    for (int i = 0; i < nb_iterations; ++i) {
+        owned_stack.clear ();
+        owned_files.clear ();
+        parser.push_input (stack);
+        parser.parse_call_stack (0, to, owned_stack);
+        parser.pop_input ();
+        parser.push_input (files);
+        parser.parse_file_list (0, to, owned_files);
+        parser.pop_input ();
+    }
+    owned_time = timer.elapsed ();
+    timer.start ();
+    for (int i = 0; i < nb_iterations; ++i) {
+        borrowed_stack.clear ();
+        borrowed_files.clear ();
+        parser.push_input (stack.data (), stack.size ());
+        parser.parse_call_stack (0, to, borrowed_stack);
+        parser.pop_input ();
+        parser.push_input (files.data (), files.size ());
+        parser.parse_file_list (0, to, borrowed_files);
+        parser.pop_input ();
+    }
+    borrowed_time = timer.elapsed ();
+    BOOST_TEST_MESSAGE ("parsed " << nb_iterations
+                        << " transcripts: copied input: "
+                        << owned_time << "s, borrowed input: "
+                        << borrowed_time << "s");
+}
+
+BOOST_AUTO_TEST_CASE (test_record_reader)
+{
+    GDBMIRecordReader reader;
+    GDBMIStringSlice record;
+
+    // Feed two records one byte at a time, so that the prompts get
+    // split at every possible place.
+    std::string stream ("\n^done,value=\"1\"\n(gdb) \n"
+                        "*stopped,reason=\"end-stepping-range\"\n(gdb) \n"
+                        "~\"incomplete");
+    vector<UString> records;
+    for (unsigned i = 0; i < stream.size (); ++i) {
+        reader.append (stream.data () + i, 1);
+        while (reader.next_record (record))
+            records.push_back (record.to_ustring ());
+    }
+    BOOST_REQUIRE_EQUAL (records.size (), 2u);
+    BOOST_REQUIRE (records[0] == "^done,value=\"1\"\n(gdb)");
+    BOOST_REQUIRE (records[1]
+                   == "*stopped,reason=\"end-stepping-range\"\n(gdb)");
+    BOOST_REQUIRE (reader.pending () == "~\"incomplete");
+
+    // A record is delivered as soon as its prompt is complete.
+    reader.clear ();
+    std::string chunk ("^done\n(gdb)");
+    reader.append (chunk.data (), chunk.size ());
+    BOOST_REQUIRE (reader.next_record (record));
+    BOOST_REQUIRE (record == "^done\n(gdb)");
+    BOOST_REQUIRE (!reader.next_record (record));
+    chunk = " \n^done\n(gdb) \n";
+    reader.append (chunk.data (), chunk.size ());
+    BOOST_REQUIRE (reader.next_record (record));
+    BOOST_REQUIRE (record == "^done\n(gdb)");
+    BOOST_REQUIRE (reader.pending ().empty ());
+
+    // Throughput: feed big replies in small chunks, like what we get
+    // from GDB when listing the children of a big container.
+    std::string reply;
+    for (int i = 0; i < 50000; ++i)
+        reply += "~\"some console output line that is rather long\\n\"\n";
+    reply += "^done\n(gdb) \n";
+    const int nb_replies = 4;
+    const std::string::size_type chunk_size = 512;
+    std::string replies;
+    for (int i = 0; i < nb_replies; ++i)
+        replies += reply;
+
+    reader.clear ();
+    int nb_records = 0;
+    UString::size_type to = 0;
+    GDBMIParser parser;
+    Glib::Timer timer;
+    for (std::string::size_type i = 0;
+         i < replies.size ();
+         i += chunk_size) {
+        reader.append (replies.data () + i,
+                       std::min (chunk_size, replies.size () - i));
+        while (reader.next_record (record)) {
+            BOOST_REQUIRE_EQUAL (record.size () + 2, reply.size ());
+            ++nb_records;
+        }
+    }
+    double split_time = timer.elapsed ();
+    BOOST_REQUIRE_EQUAL (nb_records, nb_replies);
+    BOOST_REQUIRE (reader.pending ().empty ());
+
+    // Make sure the records are fit for the parser.
+    reader.append (reply.data (), reply.size ());
+    BOOST_REQUIRE (reader.next_record (record));
+    Output output;
+    parser.push_input (record.data (), record.size ());
+    BOOST_REQUIRE (parser.parse_output_record (0, to, output));
+    parser.pop_input ();
+    BOOST_REQUIRE (output.has_result_record ());
+    BOOST_REQUIRE_EQUAL (output.out_of_band_records ().size (), 50000u);
+
+    BOOST_TEST_MESSAGE ("split " << replies.size ()
+                        << " bytes fed in chunks of " << chunk_size
+                        << " bytes into " << nb_records
+                        << " records in " << split_time << "s");
+}
+
 using boost::unit_test::test_suite;
 
 NEMIVER_API bool init_unit_test ()
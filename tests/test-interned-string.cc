@@ -0,0 +1,64 @@
+#include "config.h"
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include "common/nmv-initializer.h"
+#include "common/nmv-exception.h"
+#include "common/nmv-interned-string.h"
+
+using nemiver::common::Initializer;
+using nemiver::common::InternedString;
+using nemiver::common::UString;
+
+BOOST_AUTO_TEST_SUITE (test_interned_string)
+
+BOOST_AUTO_TEST_CASE (test_interned_string_basics)
+{
+    InternedString empty;
+    BOOST_REQUIRE (empty.empty ());
+    BOOST_REQUIRE (empty.str ().empty ());
+    BOOST_REQUIRE (empty == InternedString (""));
+
+    InternedString a ("main"), b (std::string ("main")), c (UString ("foo"));
+    BOOST_REQUIRE (a == b);
+    BOOST_REQUIRE (a != c);
+    BOOST_REQUIRE (&a.str () == &b.str ());
+    BOOST_REQUIRE_EQUAL (a.raw (), "main");
+    BOOST_REQUIRE (c.str () == "foo");
+
+    size_t table_size = InternedString::table_size ();
+    InternedString d ("main");
+    BOOST_REQUIRE_EQUAL (InternedString::table_size (), table_size);
+    d.clear ();
+    BOOST_REQUIRE (d.empty ());
+}
+
+// An entry of the table goes away with its last handle.
+BOOST_AUTO_TEST_CASE (test_interned_string_release)
+{
+    size_t table_size = InternedString::table_size ();
+    {
+        InternedString a (std::string ("a_function_of_its_own"));
+        BOOST_REQUIRE_EQUAL (InternedString::table_size (), table_size + 1);
+        InternedString b (a), c;
+        c = a;
+        a.clear ();
+        b = InternedString ();
+        BOOST_REQUIRE_EQUAL (InternedString::table_size (), table_size + 1);
+        BOOST_REQUIRE (c == InternedString ("a_function_of_its_own"));
+    }
+    BOOST_REQUIRE_EQUAL (InternedString::table_size (), table_size);
+}
+
+bool
+init_unit_test ()
+{
+    NEMIVER_TRY
+
+    Initializer::do_init ();
+
+    NEMIVER_CATCH_NOX
+
+    return 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,296 @@
+#include "config.h"
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <glibmm.h>
+#include <glib/gstdio.h>
+#include "common/nmv-initializer.h"
+#include "common/nmv-exception.h"
+#include "common/nmv-log-stream-utils.h"
+
+using nemiver::common::Initializer;
+using nemiver::common::LogStream;
+using nemiver::common::ScopeLogger;
+
+static const char *STEP_DOMAIN = "log-step-domain";
+static const char *TRACE_DOMAIN = "log-trace-domain";
+static const char *UNTRACED_DOMAIN = "log-untraced-domain";
+
+// The depth of the scopes traced by each thread.
+static const int TRACE_DEPTH = 4;
+
+// The number of threads logging to the same stream, and the number of
+// lines each of them logs.
+static const int NB_LOGGING_THREADS = 4;
+static const int NB_LINES_PER_THREAD = 20000;
+
+static int s_nb_formatted = 0;
+static volatile int s_sink = 0;
+
+static int
+count_formatting ()
+{
+    return ++s_nb_formatted;
+}
+
+static void
+logged_step (int a_i)
+{
+    LOG_SCOPE_NORMAL_D ("logged_step", STEP_DOMAIN);
+    LOG_D ("step " << a_i << ", formatted " << count_formatting (),
+           STEP_DOMAIN);
+    s_sink = s_sink + a_i;
+}
+
+static void
+log_lines (LogStream *a_stream, int a_thread)
+{
+    char line[64];
+    for (int i = 0; i < NB_LINES_PER_THREAD; ++i) {
+        snprintf (line, sizeof (line), "thread %d line %d\n", a_thread, i);
+        a_stream->write (line);
+    }
+}
+
+// Log NB_LINES_PER_THREAD lines from NB_LOGGING_THREADS threads into
+// a new stream of type a_type, then check that the file has them
+// all.
+static void
+log_lines_to_file (LogStream::StreamType a_type, const std::string &a_path)
+{
+    LogStream::set_stream_type (a_type);
+    LogStream::set_stream_file_path (a_path.c_str ());
+    LogStream *stream = new LogStream;
+
+    std::vector<Glib::Thread*> threads;
+    for (int i = 0; i < NB_LOGGING_THREADS; ++i)
+        threads.push_back (Glib::Thread::create
+                           (sigc::bind (sigc::ptr_fun (log_lines),
+                                        stream, i),
+                            true /*joinable*/));
+    for (size_t i = 0; i < threads.size (); ++i)
+        threads[i]->join ();
+
+    // Destroying an asynchronous stream waits for its writer.
+    delete stream;
+    LogStream::set_stream_type (LogStream::COUT_STREAM);
+
+    std::string content = Glib::file_get_contents (a_path);
+    int nb_lines = 0;
+    for (std::string::size_type i = 0; i < content.size (); ++i)
+        if (content[i] == '\n')
+            ++nb_lines;
+    BOOST_REQUIRE_EQUAL (nb_lines, NB_LOGGING_THREADS * NB_LINES_PER_THREAD);
+    for (int i = 0; i < NB_LOGGING_THREADS; ++i) {
+        char line[64];
+        snprintf (line, sizeof (line), "thread %d line %d\n",
+                  i, NB_LINES_PER_THREAD - 1);
+        BOOST_REQUIRE (content.find (line) != std::string::npos);
+    }
+    g_remove (a_path.c_str ());
+}
+
+static void
+write_unfinished_line (LogStream *a_stream)
+{
+    a_stream->write ("unfinished line");
+}
+
+static void
+trace_nested_scopes (int a_depth)
+{
+    if (a_depth <= 0)
+        return;
+    char name[32];
+    snprintf (name, sizeof (name), "scope-%d", a_depth);
+    ScopeLogger scope_logger (name, LogStream::LOG_LEVEL_NORMAL,
+                              TRACE_DOMAIN);
+    // The scopes of disabled domains are not traced.
+    ScopeLogger untraced_scope_logger ("untraced-scope",
+                                       LogStream::LOG_LEVEL_NORMAL,
+                                       UNTRACED_DOMAIN);
+    trace_nested_scopes (a_depth - 1);
+}
+
+// Return the value of the field a_key of the trace event a_event,
+// without its quotes.
+static std::string
+get_event_field (const std::string &a_event, const std::string &a_key)
+{
+    std::string key = "\"" + a_key + "\": ";
+    std::string::size_type begin = a_event.find (key);
+    BOOST_REQUIRE (begin != std::string::npos);
+    begin += key.size ();
+    if (a_event[begin] == '"') {
+        ++begin;
+        std::string::size_type end = a_event.find ('"', begin);
+        BOOST_REQUIRE (end != std::string::npos);
+        return a_event.substr (begin, end - begin);
+    }
+    std::string::size_type end = a_event.find_first_of (",}", begin);
+    BOOST_REQUIRE (end != std::string::npos);
+    return a_event.substr (begin, end - begin);
+}
+
+BOOST_AUTO_TEST_SUITE (test_log_stream)
+
+BOOST_AUTO_TEST_CASE (test_disabled_site_does_not_format)
+{
+    LOG_STREAM.enable_domain ("all", false);
+    LOG_STREAM.enable_domain (STEP_DOMAIN, false);
+    s_nb_formatted = 0;
+
+    for (int i = 0; i < 10; ++i)
+        logged_step (i);
+    BOOST_REQUIRE_EQUAL (s_nb_formatted, 0);
+
+    // Enabling the domain invalidates the answer cached by the sites.
+    LOG_STREAM.enable_domain (STEP_DOMAIN);
+    logged_step (0);
+    BOOST_REQUIRE_EQUAL (s_nb_formatted, 1);
+
+    LOG_STREAM.enable_domain (STEP_DOMAIN, false);
+    logged_step (0);
+    BOOST_REQUIRE_EQUAL (s_nb_formatted, 1);
+
+    // So does deactivating the logging.
+    LOG_STREAM.enable_domain (STEP_DOMAIN);
+    LogStream::activate (false);
+    logged_step (0);
+    BOOST_REQUIRE_EQUAL (s_nb_formatted, 1);
+    LogStream::activate (true);
+    LOG_STREAM.enable_domain (STEP_DOMAIN, false);
+}
+
+// Asynchronous streams must not lose messages when told to block,
+// even with a queue way smaller than what is logged.
+BOOST_AUTO_TEST_CASE (test_async_stream)
+{
+    std::string path = Glib::build_filename (Glib::get_tmp_dir (),
+                                             "nemiver-test-log-stream.txt");
+
+    log_lines_to_file (LogStream::FILE_STREAM, path);
+
+    g_setenv ("NMV_LOG_ASYNC", "block", true);
+    g_setenv ("NMV_LOG_ASYNC_CAPACITY", "64", true);
+    log_lines_to_file (LogStream::ASYNC_FILE_STREAM, path);
+    g_unsetenv ("NMV_LOG_ASYNC_CAPACITY");
+    log_lines_to_file (LogStream::ASYNC_FILE_STREAM, path);
+    g_unsetenv ("NMV_LOG_ASYNC");
+}
+
+// Flushing an asynchronous stream must wait for the writer, and the
+// threads that exit in the middle of a line must not lose it.
+BOOST_AUTO_TEST_CASE (test_async_stream_flush)
+{
+    std::string path = Glib::build_filename (Glib::get_tmp_dir (),
+                                             "nemiver-test-log-flush.txt");
+    LogStream::set_stream_type (LogStream::ASYNC_FILE_STREAM);
+    LogStream::set_stream_file_path (path.c_str ());
+    LogStream *stream = new LogStream;
+
+    Glib::Thread *thread = Glib::Thread::create
+        (sigc::bind (sigc::ptr_fun (write_unfinished_line), stream),
+         true /*joinable*/);
+    thread->join ();
+    stream->write ("main line\n");
+    nemiver::common::flush (*stream);
+
+    std::string content = Glib::file_get_contents (path);
+    BOOST_REQUIRE (content.find ("unfinished line") != std::string::npos);
+    BOOST_REQUIRE (content.find ("main line\n") != std::string::npos);
+
+    delete stream;
+    LogStream::set_stream_type (LogStream::COUT_STREAM);
+    g_remove (path.c_str ());
+}
+
+// The trace of the scopes must be a JSON array of begin and end
+// events that nest properly in each thread.
+BOOST_AUTO_TEST_CASE (test_scope_trace)
+{
+    std::string path = Glib::build_filename (Glib::get_tmp_dir (),
+                                             "nemiver-test-trace.json");
+    LOG_STREAM.enable_domain ("all", false);
+    LOG_STREAM.enable_domain (TRACE_DOMAIN);
+    LOG_STREAM.enable_domain (UNTRACED_DOMAIN, false);
+    BOOST_REQUIRE (ScopeLogger::start_tracing (path));
+    BOOST_REQUIRE (ScopeLogger::is_tracing ());
+    BOOST_REQUIRE (!ScopeLogger::start_tracing (path));
+
+    Glib::Thread *thread = Glib::Thread::create
+        (sigc::bind (sigc::ptr_fun (trace_nested_scopes), TRACE_DEPTH),
+         true /*joinable*/);
+    trace_nested_scopes (TRACE_DEPTH);
+    thread->join ();
+
+    ScopeLogger::stop_tracing ();
+    BOOST_REQUIRE (!ScopeLogger::is_tracing ());
+    // Scopes are not traced anymore.
+    trace_nested_scopes (1);
+    LOG_STREAM.enable_domain (TRACE_DOMAIN, false);
+
+    std::string content = Glib::file_get_contents (path);
+    g_remove (path.c_str ());
+    BOOST_REQUIRE (content.find ("[\n") == 0);
+    BOOST_REQUIRE (content.find ("untraced-scope") == std::string::npos);
+    BOOST_REQUIRE (content.size () >= 4);
+    BOOST_REQUIRE (content.substr (content.size () - 3) == "\n]\n");
+
+    std::vector<std::string> events;
+    std::string::size_type begin = 2, end;
+    while ((end = content.find ('\n', begin)) < content.size () - 2) {
+        std::string event = content.substr (begin, end - begin);
+        if (event[event.size () - 1] == ',')
+            event.erase (event.size () - 1);
+        BOOST_REQUIRE (event[0] == '{');
+        BOOST_REQUIRE (event[event.size () - 1] == '}');
+        events.push_back (event);
+        begin = end + 1;
+    }
+    BOOST_REQUIRE_EQUAL (events.size (), 2u * 2 * TRACE_DEPTH);
+
+    std::map<std::string, std::vector<std::string> > scopes_of_thread;
+    std::map<std::string, double> last_ts_of_thread;
+    for (size_t i = 0; i < events.size (); ++i) {
+        std::string name = get_event_field (events[i], "name");
+        std::string phase = get_event_field (events[i], "ph");
+        std::string tid = get_event_field (events[i], "tid");
+        double ts = atof (get_event_field (events[i], "ts").c_str ());
+        BOOST_REQUIRE_EQUAL (get_event_field (events[i], "cat"),
+                             TRACE_DOMAIN);
+        BOOST_REQUIRE (ts >= last_ts_of_thread[tid]);
+        last_ts_of_thread[tid] = ts;
+
+        std::vector<std::string> &scopes = scopes_of_thread[tid];
+        if (phase == "B") {
+            scopes.push_back (name);
+        } else {
+            BOOST_REQUIRE_EQUAL (phase, "E");
+            BOOST_REQUIRE (!scopes.empty ());
+            BOOST_REQUIRE_EQUAL (scopes.back (), name);
+            scopes.pop_back ();
+        }
+    }
+    BOOST_REQUIRE_EQUAL (scopes_of_thread.size (), 2u);
+    std::map<std::string, std::vector<std::string> >::const_iterator it;
+    for (it = scopes_of_thread.begin (); it != scopes_of_thread.end (); ++it)
+        BOOST_REQUIRE (it->second.empty ());
+}
+
+bool
+init_unit_test ()
+{
+    NEMIVER_TRY
+
+    Initializer::do_init ();
+
+    NEMIVER_CATCH_NOX
+
+    return 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,144 @@
+#include "config.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <boost/test/minimal.hpp>
+#include <glibmm.h>
+#include "common/nmv-initializer.h"
+#include "common/nmv-safe-ptr-utils.h"
+#include "nmv-i-debugger.h"
+#include "nmv-debugger-utils.h"
+#include "test-utils.h"
+
+using namespace nemiver;
+using namespace nemiver::common;
+using namespace std;
+
+Glib::RefPtr<Glib::MainLoop> loop =
+    Glib::MainLoop::create (Glib::MainContext::get_default ());
+
+IDebuggerSafePtr debugger;
+
+// Big enough to need several -data-write-memory-bytes commands.
+static const size_t NB_BYTES = 5000;
+static vector<uint8_t> bytes_to_write;
+static size_t buffer_addr;
+static int nb_memory_set;
+static bool memory_verified;
+
+void
+on_engine_died_signal ()
+{
+    MESSAGE ("engine died");
+    loop->quit ();
+}
+
+void
+on_program_finished_signal ()
+{
+    MESSAGE ("program finished");
+    loop->quit ();
+}
+
+void
+on_stopped_signal (IDebugger::StopReason a_reason,
+                   bool a_has_frame,
+                   const IDebugger::Frame &a_frame,
+                   int /*a_thread_id*/,
+                   const string &/*a_bp_num*/,
+                   const UString &/*a_cookie*/)
+{
+    if (a_reason != IDebugger::BREAKPOINT_HIT)
+        return;
+    BOOST_REQUIRE (a_has_frame);
+
+    if (a_frame.function_name () == "buffer_ready")
+        debugger->print_variable_value ("buffer_addr");
+}
+
+void
+on_variable_value_signal (const UString &a_var_name,
+                          const IDebugger::VariableSafePtr &a_var,
+                          const UString &/*a_cookie*/)
+{
+    BOOST_REQUIRE (a_var);
+    if (a_var_name != "buffer_addr")
+        return;
+
+    buffer_addr = strtoul (a_var->value ().c_str (), 0, 10);
+    BOOST_REQUIRE (buffer_addr);
+    MESSAGE ("writing " << (int) NB_BYTES << " bytes at "
+             << a_var->value ());
+
+    for (size_t i = 0; i < NB_BYTES; ++i)
+        bytes_to_write.push_back (static_cast<uint8_t> (i * 7 + 1));
+    debugger->set_memory (buffer_addr, bytes_to_write);
+}
+
+void
+on_set_memory_signal (size_t a_addr,
+                      const vector<uint8_t> &a_values,
+                      const UString &/*a_cookie*/)
+{
+    ++nb_memory_set;
+    BOOST_REQUIRE (a_addr == buffer_addr);
+    BOOST_REQUIRE (a_values == bytes_to_write);
+
+    // Read back one more byte than what was written, to make sure
+    // the write didn't go past its end.
+    debugger->read_memory (buffer_addr, NB_BYTES + 1);
+}
+
+void
+on_read_memory_signal (size_t a_addr,
+                       const vector<uint8_t> &a_values,
+                       const UString &/*a_cookie*/)
+{
+    BOOST_REQUIRE (a_addr == buffer_addr);
+    BOOST_REQUIRE (a_values.size () == NB_BYTES + 1);
+    BOOST_REQUIRE (std::equal (bytes_to_write.begin (),
+                               bytes_to_write.end (),
+                               a_values.begin ()));
+    BOOST_REQUIRE (a_values[NB_BYTES] == 0);
+    memory_verified = true;
+    debugger->do_continue ();
+}
+
+NEMIVER_API int
+test_main (int, char**)
+{
+    NEMIVER_TRY
+
+    Initializer::do_init ();
+
+    THROW_IF_FAIL (loop);
+
+    debugger = debugger_utils::load_debugger_iface_with_confmgr ();
+
+    debugger->set_event_loop_context (loop->get_context ());
+
+    debugger->engine_died_signal ().connect (&on_engine_died_signal);
+    debugger->program_finished_signal ().connect
+                                    (&on_program_finished_signal);
+    debugger->stopped_signal ().connect (&on_stopped_signal);
+    debugger->variable_value_signal ().connect (&on_variable_value_signal);
+    debugger->set_memory_signal ().connect (&on_set_memory_signal);
+    debugger->read_memory_signal ().connect (&on_read_memory_signal);
+
+    vector<UString> args, source_search_dir;
+    source_search_dir.push_back (".");
+    debugger->load_program ("memorybuffer", args, ".",
+                            source_search_dir, "", false);
+    debugger->set_breakpoint ("buffer_ready");
+    debugger->run ();
+
+    NEMIVER_SETUP_TIMEOUT (loop, 30);
+    loop->run ();
+    NEMIVER_CHECK_NO_TIMEOUT;
+
+    NEMIVER_CATCH_AND_RETURN_NOX (-1);
+
+    BOOST_REQUIRE (nb_memory_set == 1);
+    BOOST_REQUIRE (memory_verified);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "config.h"
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <glibmm.h>
+#include "common/nmv-initializer.h"
+#include "common/nmv-exception.h"
+#include "common/nmv-object.h"
+#include "common/nmv-ustring.h"
+
+using nemiver::common::Initializer;
+using nemiver::common::Object;
+using nemiver::common::UString;
+
+static const int NB_OBJECTS = 10000;
+
+// The number of threads sharing an object, and the number of
+// references each of them takes and drops.
+static const int NB_SHARING_THREADS = 4;
+static const int NB_REFS_PER_THREAD = 100000;
+
+// Count the allocations done by the whole program.
+static volatile gint s_nb_allocations = 0;
+
+void*
+operator new (size_t a_size)
+{
+    g_atomic_int_inc (&s_nb_allocations);
+    void *result = malloc (a_size ? a_size : 1);
+    if (!result)
+        throw std::bad_alloc ();
+    return result;
+}
+
+void
+operator delete (void *a_pointer) throw ()
+{
+    free (a_pointer);
+}
+
+static void
+ref_and_unref (Object *a_object)
+{
+    for (int i = 0; i < NB_REFS_PER_THREAD; ++i) {
+        a_object->ref ();
+        a_object->unref ();
+    }
+}
+
+BOOST_AUTO_TEST_SUITE (test_object)
+
+// Building an Object must not allocate more than the object itself.
+BOOST_AUTO_TEST_CASE (test_object_allocations)
+{
+    std::vector<Object*> objects;
+    objects.reserve (NB_OBJECTS);
+
+    gint nb_allocations = g_atomic_int_get (&s_nb_allocations);
+    for (int i = 0; i < NB_OBJECTS; ++i)
+        objects.push_back (new Object);
+    nb_allocations = g_atomic_int_get (&s_nb_allocations) - nb_allocations;
+    BOOST_TEST_MESSAGE ("building " << NB_OBJECTS << " objects took "
+                        << nb_allocations << " allocations");
+    BOOST_REQUIRE_EQUAL (nb_allocations, NB_OBJECTS);
+
+    // The table of the attached objects is built on demand.
+    const Object *attached = 0;
+    BOOST_REQUIRE (!objects[0]->get_attached_object ("key", attached));
+    objects[0]->attach_object ("key", objects[1]);
+    BOOST_REQUIRE (objects[0]->get_attached_object ("key", attached));
+    BOOST_REQUIRE (attached == objects[1]);
+
+    Object copy (*objects[0]);
+    BOOST_REQUIRE (copy.get_attached_object ("key", attached));
+    BOOST_REQUIRE (attached == objects[1]);
+
+    for (size_t i = 0; i < objects.size (); ++i) {
+        objects[i]->ref ();
+        BOOST_REQUIRE_EQUAL (objects[i]->get_refcount (), 2);
+        objects[i]->unref ();
+        objects[i]->unref ();
+    }
+}
+
+BOOST_AUTO_TEST_CASE (test_atomic_refcount)
+{
+    Object *object = new Object;
+    BOOST_REQUIRE (!object->is_atomic_refcount_enabled ());
+    object->enable_atomic_refcount ();
+    BOOST_REQUIRE (object->is_atomic_refcount_enabled ());
+
+    std::vector<Glib::Thread*> threads;
+    for (int i = 0; i < NB_SHARING_THREADS; ++i)
+        threads.push_back (Glib::Thread::create
+                           (sigc::bind (sigc::ptr_fun (ref_and_unref),
+                                        object),
+                            true /*joinable*/));
+    for (size_t i = 0; i < threads.size (); ++i)
+        threads[i]->join ();
+
+    BOOST_REQUIRE_EQUAL (object->get_refcount (), 1);
+    object->unref ();
+}
+
+bool
+init_unit_test ()
+{
+    NEMIVER_TRY
+
+    Initializer::do_init ();
+
+    NEMIVER_CATCH_NOX
+
+    return 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,177 @@
+#include "config.h"
+#include <unistd.h>
+#include <iostream>
+#include <list>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <glib/gstdio.h>
+#include <gtkmm.h>
+#include <gtksourceviewmm.h>
+#include "common/nmv-initializer.h"
+#include "common/nmv-exception.h"
+#include "uicommon/nmv-source-editor.h"
+
+using namespace std;
+using namespace nemiver;
+using nemiver::common::Initializer;
+using nemiver::common::UString;
+
+static const double LOADING_TIMEOUT = 30;
+
+// The source editor needs a display.  Return false if there is none,
+// so that the tests can be skipped.
+static bool
+init_gtk ()
+{
+    static bool s_initialized = false;
+    static bool s_has_display = false;
+    if (s_initialized)
+        return s_has_display;
+    s_initialized = true;
+    if (!gtk_init_check (0, 0)) {
+        BOOST_TEST_MESSAGE ("no display; skipping the source editor tests");
+        return false;
+    }
+    int argc = 0;
+    char **argv = 0;
+    static Gtk::Main s_main (argc, argv);
+    Gsv::init ();
+    s_has_display = true;
+    return true;
+}
+
+// Write a file that is too big to be loaded synchronously, and whose
+// first line is a_first_line.
+static std::string
+write_big_source_file (const std::string &a_first_line, int &a_nb_lines)
+{
+    std::string content = a_first_line + "\n";
+    a_nb_lines = 1;
+    while (content.size () < 1024 * 1024) {
+        content += "    result += compute (i, j);\n";
+        ++a_nb_lines;
+    }
+
+    std::string path;
+    int fd = Glib::file_open_tmp (path, "nemiver-source-XXXXXX.c");
+    close (fd);
+    GError *error = 0;
+    if (!g_file_set_contents (path.c_str (), content.data (),
+                              content.size (), &error)) {
+        std::string message = error ? error->message : "";
+        if (error)
+            g_error_free (error);
+        BOOST_FAIL ("could not write " << path << ": " << message);
+    }
+    return path;
+}
+
+static void
+on_file_loaded (bool a_ok, int &a_nb_calls, bool &a_result)
+{
+    ++a_nb_calls;
+    a_result = a_ok;
+}
+
+// Answer the error dialogs the loader pops up.
+static bool
+dismiss_dialogs ()
+{
+    std::vector<Gtk::Window*> windows = Gtk::Window::list_toplevels ();
+    for (std::vector<Gtk::Window*>::iterator it = windows.begin ();
+         it != windows.end ();
+         ++it) {
+        Gtk::Dialog *dialog = dynamic_cast<Gtk::Dialog*> (*it);
+        if (dialog && dialog->get_visible ())
+            dialog->response (Gtk::RESPONSE_OK);
+    }
+    return true;
+}
+
+// Run the main loop until a_nb_calls is not null.
+static void
+wait_for_loading (const int &a_nb_calls)
+{
+    sigc::connection connection =
+        Glib::signal_timeout ().connect (sigc::ptr_fun (dismiss_dialogs),
+                                         100);
+    Glib::Timer timer;
+    while (!a_nb_calls && timer.elapsed () < LOADING_TIMEOUT)
+        Glib::MainContext::get_default ()->iteration (true);
+    connection.disconnect ();
+}
+
+static void
+load_big_file (const std::string &a_first_line,
+               int &a_nb_calls,
+               bool &a_result,
+               Glib::RefPtr<Gsv::Buffer> &a_buffer,
+               int &a_nb_lines)
+{
+    std::string path = write_big_source_file (a_first_line, a_nb_lines);
+    std::list<std::string> encodings;
+    encodings.push_back ("UTF-8");
+    Gtk::Window window;
+
+    a_nb_calls = 0;
+    a_result = false;
+    BOOST_REQUIRE (SourceEditor::load_file
+                   (window, path, encodings,
+                    /*a_enable_syntax_highlight=*/false, a_buffer,
+                    sigc::bind (sigc::ptr_fun (on_file_loaded),
+                                sigc::ref (a_nb_calls),
+                                sigc::ref (a_result))));
+    // The file is big enough to be loaded in the background.
+    BOOST_REQUIRE_EQUAL (a_nb_calls, 0);
+    wait_for_loading (a_nb_calls);
+    g_unlink (path.c_str ());
+}
+
+BOOST_AUTO_TEST_SUITE (test_source_editor)
+
+BOOST_AUTO_TEST_CASE (test_load_big_file)
+{
+    if (!init_gtk ())
+        return;
+
+    int nb_calls = 0, nb_lines = 0;
+    bool result = false;
+    Glib::RefPtr<Gsv::Buffer> buffer;
+    load_big_file ("// caf\xc3\xa9", nb_calls, result, buffer, nb_lines);
+    BOOST_REQUIRE_EQUAL (nb_calls, 1);
+    BOOST_REQUIRE (result);
+    BOOST_REQUIRE (buffer->get_line_count () >= nb_lines);
+    BOOST_REQUIRE (buffer->get_text (buffer->get_iter_at_line (0),
+                                     buffer->get_iter_at_line (1))
+                   == "// caf\xc3\xa9\n");
+}
+
+BOOST_AUTO_TEST_CASE (test_load_big_file_with_bad_encoding)
+{
+    if (!init_gtk ())
+        return;
+
+    // Once converted from the guessed ISO-8859-1, the null byte makes
+    // the text invalid UTF-8, so the worker thread rejects it.
+    int nb_calls = 0, nb_lines = 0;
+    bool result = true;
+    Glib::RefPtr<Gsv::Buffer> buffer;
+    load_big_file (std::string ("// caf\xe9\0", 8), nb_calls, result,
+                   buffer, nb_lines);
+    BOOST_REQUIRE_EQUAL (nb_calls, 1);
+    BOOST_REQUIRE (!result);
+}
+
+NEMIVER_API bool init_unit_test ()
+{
+    NEMIVER_TRY
+
+    Initializer::do_init ();
+
+    NEMIVER_CATCH_NOX
+
+    return 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,11 +1,13 @@
 #include "config.h"
 #include <iostream>
+#include <list>
 #include <string>
 #include <boost/test/unit_test.hpp>
 #include <glibmm.h>
 #include "common/nmv-ustring.h"
 #include "common/nmv-initializer.h"
 #include "common/nmv-exception.h"
+#include "common/nmv-str-utils.h"
 
 using namespace std;
 using namespace nemiver;
@@ -42,6 +44,52 @@ BOOST_AUTO_TEST_CASE (test_ustring_to_wstring)
     BOOST_REQUIRE (!wstr.compare (0, wstr.size (), s_wstr));
 }
 
+BOOST_AUTO_TEST_CASE (test_guess_buffer_encoding)
+{
+    using str_utils::guess_buffer_encoding;
+
+    BOOST_REQUIRE_EQUAL (guess_buffer_encoding ("int i;", 6), "");
+    BOOST_REQUIRE_EQUAL (guess_buffer_encoding ("\xef\xbb\xbfint", 6),
+                         "UTF-8");
+    BOOST_REQUIRE_EQUAL (guess_buffer_encoding ("// caf\xc3\xa9", 8),
+                         "UTF-8");
+    BOOST_REQUIRE_EQUAL (guess_buffer_encoding ("// caf\xe9", 7),
+                         "ISO-8859-1");
+    BOOST_REQUIRE_EQUAL (guess_buffer_encoding ("// \x93quoted\x94", 11),
+                         "CP1252");
+    BOOST_REQUIRE_EQUAL (guess_buffer_encoding ("i\0n\0t\0 \0i\0;\0", 12),
+                         "UTF-16LE");
+}
+
+BOOST_AUTO_TEST_CASE (test_ensure_buffer_is_in_utf8)
+{
+    std::list<std::string> encodings;
+    encodings.push_back ("ISO-8859-15");
+    UString output;
+    BOOST_REQUIRE (str_utils::ensure_buffer_is_in_utf8 ("// caf\xe9",
+                                                        encodings,
+                                                        output));
+    BOOST_REQUIRE (output == "// caf\xc3\xa9");
+    BOOST_REQUIRE (str_utils::ensure_buffer_is_in_utf8 ("// caf\xc3\xa9",
+                                                        encodings,
+                                                        output));
+    BOOST_REQUIRE (output == "// caf\xc3\xa9");
+
+    // The guessed ISO-8859-1 must not override the encoding the user
+    // listed: 0xa4 is the euro sign in ISO-8859-15.
+    BOOST_REQUIRE (str_utils::ensure_buffer_is_in_utf8 ("// 5\xa4",
+                                                        encodings,
+                                                        output));
+    BOOST_REQUIRE (output == "// 5\xe2\x82\xac");
+
+    // But a guessed UTF-16 is tried first, as ISO-8859-15 would
+    // accept it and keep the null bytes.
+    BOOST_REQUIRE (str_utils::ensure_buffer_is_in_utf8
+                   (std::string ("i\0n\0t\0 \0i\0;\0", 12),
+                    encodings, output));
+    BOOST_REQUIRE (output == "int i;");
+}
+
 NEMIVER_API bool init_unit_test ()
 {
     NEMIVER_TRY
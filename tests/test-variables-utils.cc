@@ -0,0 +1,117 @@
+#include "config.h"
+#include <boost/test/unit_test.hpp>
+#include <gtkmm.h>
+#include "common/nmv-initializer.h"
+#include "common/nmv-exception.h"
+#include "nmv-i-debugger.h"
+#include "persp/dbgperspective/nmv-variables-utils.h"
+
+using namespace nemiver;
+using nemiver::common::Initializer;
+
+namespace vutil = nemiver::variables_utils2;
+
+// Tree views need a display.  Return false if there is none, so that
+// the tests can be skipped.
+static bool
+init_gtk ()
+{
+    static bool s_initialized = false;
+    static bool s_has_display = false;
+    if (s_initialized)
+        return s_has_display;
+    s_initialized = true;
+    if (!gtk_init_check (0, 0)) {
+        BOOST_TEST_MESSAGE ("no display; skipping the variables tests");
+        return false;
+    }
+    int argc = 0;
+    char **argv = 0;
+    static Gtk::Main s_main (argc, argv);
+    s_has_display = true;
+    return true;
+}
+
+// Build a structure variable backed by the variable object a_name,
+// with two members.
+static IDebugger::VariableSafePtr
+build_struct_variable (const std::string &a_name)
+{
+    IDebugger::VariableSafePtr var
+        (new IDebugger::Variable (a_name, "s", "{...}", "struct S"));
+    var->append (IDebugger::VariableSafePtr
+                 (new IDebugger::Variable (a_name + ".a", "a", "1", "int")));
+    var->append (IDebugger::VariableSafePtr
+                 (new IDebugger::Variable (a_name + ".b", "b", "2", "int")));
+    return var;
+}
+
+BOOST_AUTO_TEST_SUITE (test_variables_utils)
+
+BOOST_AUTO_TEST_CASE (test_find_indexed_variable_row)
+{
+    if (!init_gtk ())
+        return;
+
+    Glib::RefPtr<Gtk::TreeStore> store =
+        Gtk::TreeStore::create (vutil::get_variable_columns ());
+    Gtk::TreeView tree_view (store);
+    Gtk::TreeModel::iterator locals_it = store->append ();
+    Gtk::TreeModel::iterator other_it = store->append ();
+
+    IDebugger::VariableSafePtr s = build_struct_variable ("var1");
+    IDebugger::VariableSafePtr t = build_struct_variable ("var2");
+    Gtk::TreeModel::iterator s_it, t_it, row_it;
+    BOOST_REQUIRE (vutil::append_a_variable (s, tree_view, locals_it,
+                                             s_it, false));
+    BOOST_REQUIRE (vutil::append_a_variable (t, tree_view, locals_it,
+                                             t_it, false));
+
+    // The rows are indexed as they are set, and are only found under
+    // their ancestors.
+    IDebugger::VariableSafePtr s_b = s->members ().back ();
+    BOOST_REQUIRE (vutil::find_indexed_variable_row (s_b, tree_view,
+                                                     locals_it, row_it));
+    BOOST_REQUIRE (row_it->get_value (vutil::get_variable_columns ().variable)
+                   == s_b);
+    BOOST_REQUIRE (vutil::find_indexed_variable_row (s_b, tree_view,
+                                                     s_it, row_it));
+    BOOST_REQUIRE (!vutil::find_indexed_variable_row (s_b, tree_view,
+                                                      t_it, row_it));
+    BOOST_REQUIRE (!vutil::find_indexed_variable_row (s_b, tree_view,
+                                                      other_it, row_it));
+
+    // Erasing a row only drops its subtree from the index.
+    vutil::erase_variable_row (store, s_it);
+    BOOST_REQUIRE (!vutil::find_indexed_variable_row (s, tree_view,
+                                                      locals_it, row_it));
+    BOOST_REQUIRE (!vutil::find_indexed_variable_row (s_b, tree_view,
+                                                      locals_it, row_it));
+    IDebugger::VariableSafePtr t_a = t->members ().front ();
+    BOOST_REQUIRE (vutil::find_indexed_variable_row (t_a, tree_view,
+                                                     locals_it, row_it));
+    BOOST_REQUIRE (row_it->get_value (vutil::get_variable_columns ().variable)
+                   == t_a);
+
+    // The index doesn't know what went away with rows deleted by
+    // other means, so it forgets everything.
+    store->erase (other_it);
+    BOOST_REQUIRE (!vutil::find_indexed_variable_row (t_a, tree_view,
+                                                      locals_it, row_it));
+    BOOST_REQUIRE (vutil::find_a_variable_descendent (t_a, locals_it,
+                                                      row_it));
+}
+
+bool
+init_unit_test ()
+{
+    NEMIVER_TRY
+
+    Initializer::do_init ();
+
+    NEMIVER_CATCH_NOX
+
+    return 0;
+}
+
+BOOST_AUTO_TEST_SUITE_END()